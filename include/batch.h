@@ -0,0 +1,14 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "cli.h"
+#include "config.h"
+
+/*
+ * Abstract analysis of every method id listed in path, one per line, or read
+ * from stdin when path is "-". Methods are analyzed concurrently on a single
+ * thread pool and each result is printed as a line of JSON on stdout.
+ */
+int batch_run(const char* path, const Options* opts, const Config* cfg);
+
+#endif
@@ -20,7 +20,7 @@ typedef struct {
 Cfg* cfg_build(IrFunction* ir_function, int num_locals);
 void cfg_print(Cfg* cfg);
 
-int cfg_inline(Cfg* cfg, Config* config, Method* m);
+Cfg* cfg_inline(const Cfg* cfg, Config* config, Method* m);
 
 void cfg_delete(Cfg* cfg);
 
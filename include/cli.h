@@ -8,6 +8,8 @@ typedef struct {
     bool interpreter_only;
     bool abstract_only;
     bool fuzzer;
+    bool batch; // method_id is the path of a method id list, "-" for stdin
+    bool determinism;
     char* method_id;
     char* parameters;
 } Options;
@@ -16,7 +18,8 @@ typedef enum {
     OPT_OK,
     OPT_NOT_ENOUGH_ARGS,
     OPT_TOO_MANY_ARGS,
-    OPT_OPTION_NOT_KNOWN
+    OPT_OPTION_NOT_KNOWN,
+    OPT_CONFLICTING_MODES
 } OptionsParseResult;
 
 OptionsParseResult options_parse_args(const int argc, const char** argv, Options* opts);
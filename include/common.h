@@ -3,12 +3,21 @@
 
 #include "vector.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define SUCCESS 0
 #define FAILURE 1
 
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
+// FNV-1a, chained by passing the previous hash
+#define HASH_SEED 14695981039346656037ULL
+
 int min(Vector* v);
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t size);
+uint64_t hash_int(uint64_t hash, long value);
+uint64_t hash_string(uint64_t hash, const char* string);
 
 #endif
@@ -3,6 +3,13 @@
 
 #include <stdbool.h>
 
+typedef enum {
+  ENGINE_WPO, // parallel, over the weak partial ordering
+  ENGINE_RECURSIVE, // Bourdoncle's recursive strategy over the weak topological ordering
+  ENGINE_WORKLIST, // priority worklist in reverse postorder
+  ENGINE_COMPARE, // runs every engine above and checks they agree
+} Engine;
+
 typedef struct Config {
   char* name;
   char* version;
@@ -13,6 +20,21 @@ typedef struct Config {
   char* jpamb_decompiled_path;
   int   threads;
   bool threads_set;
+  int   widening_delay;
+  bool widening_delay_set;
+  int   narrowing_iterations;
+  bool narrowing_iterations_set;
+  bool  sparse;
+  Engine engine; // dense fixpoint strategy, ignored by the sparse analysis
+  char* domain; // abstract domain of the dense analysis, NULL for intervals
+  bool  invariants; // keep the state before every instruction in the result
+  int   deadline; // milliseconds per method after which loops are widened at once, 0 for none
+  bool  zones; // refine the loops of the dense analysis with zones over their locals
+  int   partitions; // states kept per block by the trace partitioning of the dense analysis, 0 or 1 for none
+  int   partition_depth; // last branch outcomes that tell partitions apart
+  bool partition_depth_set;
+  char* cache; // result cache file, NULL when results are not kept between runs
+  char* stats; // fixpoint counters of a -DSTATS build are appended here, stderr if NULL
 } Config;
 
 Config* config_load();
@@ -29,5 +29,7 @@ void coverage_global_print(size_t maxBits);
 
 bool coverage_is_complete(void);
 
+void coverage_set_goal(const uint8_t* goal);
+
 
 #endif //COVERAGE_H
\ No newline at end of file
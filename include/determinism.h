@@ -0,0 +1,15 @@
+#ifndef DETERMINISM_H
+#define DETERMINISM_H
+
+#include "cli.h"
+#include "config.h"
+#include "method.h"
+
+/*
+ * Runs the abstract analysis of m under several thread counts and randomized
+ * task orders and compares every run with a sequential one. Returns SUCCESS
+ * if all of them computed the same states.
+ */
+int determinism_check(const Method* m, const Options* opts, const Config* cfg);
+
+#endif
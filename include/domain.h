@@ -0,0 +1,65 @@
+#ifndef DOMAIN_H
+#define DOMAIN_H
+
+#include "interpreter_abstract.h"
+#include "ir_instruction.h"
+
+#include <stdbool.h>
+#include <vector.h>
+
+/*
+ * Abstract domain of the dense analysis. Outside its own code a state is an
+ * opaque AbstractState, and the analysis reaches the domain through its
+ * AbstractDomain table: the context builds the entry state and the scratch
+ * arenas with it, and runs the engine instance of the domain from it.
+ *
+ * The fixpoint itself does not go through the table. include/engine_dense.h
+ * is the engine written once over the operations of a domain, and it is
+ * instantiated for every domain by defining ENGINE_DOMAIN to its name and
+ * including it (see interpreter_abstract.c): the instance calls the functions
+ * of that domain directly, so its hot loop has no indirect calls, and it
+ * defines the <name>_domain table whose run is that instance.
+ *
+ * A domain is specialized by defining DOMAIN_<name>_<op> for the types State,
+ * Slab and Arena and for the operations listed in engine_dense.h, next to its
+ * functions, and DOMAIN_<name>_passes to 1 when it has the loop acceleration,
+ * cache seeds, refinement passes and invariants hooks as well.
+ */
+typedef struct AbstractState AbstractState;
+typedef struct AbstractArena AbstractArena;
+
+typedef struct {
+    const char* name;
+
+    AbstractState* (*new_top)(int max_locals, int max_stack);
+    AbstractState* (*new_bottom)(int max_locals, int max_stack);
+    int (*copy)(AbstractState* dst, const AbstractState* src);
+    int (*set_arguments)(AbstractState* st, const Vector* types);
+    void (*delete)(AbstractState* st);
+
+    int (*join)(AbstractState* acc, const AbstractState* new, int* changed);
+    int (*widen)(AbstractState* acc, const AbstractState* new, const int* thresholds, int thresholds_count, int* changed);
+    int (*narrow)(AbstractState* acc, const AbstractState* new, int* changed);
+    bool (*leq)(const AbstractState* a, const AbstractState* b);
+
+    int (*transfer)(AbstractState* out, IrInstruction* ir);
+    int (*transfer_conditional)(AbstractState* out_true, AbstractState* out_false, IrInstruction* ir);
+
+    AbstractArena* (*arena_new)(int max_locals, int max_stack); // scratch states of one thread
+    void (*arena_delete)(AbstractArena* arena);
+
+    AbstractResult (*run)(AbstractContext* ctx); // the engine instance of the domain
+} AbstractDomain;
+
+extern const AbstractDomain interval_domain;
+extern const AbstractDomain constant_domain;
+
+const AbstractDomain* domain_find(const char* name);
+
+#define DOMAIN_PASTE_(a, b, c) a##b##c
+#define DOMAIN_PASTE(a, b, c) DOMAIN_PASTE_(a, b, c)
+#define DOMAIN_OP(domain, op) DOMAIN_PASTE(DOMAIN_, domain, _##op)
+#define DOMAIN_NAME_(domain) #domain
+#define DOMAIN_NAME(domain) DOMAIN_NAME_(domain)
+
+#endif
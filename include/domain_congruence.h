@@ -0,0 +1,36 @@
+#ifndef DOMAIN_CONGRUENCE_H
+#define DOMAIN_CONGRUENCE_H
+
+#include "domain_interval.h"
+#include "opcode.h"
+
+#include <stdbool.h>
+
+/*
+ * Congruence x = r (mod m) of an int slot, the second half of the interval
+ * states. It is packed in 16 bits: the modulus in the high byte, 1 when
+ * nothing is known, the residue 0 <= r < m in the low one. A larger modulus
+ * is weakened to its largest divisor that fits. A slot whose interval holds a
+ * single value is exact already, whatever its congruence says, so constants
+ * need no modulus of their own.
+ *
+ * The operations take each congruence with the interval of its slot.
+ */
+
+#define CONGRUENCE_TOP ((Congruence)(1 << 8))
+#define CONGRUENCE_MAX_MODULUS 255
+
+Congruence congruence_make(long modulus, long residue);
+int congruence_modulus(Congruence c);
+int congruence_residue(Congruence c);
+
+Congruence congruence_join(Interval a, Congruence ca, Interval b, Congruence cb);
+bool congruence_meet(Interval a, Congruence ca, Interval b, Congruence cb, Congruence* result);
+bool congruence_leq(Interval a, Congruence ca, Interval b, Congruence cb);
+
+Congruence congruence_binary(BinaryOperator op, Interval a, Congruence ca, Interval b, Congruence cb);
+Congruence congruence_negate(Interval a, Congruence ca);
+
+Interval congruence_reduce(Interval iv, Congruence c);
+
+#endif
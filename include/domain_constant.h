@@ -0,0 +1,98 @@
+#ifndef DOMAIN_CONSTANT_H
+#define DOMAIN_CONSTANT_H
+
+#include "domain_interval.h"
+#include "ir_instruction.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <vector.h>
+
+/*
+ * Constant propagation, a cheaper domain for the dense engine: every slot
+ * holds a single known value or any value, kept as the interval [c, c] or top,
+ * bottom for a value that cannot exist. The frame is the one of the interval
+ * states without the congruences, array elements, stack origins and stamps,
+ * in a single allocation. The lattice has height 2, so widening is a join and
+ * loops stabilize after one more pass. A branch on known values drops the
+ * edge that cannot be taken, nothing else is refined.
+ *
+ * version grows every time copy, join, widening or narrowing change the state.
+ */
+typedef struct {
+    Interval* slots; // slots[max_locals + max_stack]
+    int max_locals;
+    int max_stack;
+    int stack_len;
+    bool bottom;
+    unsigned version;
+} ConstantState;
+
+typedef struct ConstantSlab ConstantSlab;
+typedef struct ConstantArena ConstantArena;
+
+ConstantState* constant_new_top_state(int max_locals, int max_stack);
+ConstantState* constant_new_bottom_state(int max_locals, int max_stack);
+void constant_state_set_top(ConstantState* st);
+void constant_state_set_bottom(ConstantState* st);
+bool is_constant_state_bottom(const ConstantState* st);
+int constant_state_copy(ConstantState* dst, const ConstantState* src);
+int constant_state_set_arguments(ConstantState* st, const Vector* types);
+bool constant_state_leq(const ConstantState* a, const ConstantState* b);
+
+int constant_join(ConstantState* acc, const ConstantState* new, int* changed);
+int constant_widening(ConstantState* acc, const ConstantState* new, const int* thresholds, int thresholds_count, int* changed);
+int constant_narrowing(ConstantState* acc, const ConstantState* new, int* changed);
+
+int constant_transfer(ConstantState* out_state, IrInstruction* ir_instruction);
+int constant_transfer_invoke(ConstantState* out_state, ConstantState* in_state, int locals_num);
+int constant_transfer_conditional(ConstantState* out_state_true, ConstantState* out_state_false, IrInstruction* ir_instruction);
+int constant_transfer_return(ConstantState* out_state);
+
+void constant_state_print(const ConstantState* st);
+void constant_state_write(FILE* stream, const ConstantState* st);
+void constant_state_delete(ConstantState* st);
+
+ConstantSlab* constant_slab_new(int count, int max_locals, int max_stack);
+ConstantState* constant_slab_state(ConstantSlab* slab, int index);
+void constant_slab_delete(ConstantSlab* slab);
+
+ConstantArena* constant_arena_new(int max_locals, int max_stack);
+ConstantState* constant_arena_state(ConstantArena* arena);
+void constant_arena_reset(ConstantArena* arena);
+void constant_arena_delete(ConstantArena* arena);
+
+// specialization of the dense engine, see domain.h
+#define DOMAIN_constant_State ConstantState
+#define DOMAIN_constant_Slab ConstantSlab
+#define DOMAIN_constant_Arena ConstantArena
+#define DOMAIN_constant_new_top constant_new_top_state
+#define DOMAIN_constant_new_bottom constant_new_bottom_state
+#define DOMAIN_constant_set_top constant_state_set_top
+#define DOMAIN_constant_set_bottom constant_state_set_bottom
+#define DOMAIN_constant_is_bottom is_constant_state_bottom
+#define DOMAIN_constant_copy constant_state_copy
+#define DOMAIN_constant_set_arguments constant_state_set_arguments
+#define DOMAIN_constant_version(st) ((st)->version)
+#define DOMAIN_constant_project(st, local) ((st)->slots[local])
+#define DOMAIN_constant_print constant_state_print
+#define DOMAIN_constant_write constant_state_write
+#define DOMAIN_constant_delete constant_state_delete
+#define DOMAIN_constant_join constant_join
+#define DOMAIN_constant_widen constant_widening
+#define DOMAIN_constant_narrow constant_narrowing
+#define DOMAIN_constant_leq(a, b, since) constant_state_leq(a, b)
+#define DOMAIN_constant_transfer constant_transfer
+#define DOMAIN_constant_transfer_conditional constant_transfer_conditional
+#define DOMAIN_constant_transfer_invoke constant_transfer_invoke
+#define DOMAIN_constant_transfer_return constant_transfer_return
+#define DOMAIN_constant_slab_new constant_slab_new
+#define DOMAIN_constant_slab_state constant_slab_state
+#define DOMAIN_constant_slab_delete constant_slab_delete
+#define DOMAIN_constant_arena_new constant_arena_new
+#define DOMAIN_constant_arena_state constant_arena_state
+#define DOMAIN_constant_arena_reset constant_arena_reset
+#define DOMAIN_constant_arena_delete constant_arena_delete
+#define DOMAIN_constant_passes 0
+
+#endif
@@ -4,6 +4,8 @@
 #include "ir_instruction.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <vector.h>
 
 typedef struct {
@@ -11,27 +13,131 @@ typedef struct {
     int upper;
 } Interval;
 
+typedef uint16_t Congruence; // see domain_congruence.h
+
+/*
+ * Dense abstract frame: max_locals local slots followed by a stack region of
+ * max_stack slots, stack_len of which are in use. A stack slot loaded from a
+ * local remembers it in origin, so that branching on it refines the local.
+ * Every slot also has a congruence, and the interval of a slot is kept
+ * reduced by it: the states are the reduced product of both domains.
+ *
+ * A slot holding an array reference has the length of the array as interval,
+ * -1 standing for null, and the range of its elements in elements[i]. Arrays
+ * may alias, so a store joins the value into the elements of every slot; the
+ * elements of a slot that is not a known array are top.
+ *
+ * Values are kept within the range of their type where the code tells it:
+ * boolean 0..1, char 0..65535, references -1..INT_MAX. The arguments start
+ * there, and typed loads, stores and array accesses stay there.
+ *
+ * version grows every time copy, join, widening or narrowing change the state,
+ * and stamp[i] is the version that last changed slot i, its elements or its
+ * congruence.
+ *
+ * Slots, congruences and origins are on a page shared by the copies of the
+ * state: code writing through these pointers calls interval_state_own first.
+ */
+typedef struct IntervalPage IntervalPage;
+
+#define ARRAY_NULL (-1) // interval of a null reference
+
 typedef struct {
-    Vector* locals; // Vector<int>
-    Vector* stack; // Vector<int>
-    Vector* env; // Vector<Interval>
+    IntervalPage* page;
+    IntervalPage* spare; // arena states keep the last page they had to themselves
+    Interval* slots;
+    Interval* elements; // elements[max_locals + max_stack]
+    Congruence* congruence; // congruence[max_locals + max_stack]
+    unsigned* stamp;
+    int* origin; // origin[max_stack], -1 if the value is not a copy of a local
+    int max_locals;
+    int max_stack;
+    int stack_len;
+    bool bottom; // unreachable, a state without slots can still be reachable
+    bool scratch; // taken from an arena, see interval_arena_state
+    unsigned version;
 } IntervalState;
 
-IntervalState* interval_new_top_state(int num_vars);
-IntervalState* interval_new_bottom_state(int num_locals);
+typedef struct IntervalSlab IntervalSlab;
+typedef struct IntervalArena IntervalArena;
+
+Interval interval_top(void);
+Interval interval_bottom(void);
+bool is_interval_bottom(Interval iv);
+Interval interval_join_single(Interval a, Interval b);
+Interval interval_widen_single(Interval old, Interval newer, const int* thresholds, int thresholds_count);
+Interval interval_narrow_single(Interval old, Interval newer);
+int interval_binary(BinaryOperator op, Interval a, Interval b, Interval* result);
+Interval interval_negate(Interval a);
+int interval_branch(IfCondition condition, Interval* x, Interval* y, Interval* true_branch, Interval* false_branch);
+Interval interval_type_range(const Type* type);
+
+IntervalState* interval_new_top_state(int max_locals, int max_stack);
+IntervalState* interval_new_bottom_state(int max_locals, int max_stack);
+void interval_state_set_top(IntervalState* st);
+void interval_state_set_bottom(IntervalState* st);
 int interval_state_copy(IntervalState* dst, const IntervalState* src);
+int interval_state_own(IntervalState* st);
+int interval_state_set_arguments(IntervalState* st, const Vector* types);
 bool is_interval_state_bottom(const IntervalState* state);
+bool interval_state_leq(const IntervalState* a, const IntervalState* b);
+bool interval_state_leq_since(const IntervalState* a, const IntervalState* b, unsigned since);
 
 int interval_join(IntervalState* acc, const IntervalState* new, int* changed);
 int interval_intersection(IntervalState* acc, const IntervalState* constraint, int* changed);
 
 int interval_widening(IntervalState* acc, const IntervalState* new, int* changed);
+int interval_widening_thresholds(IntervalState* acc, const IntervalState* new, const int* thresholds, int thresholds_count, int* changed);
+int interval_narrowing(IntervalState* acc, const IntervalState* new, int* changed);
 
 int interval_transfer(IntervalState* out_state, IrInstruction* ir_instruction);
 int interval_transfer_invoke(IntervalState* out_state, IntervalState* in_state, int locals_num);
 int interval_transfer_conditional(IntervalState* out_state_true, IntervalState* out_state_false, IrInstruction* ir_instruction);
+int interval_transfer_return(IntervalState* out_state);
 
 void interval_state_print(const IntervalState* st);
+void interval_state_write(FILE* stream, const IntervalState* st);
 void interval_state_delete(IntervalState* st);
 
+IntervalSlab* interval_slab_new(int count, int max_locals, int max_stack);
+IntervalState* interval_slab_state(IntervalSlab* slab, int index);
+void interval_slab_delete(IntervalSlab* slab);
+
+IntervalArena* interval_arena_new(int max_locals, int max_stack);
+IntervalState* interval_arena_state(IntervalArena* arena);
+void interval_arena_reset(IntervalArena* arena);
+void interval_arena_delete(IntervalArena* arena);
+
+// specialization of the dense engine, see domain.h
+#define DOMAIN_interval_State IntervalState
+#define DOMAIN_interval_Slab IntervalSlab
+#define DOMAIN_interval_Arena IntervalArena
+#define DOMAIN_interval_new_top interval_new_top_state
+#define DOMAIN_interval_new_bottom interval_new_bottom_state
+#define DOMAIN_interval_set_top interval_state_set_top
+#define DOMAIN_interval_set_bottom interval_state_set_bottom
+#define DOMAIN_interval_is_bottom is_interval_state_bottom
+#define DOMAIN_interval_copy interval_state_copy
+#define DOMAIN_interval_set_arguments interval_state_set_arguments
+#define DOMAIN_interval_version(st) ((st)->version)
+#define DOMAIN_interval_project(st, local) ((st)->slots[local])
+#define DOMAIN_interval_print interval_state_print
+#define DOMAIN_interval_write interval_state_write
+#define DOMAIN_interval_delete interval_state_delete
+#define DOMAIN_interval_join interval_join
+#define DOMAIN_interval_widen interval_widening_thresholds
+#define DOMAIN_interval_narrow interval_narrowing
+#define DOMAIN_interval_leq interval_state_leq_since
+#define DOMAIN_interval_transfer interval_transfer
+#define DOMAIN_interval_transfer_conditional interval_transfer_conditional
+#define DOMAIN_interval_transfer_invoke interval_transfer_invoke
+#define DOMAIN_interval_transfer_return interval_transfer_return
+#define DOMAIN_interval_slab_new interval_slab_new
+#define DOMAIN_interval_slab_state interval_slab_state
+#define DOMAIN_interval_slab_delete interval_slab_delete
+#define DOMAIN_interval_arena_new interval_arena_new
+#define DOMAIN_interval_arena_state interval_arena_state
+#define DOMAIN_interval_arena_reset interval_arena_reset
+#define DOMAIN_interval_arena_delete interval_arena_delete
+
 #endif
@@ -0,0 +1,81 @@
+#ifndef DOMAIN_ZONE_H
+#define DOMAIN_ZONE_H
+
+#include "domain_interval.h"
+#include "ir_function.h"
+#include "ir_instruction.h"
+
+#include <limits.h>
+#include <stdbool.h>
+
+/*
+ * Zone over a few variables: a difference bound matrix where m[i * size + j]
+ * bounds v_j - v_i from above, ZONE_INF when unbounded. Variable 0 is the
+ * constant 0, so the first row and column hold the bounds of each variable.
+ * Operations keep the matrix closed (every bound is the tightest implied one)
+ * except widening, whose result is left as is so that iterations stop.
+ */
+
+#define ZONE_INF (LONG_MAX / 4)
+
+typedef struct {
+    int size; // variables + 1
+    bool bottom;
+    bool closed;
+    long* m;
+} Zone;
+
+Zone* zone_new(int vars);
+void zone_set_top(Zone* z);
+void zone_set_bottom(Zone* z);
+int zone_copy(Zone* dst, const Zone* src);
+void zone_close(Zone* z);
+void zone_add(Zone* z, int i, int j, long c);
+void zone_forget(Zone* z, int v);
+void zone_assign(Zone* z, int v, int w, long c);
+void zone_shift(Zone* z, int v, long c);
+void zone_range(Zone* z, int p, int m, long* lower, long* upper);
+int zone_join(Zone* acc, const Zone* z, int* changed);
+int zone_widen(Zone* acc, const Zone* z, int* changed);
+void zone_print(const Zone* z);
+void zone_delete(Zone* z);
+
+/*
+ * Locals are packed in clusters, the locals related by an assignment or a
+ * comparison in the analyzed code, with a zone per cluster: relations are only
+ * kept where the code can produce them, and a local in no cluster is left to
+ * the intervals.
+ */
+typedef struct ZonePacking ZonePacking;
+
+ZonePacking* zone_packing_new(int num_locals);
+void zone_packing_scan(ZonePacking* packing, const IrFunction* function, int ip_start, int ip_end);
+int zone_packing_seal(ZonePacking* packing);
+void zone_packing_delete(ZonePacking* packing);
+
+/*
+ * Zones of a frame, with the stack as linear forms of the locals (v_p - v_m +
+ * c) so that a comparison or a store can be turned into constraints. A state
+ * follows an interval state of the same program point, which gives the bounds
+ * of what the zones do not know and receives theirs through reduce.
+ */
+typedef struct ZoneState ZoneState;
+
+ZoneState* zone_state_new(const ZonePacking* packing, int max_stack);
+ZoneState* zone_state_clone(const ZoneState* zs);
+void zone_state_set_bottom(ZoneState* zs);
+bool is_zone_state_bottom(const ZoneState* zs);
+int zone_state_copy(ZoneState* dst, const ZoneState* src);
+void zone_state_from_intervals(ZoneState* zs, const IntervalState* st);
+void zone_state_meet_intervals(ZoneState* zs, const IntervalState* st);
+int zone_state_join(ZoneState* acc, const ZoneState* zs, int* changed);
+int zone_state_widen(ZoneState* acc, const ZoneState* zs, int* changed);
+
+void zone_state_transfer(ZoneState* zs, const IntervalState* before, const IntervalState* after, IrInstruction* ir);
+void zone_state_branch(ZoneState* zs_true, ZoneState* zs_false, IrInstruction* ir);
+void zone_state_reduce(ZoneState* zs, IntervalState* st, IntervalState* scratch);
+
+void zone_state_print(const ZoneState* zs);
+void zone_state_delete(ZoneState* zs);
+
+#endif
@@ -0,0 +1,892 @@
+/*
+ * Dense fixpoint engine over the operations of one abstract domain. It has no
+ * include guard: interpreter_abstract.c includes it once per domain with
+ * ENGINE_DOMAIN defined to the name of the domain, after the helpers of the
+ * context it relies on, and every inclusion defines engine_<name>_* functions
+ * calling the DOMAIN_<name>_<op> functions directly, and the <name>_domain
+ * table of domain.h.
+ *
+ * A domain gives the types State, Slab and Arena and these operations:
+ *   states     new_top, new_bottom, set_top, set_bottom, is_bottom, copy,
+ *              set_arguments, version, project, print, write, delete
+ *   lattice    join, widen (with thresholds), narrow, leq (since a version)
+ *   transfer   transfer, transfer_conditional, transfer_invoke, transfer_return
+ *   storage    slab_new, slab_state, slab_delete, arena_new, arena_state,
+ *              arena_reset, arena_delete
+ *
+ * version must grow whenever copy, join, widen or narrow change a state: the
+ * engine skips the inputs whose version did not move. A domain with passes
+ * set also gives load_seeds and seed for the head states of the cache,
+ * accelerate for its loop heads, cache for its result, and Passes with
+ * passes_new, passes_refine, passes_record and passes_delete for the
+ * refinements run once the fixpoint is reached and the invariants.
+ */
+
+#ifndef ENGINE_DOMAIN
+#error "ENGINE_DOMAIN must name the domain the engine is instantiated for"
+#endif
+
+#define ENGINE_CALL(op) DOMAIN_OP(ENGINE_DOMAIN, op)
+#define ENGINE_FN(name) DOMAIN_PASTE(engine_, ENGINE_DOMAIN, _##name)
+#define ENGINE_STATE ENGINE_CALL(State)
+#define ENGINE_PASSES ENGINE_CALL(passes)
+
+// scratch states of the thread running the visit
+static ENGINE_CALL(Arena) * ENGINE_FN(arena)(AbstractContext* ctx)
+{
+    return (ENGINE_CALL(Arena)*)thread_arena(ctx);
+}
+
+/*
+ * Join of the states on the cfg edges entering node, written to state. The
+ * method entry is reached with unknown arguments of the declared types.
+ */
+static void ENGINE_FN(join_predecessors)(ENGINE_STATE* state, int node, AbstractContext* ctx, ENGINE_STATE** X_edge)
+{
+    int dummy = 0;
+
+    if (node != 0) {
+        ENGINE_CALL(set_bottom)(state);
+    } else if (ctx->entry) {
+        ENGINE_CALL(copy)(state, (ENGINE_STATE*)ctx->entry);
+    } else {
+        ENGINE_CALL(set_top)(state);
+    }
+
+    Vector* predecessors = ctx->predecessors[node];
+    for (size_t i = 0; i < vector_length(predecessors); i++) {
+        FlowEdge* edge = vector_get(predecessors, i);
+        ENGINE_CALL(join)(state, X_edge[2 * edge->source + edge->index], &dummy);
+        STATS_RECORD(stats_event(ctx->stats, ctx->wpo.node_to_component[node], EVENT_JOIN));
+    }
+}
+
+/*
+ * Recomputes X_in of node from its predecessors, unless none of their edge
+ * states changed since the last time.
+ */
+static void ENGINE_FN(pull_in)(int node, int force, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_edge)
+{
+    Vector* predecessors = ctx->predecessors[node];
+    int stale = force || node == 0;
+
+    for (size_t i = 0; i < vector_length(predecessors) && !stale; i++) {
+        FlowEdge* edge = vector_get(predecessors, i);
+        stale = edge->seen != ENGINE_CALL(version)(X_edge[2 * edge->source + edge->index]);
+    }
+
+    if (!stale) {
+        return;
+    }
+
+    ENGINE_STATE* joined = ENGINE_CALL(arena_state)(ENGINE_FN(arena)(ctx));
+    ENGINE_FN(join_predecessors)(joined, node, ctx, X_edge);
+    ENGINE_CALL(copy)(X_in[node], joined);
+
+    for (size_t i = 0; i < vector_length(predecessors); i++) {
+        FlowEdge* edge = vector_get(predecessors, i);
+        edge->seen = ENGINE_CALL(version)(X_edge[2 * edge->source + edge->index]);
+    }
+}
+
+/*
+ * A component is entered through its head: the first visit of a round takes
+ * the entry state, the following ones keep what the exit stored in X_in.
+ */
+static void ENGINE_FN(load_in)(int current_node, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_edge)
+{
+    if (is_component_head(ctx, current_node)) {
+        int component_id = ctx->wpo.node_to_component[current_node];
+        if (ctx->phase[component_id] != PHASE_START) {
+            return;
+        }
+
+        ctx->phase[component_id] = PHASE_ASCENDING;
+#pragma omp atomic write
+        ctx->loop_iteration[component_id] = 0;
+        ctx->checked_version[component_id] = 0;
+
+        ENGINE_FN(pull_in)(current_node, 1, ctx, X_in, X_edge);
+#if ENGINE_PASSES
+        ENGINE_CALL(seed)(current_node, ctx, X_in);
+        ENGINE_CALL(accelerate)(current_node, ctx, X_in[current_node], X_in[current_node]);
+#endif
+        return;
+    }
+
+    ENGINE_FN(pull_in)(current_node, 0, ctx, X_in, X_edge);
+}
+
+// out is a scratch state, the edge states are only written through a copy
+static void ENGINE_FN(apply_last)(IrInstruction* last,
+    ENGINE_STATE* out,
+    ENGINE_STATE** X_edge,
+    int current_node,
+    AbstractContext* ctx)
+{
+    ENGINE_CALL(Arena)* arena = ENGINE_FN(arena)(ctx);
+    ENGINE_STATE** edge = &X_edge[2 * current_node];
+
+    if (ir_instruction_is_conditional(last)) {
+        ENGINE_STATE* out_true = ENGINE_CALL(arena_state)(arena);
+        ENGINE_STATE* out_false = ENGINE_CALL(arena_state)(arena);
+
+        ENGINE_CALL(copy)(out_true, out);
+        ENGINE_CALL(copy)(out_false, out);
+
+        ENGINE_CALL(transfer_conditional)(out_true, out_false, last);
+
+        // cfg_build pushes the branch target first and the fall through second
+        ENGINE_CALL(copy)(edge[0], out_true);
+        ENGINE_CALL(copy)(edge[1], out_false);
+    } else if (last->opcode == OP_INVOKE) {
+        Node* node = vector_get(ctx->flow->nodes, current_node);
+        int invoke_head = *(int*)vector_get(node->successors, 0);
+        ENGINE_STATE* callee = ENGINE_CALL(arena_state)(arena);
+
+        ENGINE_CALL(transfer_invoke)(callee, out, block_num_locals(ctx, invoke_head));
+        ENGINE_CALL(copy)(edge[0], callee);
+    } else {
+        if (last->opcode == OP_RETURN) {
+            ENGINE_CALL(transfer_return)(out);
+        } else {
+            ENGINE_CALL(transfer)(out, last);
+        }
+
+        ENGINE_CALL(copy)(edge[0], out);
+    }
+}
+
+static int ENGINE_FN(apply_f)(int current_node, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    ENGINE_STATE* in = X_in[current_node];
+
+    // same input, X_out and the edge states are still up to date
+    if (ctx->applied[current_node] == ENGINE_CALL(version)(in)) {
+        return SUCCESS;
+    }
+
+    ctx->applied[current_node] = ENGINE_CALL(version)(in);
+
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, current_node);
+    IrInstruction* last = *(IrInstruction**)vector_get(block->ir_function->ir_instructions,
+        block->ip_end);
+
+    // unreachable in this round, the edges must not keep older states
+    if (ENGINE_CALL(is_bottom)(in)) {
+        ENGINE_CALL(copy)(X_out[current_node], in);
+        ENGINE_CALL(set_bottom)(X_edge[2 * current_node]);
+        ENGINE_CALL(set_bottom)(X_edge[2 * current_node + 1]);
+        return SUCCESS;
+    }
+
+    ENGINE_STATE* out = ENGINE_CALL(arena_state)(ENGINE_FN(arena)(ctx));
+    ENGINE_CALL(copy)(out, in);
+
+    for (int ip = block->ip_start; ip < block->ip_end; ip++) {
+        IrInstruction* ir = *(IrInstruction**)
+                                vector_get(block->ir_function->ir_instructions, ip);
+        ENGINE_CALL(transfer)(out, ir);
+    }
+
+    ENGINE_FN(apply_last)(last, out, X_edge, current_node, ctx);
+    ENGINE_CALL(copy)(X_out[current_node], out);
+
+    return SUCCESS;
+}
+
+/*
+ * Feeds the state reaching the exit of a non stabilized component back into its
+ * head. The first widening_delay iterations join, then the head is widened up
+ * to the next threshold of the loop.
+ */
+static void ENGINE_FN(update_loop_head)(int exit_node, int loop_head, AbstractContext* ctx, ENGINE_STATE** X_in)
+{
+    int component_id = ctx->wpo.node_to_component[exit_node];
+    int iteration;
+#pragma omp atomic capture
+    iteration = ctx->loop_iteration[component_id]++;
+    int dummy = 0;
+
+    if (deadline_expired(ctx)) {
+        // no thresholds, an unstable bound goes to infinity and stays there
+        STATS_RECORD(stats_event(ctx->stats, component_id, EVENT_WIDENING));
+
+        ENGINE_STATE* joined = ENGINE_CALL(arena_state)(ENGINE_FN(arena)(ctx));
+
+        ENGINE_CALL(copy)(joined, X_in[loop_head]);
+        ENGINE_CALL(join)(joined, X_in[exit_node], &dummy);
+        ENGINE_CALL(widen)(X_in[loop_head], joined, NULL, 0, &dummy);
+    } else if (iteration < ctx->widening_delay[component_id]) {
+        ENGINE_CALL(join)(X_in[loop_head], X_in[exit_node], &dummy);
+#if ENGINE_PASSES
+        ENGINE_CALL(accelerate)(loop_head, ctx, X_in[loop_head], X_in[loop_head]);
+#endif
+        STATS_RECORD(stats_event(ctx->stats, component_id, EVENT_JOIN));
+    } else {
+        STATS_RECORD(stats_event(ctx->stats, component_id, EVENT_WIDENING));
+
+        Vector* thresholds = ctx->thresholds[component_id];
+        ENGINE_STATE* joined = ENGINE_CALL(arena_state)(ENGINE_FN(arena)(ctx));
+
+        ENGINE_CALL(copy)(joined, X_in[loop_head]);
+        ENGINE_CALL(join)(joined, X_in[exit_node], &dummy);
+
+#if ENGINE_PASSES
+        // accelerated bounds are already final, widening leaves them alone
+        ENGINE_CALL(accelerate)(loop_head, ctx, joined, X_in[loop_head]);
+#endif
+        ENGINE_CALL(widen)(X_in[loop_head], joined, vector_get(thresholds, 0), vector_length(thresholds), &dummy);
+    }
+}
+
+/*
+ * Descending step on a stabilized component: the head is refined with its
+ * entry state joined with what the last iteration brought back. Returns 1 if
+ * the head changed and the component has to be recomputed.
+ */
+static int ENGINE_FN(narrow_loop_head)(int exit_node, int loop_head, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_edge)
+{
+    int dummy = 0;
+    int changed = 0;
+
+    ENGINE_STATE* next = ENGINE_CALL(arena_state)(ENGINE_FN(arena)(ctx));
+
+    ENGINE_FN(join_predecessors)(next, loop_head, ctx, X_edge);
+    ENGINE_CALL(join)(next, X_in[exit_node], &dummy);
+
+    ENGINE_CALL(narrow)(X_in[loop_head], next, &changed);
+    STATS_RECORD(stats_event(ctx->stats, ctx->wpo.node_to_component[exit_node], EVENT_NARROWING));
+
+    return changed;
+}
+
+/*
+ * After a failed check the head is updated to cover the exit state, and while
+ * ascending it only grows: only the exit slots changed since then need to be
+ * compared, and none at all if the exit state did not change.
+ */
+static int ENGINE_FN(is_component_stabilized)(int current_node, AbstractContext* ctx, ENGINE_STATE** X_in)
+{
+    int component_id = ctx->wpo.node_to_component[current_node];
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    unsigned checked = ctx->checked_version[component_id];
+
+    if (checked && ENGINE_CALL(version)(X_in[current_node]) == checked) {
+        return 1;
+    }
+
+    // holds as well when nothing reached the back edges
+    return ENGINE_CALL(leq)(X_in[current_node], X_in[head], checked);
+}
+
+/*
+ * Decides what happens to the component of exit_node once an iteration of it
+ * is over. Returns 1 if the component has to be iterated again: it did not
+ * stabilize yet, or the descending phase refined its head.
+ */
+static int ENGINE_FN(update_component)(int exit_node, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_edge)
+{
+    int component_id = ctx->wpo.node_to_component[exit_node];
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+
+    if (ctx->phase[component_id] == PHASE_ASCENDING) {
+        if (!ENGINE_FN(is_component_stabilized)(exit_node, ctx, X_in)) {
+            ctx->checked_version[component_id] = ENGINE_CALL(version)(X_in[exit_node]);
+            ENGINE_FN(update_loop_head)(exit_node, head, ctx, X_in);
+            return 1;
+        }
+
+        ctx->phase[component_id] = PHASE_DESCENDING;
+        ctx->narrowing_left[component_id] = ctx->narrowing_iterations;
+        STATS_RECORD(stats_stabilized(ctx->stats, component_id, ctx->loop_iteration[component_id]));
+    }
+
+    // the body states stay the ones computed from the current head
+    if (ctx->narrowing_left[component_id] > 0 && !deadline_expired(ctx) && ENGINE_FN(narrow_loop_head)(exit_node, head, ctx, X_in, X_edge)) {
+        ctx->narrowing_left[component_id]--;
+        return 1;
+    }
+
+    ctx->phase[component_id] = PHASE_START;
+    return 0;
+}
+
+static void ENGINE_FN(process_node_task)(int current_node, AbstractContext* ctx,
+    int* N, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge,
+    omp_lock_t* locks)
+{
+    if (N[current_node] == ctx->wpo.num_sched_pred[current_node]) {
+        schedule_jitter(ctx, current_node);
+
+        // spawned tasks are deferred, they are not counted in the time of this one
+        STATS_START(task_timer);
+        STATS_RECORD(stats_visit(ctx->stats, current_node));
+
+        /*** NonExit ***/
+        if (current_node < ctx->block_count) {
+            ENGINE_FN(load_in)(current_node, ctx, X_in, X_edge);
+
+            STATS_START(transfer_timer);
+            ENGINE_FN(apply_f)(current_node, ctx, X_in, X_out, X_edge);
+            STATS_STOP(ctx->stats, TIME_TRANSFER, transfer_timer);
+
+            ENGINE_CALL(arena_reset)(ENGINE_FN(arena)(ctx));
+
+            lock_node(ctx, locks, current_node);
+            N[current_node] = 0;
+            omp_unset_lock(&locks[current_node]);
+
+            /*** update scheduling successors ***/
+            Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
+            size_t count = vector_length(node->successors);
+            size_t offset = schedule_offset(ctx, current_node, count);
+
+            for (size_t k = 0; k < count; k++) {
+                int successor = *(int*)vector_get(node->successors, (k + offset) % count);
+
+                /*** CRITICAL SECTION ***/
+                lock_node(ctx, locks, successor);
+
+                N[successor]++;
+                int ready = (N[successor] == ctx->wpo.num_sched_pred[successor]);
+
+                omp_unset_lock(&locks[successor]);
+                /*** END CRITICAL SECTION ***/
+
+                if (ready) {
+#pragma omp task
+                    ENGINE_FN(process_node_task)(successor, ctx, N, X_in, X_out, X_edge, locks);
+                }
+            }
+        }
+        /*** Exit ***/
+        else {
+            ENGINE_FN(pull_in)(current_node, 0, ctx, X_in, X_edge);
+            ENGINE_CALL(copy)(X_out[current_node], X_in[current_node]);
+
+            lock_node(ctx, locks, current_node);
+            N[current_node] = 0;
+            omp_unset_lock(&locks[current_node]);
+
+            int iterate = ENGINE_FN(update_component)(current_node, ctx, X_in, X_edge);
+            ENGINE_CALL(arena_reset)(ENGINE_FN(arena)(ctx));
+
+            if (!iterate) {
+                Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
+                int exit_component = ctx->wpo.node_to_component[current_node];
+                int head = *(int*)vector_get(ctx->wpo.heads, exit_component);
+
+                size_t count = vector_length(node->successors);
+                size_t offset = schedule_offset(ctx, current_node, count);
+
+                for (size_t k = 0; k < count; k++) {
+                    int successor = *(int*)vector_get(node->successors, (k + offset) % count);
+                    if (successor != head) {
+
+                        /*** CRITICAL SECTION ***/
+                        lock_node(ctx, locks, successor);
+
+                        N[successor]++;
+                        int ready = (N[successor] == ctx->wpo.num_sched_pred[successor]);
+
+                        omp_unset_lock(&locks[successor]);
+                        /*** END CRITICAL SECTION ***/
+
+                        if (ready) {
+#pragma omp task
+                            ENGINE_FN(process_node_task)(successor, ctx, N, X_in, X_out, X_edge, locks);
+                        }
+                    }
+                }
+            } else {
+                // set n for component
+                int component_id = ctx->wpo.node_to_component[current_node];
+                C* component = vector_get(ctx->wpo.Cx, component_id);
+                Vector* component_nodes = component->components;
+
+                size_t count = vector_length(component_nodes);
+                size_t offset = schedule_offset(ctx, current_node, count);
+
+                for (size_t k = 0; k < count; k++) {
+                    int node = *(int*)vector_get(component_nodes, (k + offset) % count);
+                    lock_node(ctx, locks, node);
+                    N[node] = ctx->wpo.num_outer_sched_pred[component_id][node];
+
+                    int ready = (N[node] == ctx->wpo.num_sched_pred[node]);
+                    omp_unset_lock(&locks[node]);
+
+                    if (ready) {
+#pragma omp task
+                        ENGINE_FN(process_node_task)(node, ctx, N, X_in, X_out, X_edge, locks);
+                    }
+                }
+            }
+        }
+
+        STATS_STOP(ctx->stats, TIME_TASK, task_timer);
+    }
+}
+
+static void ENGINE_FN(solve_wpo)(AbstractContext* ctx, int* N, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge, omp_lock_t* node_locks)
+{
+    STATS_START(run_timer);
+
+    if (omp_in_parallel()) {
+        // batch analyses share the enclosing team
+#pragma omp taskgroup
+        {
+#pragma omp task
+            {
+                ENGINE_FN(process_node_task)(0, ctx, N, X_in, X_out, X_edge, node_locks);
+            }
+        }
+    } else {
+        int threads = ctx->threads ? ctx->threads : omp_get_max_threads();
+
+#pragma omp parallel num_threads(threads)
+        {
+#pragma omp single
+            {
+#pragma omp task
+                {
+                    ENGINE_FN(process_node_task)(0, ctx, N, X_in, X_out, X_edge, node_locks);
+                }
+            }
+        }
+    }
+
+    STATS_RECORD(stats_dump(ctx->stats, ctx->stats_path, omp_get_wtime() - run_timer));
+}
+
+static void ENGINE_FN(visit_block)(int node, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    ENGINE_FN(load_in)(node, ctx, X_in, X_edge);
+    ENGINE_FN(apply_f)(node, ctx, X_in, X_out, X_edge);
+    ENGINE_CALL(arena_reset)(ENGINE_FN(arena)(ctx));
+}
+
+// returns 1 if the component has to be iterated again
+static int ENGINE_FN(visit_exit)(int node, AbstractContext* ctx, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    ENGINE_FN(pull_in)(node, 0, ctx, X_in, X_edge);
+    ENGINE_CALL(copy)(X_out[node], X_in[node]);
+
+    int iterate = ENGINE_FN(update_component)(node, ctx, X_in, X_edge);
+    ENGINE_CALL(arena_reset)(ENGINE_FN(arena)(ctx));
+
+    return iterate;
+}
+
+static void ENGINE_FN(recursive_elements)(AbstractContext* ctx, const Wto* wto, int level, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge);
+
+/*
+ * Bourdoncle's recursive strategy: a component iterates its head and its
+ * elements, nested components stabilized in turn, until its exit stops it.
+ */
+static void ENGINE_FN(recursive_component)(AbstractContext* ctx, const Wto* wto, int component_id, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    int exit = *(int*)vector_get(ctx->wpo.exits, component_id);
+
+    do {
+        ENGINE_FN(visit_block)(head, ctx, X_in, X_out, X_edge);
+        ENGINE_FN(recursive_elements)(ctx, wto, component_id, X_in, X_out, X_edge);
+    } while (ENGINE_FN(visit_exit)(exit, ctx, X_in, X_out, X_edge));
+}
+
+static void ENGINE_FN(recursive_elements)(AbstractContext* ctx, const Wto* wto, int level, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    for (size_t i = 0; i < vector_length(wto->elements[level]); i++) {
+        int element = *(int*)vector_get(wto->elements[level], i);
+
+        if (element >= 0) {
+            ENGINE_FN(visit_block)(element, ctx, X_in, X_out, X_edge);
+        } else {
+            ENGINE_FN(recursive_component)(ctx, wto, -element - 1, X_in, X_out, X_edge);
+        }
+    }
+}
+
+static void ENGINE_FN(solve_recursive)(AbstractContext* ctx, const Wto* wto, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    ENGINE_FN(recursive_elements)(ctx, wto, vector_length(ctx->wpo.Cx), X_in, X_out, X_edge);
+}
+
+// see push_node
+static void ENGINE_FN(solve_worklist)(AbstractContext* ctx, const Wto* wto, ENGINE_STATE** X_in, ENGINE_STATE** X_out, ENGINE_STATE** X_edge)
+{
+    bool* queued = malloc(sizeof(bool) * wto->count);
+    if (!queued) {
+        return;
+    }
+
+    for (int i = 0; i < wto->count; i++) {
+        queued[i] = true;
+    }
+
+    int lowest = 0;
+    while (lowest < wto->count) {
+        if (!queued[lowest]) {
+            lowest++;
+            continue;
+        }
+
+        queued[lowest] = false;
+        int node = wto->order[lowest];
+        int component_id = ctx->wpo.node_to_component[node];
+
+        if (node >= ctx->block_count) {
+            if (ENGINE_FN(visit_exit)(node, ctx, X_in, X_out, X_edge)) {
+                push_node(wto, queued, &lowest, *(int*)vector_get(ctx->wpo.heads, component_id));
+            }
+            continue;
+        }
+
+        unsigned versions[2] = { ENGINE_CALL(version)(X_edge[2 * node]), ENGINE_CALL(version)(X_edge[2 * node + 1]) };
+        ENGINE_FN(visit_block)(node, ctx, X_in, X_out, X_edge);
+
+        // the exit decides whether the component iterates again
+        if (is_component_head(ctx, node)) {
+            push_node(wto, queued, &lowest, *(int*)vector_get(ctx->wpo.exits, component_id));
+        }
+
+        if (versions[0] == ENGINE_CALL(version)(X_edge[2 * node]) && versions[1] == ENGINE_CALL(version)(X_edge[2 * node + 1])) {
+            continue;
+        }
+
+        Node* flow_node = vector_get(ctx->flow->nodes, node);
+        for (size_t i = 0; i < vector_length(flow_node->successors); i++) {
+            push_node(wto, queued, &lowest, *(int*)vector_get(flow_node->successors, i));
+        }
+    }
+
+    free(queued);
+}
+
+static char* ENGINE_FN(canonical)(const ENGINE_STATE* st)
+{
+    char* text = NULL;
+    size_t size = 0;
+    FILE* stream = open_memstream(&text, &size);
+    if (!stream) {
+        return NULL;
+    }
+
+    ENGINE_CALL(write)(stream, st);
+
+    fclose(stream);
+    return text;
+}
+
+static AbstractResult ENGINE_FN(run_dense)(AbstractContext* ctx)
+{
+    AbstractResult result = { 0 };
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    Wto wto = { 0 };
+
+    int* N = calloc(nodes_num, sizeof(int));
+    ENGINE_STATE** X_in = calloc(nodes_num, sizeof(ENGINE_STATE*));
+    ENGINE_STATE** X_out = calloc(nodes_num, sizeof(ENGINE_STATE*));
+    ENGINE_STATE** X_edge = calloc(2 * nodes_num, sizeof(ENGINE_STATE*)); // per cfg edge out of a node
+
+    // X_in, X_out and X_edge states, in this order
+    ENGINE_CALL(Slab)* slab = ENGINE_CALL(slab_new)(4 * nodes_num, ctx->max_locals, ctx->max_stack);
+
+#if ENGINE_PASSES
+    ENGINE_CALL(Passes) passes = { 0 };
+    int passes_failed = ENGINE_CALL(passes_new)(ctx, &passes);
+#else
+    int passes_failed = 0;
+#endif
+
+    omp_lock_t* node_locks = malloc(sizeof(omp_lock_t) * nodes_num);
+    for (int i = 0; node_locks && i < nodes_num; i++) {
+        omp_init_lock(&node_locks[i]);
+    }
+
+    if (!N || !X_in || !X_out || !X_edge || !slab || passes_failed || !node_locks) {
+        goto cleanup;
+    }
+
+#ifdef DEBUG
+    for (int i = 0; i < nodes_num; i++) {
+        LOG_DEBUG("NODE %d, COMPONENT %d", i, ctx->wpo.node_to_component[i]);
+    }
+#endif
+
+    /*** INIT ***/
+    BasicBlock* entry_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, 0);
+
+    // the entry state is built when node 0 pulls its input
+    for (int i = 0; i < nodes_num; i++) {
+        X_in[i] = ENGINE_CALL(slab_state)(slab, i);
+        X_out[i] = ENGINE_CALL(slab_state)(slab, nodes_num + i);
+        X_edge[2 * i] = ENGINE_CALL(slab_state)(slab, 2 * nodes_num + 2 * i);
+        X_edge[2 * i + 1] = ENGINE_CALL(slab_state)(slab, 2 * nodes_num + 2 * i + 1);
+    }
+
+    reset_run(ctx);
+
+    if (ctx->engine == ENGINE_WPO) {
+        ENGINE_FN(solve_wpo)(ctx, N, X_in, X_out, X_edge, node_locks);
+    } else if (wto_build(ctx, &wto) == SUCCESS) {
+        if (ctx->engine == ENGINE_RECURSIVE) {
+            ENGINE_FN(solve_recursive)(ctx, &wto, X_in, X_out, X_edge);
+        } else {
+            ENGINE_FN(solve_worklist)(ctx, &wto, X_in, X_out, X_edge);
+        }
+        wto_delete(ctx, &wto);
+    } else {
+        LOG_ERROR("While building the weak topological ordering");
+        goto cleanup;
+    }
+
+#if ENGINE_PASSES
+    // past the deadline the analysis ends as soon as it can
+    if (!ctx->expired) {
+        ENGINE_CALL(passes_refine)(ctx, &passes, X_in, X_out, X_edge);
+    }
+#endif
+
+#ifdef DEBUG
+    LOG_INFO("RESULTS:");
+    for (int i = 0; i < nodes_num; i++) {
+        LOG_INFO("NODE %d", i);
+        ENGINE_CALL(print)(X_out[i]);
+    }
+#endif
+
+    int num_locals = entry_block->num_locals;
+    result = abstract_result_new(num_locals);
+
+    for (int i = 0; i < ctx->block_count; i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
+
+        if (entry_block->ir_function == block->ir_function) {
+            for (int j = 0; j < num_locals; j++) {
+                Interval value = ENGINE_CALL(project)(X_out[i], j);
+                vector_push(result.results[j], &value);
+            }
+        }
+    }
+
+    result.degraded = ctx->expired;
+
+#if ENGINE_PASSES
+    if (ctx->invariants) {
+        result.invariants = ENGINE_CALL(passes_record)(ctx, &passes, X_in);
+    }
+
+    ENGINE_CALL(cache)(ctx, &result, X_in);
+#else
+    cache_result(ctx, &result, NULL);
+#endif
+
+    for (int i = 0; ctx->record && i < nodes_num; i++) {
+        char* state = ENGINE_FN(canonical)(X_out[i]);
+        vector_push(ctx->record, &state);
+    }
+
+cleanup:
+    for (int i = 0; node_locks && i < nodes_num; i++) {
+        omp_destroy_lock(&node_locks[i]);
+    }
+    free(node_locks);
+
+    free(N);
+
+    free(X_in);
+    free(X_out);
+    free(X_edge);
+    ENGINE_CALL(slab_delete)(slab);
+
+#if ENGINE_PASSES
+    ENGINE_CALL(passes_delete)(ctx, &passes);
+#endif
+
+    return result;
+}
+
+/*
+ * Runs every dense engine on the same context and checks that they reach the
+ * same state at every node. The cache seeds are not loaded, only the first
+ * run would start from them, and the deadline is dropped. The result is the
+ * one of the wpo engine.
+ */
+static AbstractResult ENGINE_FN(run_compare)(AbstractContext* ctx)
+{
+    static const Engine engines[] = { ENGINE_RECURSIVE, ENGINE_WORKLIST, ENGINE_WPO };
+    int engines_num = sizeof(engines) / sizeof(engines[0]);
+    int nodes_num = ctx->block_count + ctx->exit_count;
+
+    AbstractResult result = { 0 };
+    Vector* user_record = ctx->record;
+    Vector* records[sizeof(engines) / sizeof(engines[0])] = { 0 };
+
+    // an engine running out of time would not reach the same states
+    ctx->deadline = 0;
+
+    for (int e = 0; e < engines_num; e++) {
+        records[e] = vector_new(sizeof(char*));
+        if (!records[e]) {
+            goto cleanup;
+        }
+
+        ctx->engine = engines[e];
+        ctx->record = records[e];
+
+        abstract_result_delete(&result);
+
+        double start = omp_get_wtime();
+        result = ENGINE_FN(run_dense)(ctx);
+        LOG_BENCHMARK("Engine %s: %ld microseconds", engine_name(engines[e]), (long)((omp_get_wtime() - start) * 1e6));
+
+        if (!result.results) {
+            LOG_ERROR("Engine %s failed", engine_name(engines[e]));
+            goto cleanup;
+        }
+    }
+
+    bool identical = true;
+    for (int e = 0; e < engines_num - 1 && identical; e++) {
+        for (int i = 0; i < nodes_num; i++) {
+            char* expected = *(char**)vector_get(records[engines_num - 1], i);
+            char* actual = *(char**)vector_get(records[e], i);
+
+            if (strcmp(expected, actual)) {
+                LOG_ERROR("Engine %s diverges from wpo at node %d", engine_name(engines[e]), i);
+                LOG_ERROR("wpo: %s", expected);
+                LOG_ERROR("%s: %s", engine_name(engines[e]), actual);
+                identical = false;
+                break;
+            }
+        }
+    }
+
+    if (identical) {
+        LOG_INFO("All engines reach the same fixpoint on %d nodes", nodes_num);
+    }
+
+    // the caller recording states gets the ones of the wpo run
+    for (int i = 0; user_record && i < nodes_num; i++) {
+        char** state = vector_get(records[engines_num - 1], i);
+        vector_push(user_record, state);
+        *state = NULL;
+    }
+
+cleanup:
+    for (int e = 0; e < engines_num; e++) {
+        delete_record(records[e]);
+    }
+
+    ctx->engine = ENGINE_COMPARE;
+    ctx->record = user_record;
+
+    return result;
+}
+
+static AbstractResult ENGINE_FN(run)(AbstractContext* ctx)
+{
+    if (ctx->engine == ENGINE_COMPARE) {
+        return ENGINE_FN(run_compare)(ctx);
+    }
+
+#if ENGINE_PASSES
+    if (ctx->method_id) {
+        ENGINE_CALL(load_seeds)(ctx);
+    }
+#endif
+
+    return ENGINE_FN(run_dense)(ctx);
+}
+
+/*** TABLE ***/
+
+static AbstractState* ENGINE_FN(new_top)(int max_locals, int max_stack)
+{
+    return (AbstractState*)ENGINE_CALL(new_top)(max_locals, max_stack);
+}
+
+static AbstractState* ENGINE_FN(new_bottom)(int max_locals, int max_stack)
+{
+    return (AbstractState*)ENGINE_CALL(new_bottom)(max_locals, max_stack);
+}
+
+static int ENGINE_FN(copy)(AbstractState* dst, const AbstractState* src)
+{
+    return ENGINE_CALL(copy)((ENGINE_STATE*)dst, (const ENGINE_STATE*)src);
+}
+
+static int ENGINE_FN(set_arguments)(AbstractState* st, const Vector* types)
+{
+    return ENGINE_CALL(set_arguments)((ENGINE_STATE*)st, types);
+}
+
+static void ENGINE_FN(delete)(AbstractState* st)
+{
+    ENGINE_CALL(delete)((ENGINE_STATE*)st);
+}
+
+static int ENGINE_FN(join)(AbstractState* acc, const AbstractState* new, int* changed)
+{
+    return ENGINE_CALL(join)((ENGINE_STATE*)acc, (const ENGINE_STATE*)new, changed);
+}
+
+static int ENGINE_FN(widen)(AbstractState* acc, const AbstractState* new, const int* thresholds, int thresholds_count, int* changed)
+{
+    return ENGINE_CALL(widen)((ENGINE_STATE*)acc, (const ENGINE_STATE*)new, thresholds, thresholds_count, changed);
+}
+
+static int ENGINE_FN(narrow)(AbstractState* acc, const AbstractState* new, int* changed)
+{
+    return ENGINE_CALL(narrow)((ENGINE_STATE*)acc, (const ENGINE_STATE*)new, changed);
+}
+
+static bool ENGINE_FN(leq)(const AbstractState* a, const AbstractState* b)
+{
+    return ENGINE_CALL(leq)((const ENGINE_STATE*)a, (const ENGINE_STATE*)b, 0);
+}
+
+static int ENGINE_FN(transfer)(AbstractState* out, IrInstruction* ir)
+{
+    return ENGINE_CALL(transfer)((ENGINE_STATE*)out, ir);
+}
+
+static int ENGINE_FN(transfer_conditional)(AbstractState* out_true, AbstractState* out_false, IrInstruction* ir)
+{
+    return ENGINE_CALL(transfer_conditional)((ENGINE_STATE*)out_true, (ENGINE_STATE*)out_false, ir);
+}
+
+static AbstractArena* ENGINE_FN(arena_new)(int max_locals, int max_stack)
+{
+    return (AbstractArena*)ENGINE_CALL(arena_new)(max_locals, max_stack);
+}
+
+static void ENGINE_FN(arena_delete)(AbstractArena* arena)
+{
+    ENGINE_CALL(arena_delete)((ENGINE_CALL(Arena)*)arena);
+}
+
+const AbstractDomain DOMAIN_PASTE(ENGINE_DOMAIN, _, domain) = {
+    .name = DOMAIN_NAME(ENGINE_DOMAIN),
+    .new_top = ENGINE_FN(new_top),
+    .new_bottom = ENGINE_FN(new_bottom),
+    .copy = ENGINE_FN(copy),
+    .set_arguments = ENGINE_FN(set_arguments),
+    .delete = ENGINE_FN(delete),
+    .join = ENGINE_FN(join),
+    .widen = ENGINE_FN(widen),
+    .narrow = ENGINE_FN(narrow),
+    .leq = ENGINE_FN(leq),
+    .transfer = ENGINE_FN(transfer),
+    .transfer_conditional = ENGINE_FN(transfer_conditional),
+    .arena_new = ENGINE_FN(arena_new),
+    .arena_delete = ENGINE_FN(arena_delete),
+    .run = ENGINE_FN(run),
+};
+
+#undef ENGINE_CALL
+#undef ENGINE_FN
+#undef ENGINE_STATE
+#undef ENGINE_PASSES
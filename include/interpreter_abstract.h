@@ -3,6 +3,7 @@
 
 #include "cli.h"
 #include "config.h"
+#include "invariants.h"
 #include "method.h"
 
 typedef struct AbstractContext AbstractContext;
@@ -10,9 +11,14 @@ typedef struct AbstractContext AbstractContext;
 typedef struct {
     int num_locals;
     Vector** results; // Vector<Interval> results[num_locals];
+    bool degraded; // the deadline passed, loops were widened at once
+    InvariantStore* invariants; // states before every instruction, NULL unless the invariants key is set
 } AbstractResult;
 
 AbstractContext* interpreter_abstract_setup(const Method* m, const Options* opts, const Config* cfg);
+void interpreter_abstract_set_schedule(AbstractContext* abstract_context, int threads, unsigned seed);
+void interpreter_abstract_record_states(AbstractContext* abstract_context, Vector* states);
 AbstractResult interpreter_abstract_run(AbstractContext* abstract_context);
 void abstract_result_print(const AbstractResult* result);
+void abstract_result_delete(AbstractResult* result);
 #endif
@@ -0,0 +1,30 @@
+#ifndef INTERVAL_KERNELS_H
+#define INTERVAL_KERNELS_H
+
+#include "domain_interval.h"
+
+#include <stdbool.h>
+
+/*
+ * Slot-wise lattice operations over the first len slots of two states. The
+ * writing ones stamp every slot they change with version and return whether
+ * anything changed; meet returns -1, without writing, when a slot is empty.
+ *
+ * Slots are { lower, upper } pairs, so a vector register holds the lower
+ * bounds in its even lanes and the upper bounds in its odd ones. The kernels
+ * are picked once from the features of the CPU, a scalar set is always there.
+ */
+typedef struct {
+    const char* name;
+    int (*join)(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len);
+    int (*meet)(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len);
+    int (*widen)(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len,
+        const int* thresholds, int thresholds_count);
+    // since > 0 skips the slots of a stamped at or before since
+    bool (*leq)(const Interval* a, const Interval* b, const unsigned* stamp, unsigned since, int len);
+    bool (*equal)(const Interval* a, const Interval* b, int len);
+} IntervalKernels;
+
+const IntervalKernels* interval_kernels(void);
+
+#endif
@@ -4,10 +4,17 @@
 #include "vector.h"
 #include "fuzzer.h"
 #include "interpreter_abstract.h"
+#include "precondition.h"
 #include "testCaseCorpus.h"
 
 Vector* generate_interval_seeds(Fuzzer* f,
                                 AbstractResult* abs,
                                 Vector* arg_types);
 
+// seeds drawn from the arguments that can reach the unknown error sites
+void generate_precondition_seeds(Fuzzer* f,
+                                 const Preconditions* preconditions,
+                                 Vector* arg_types,
+                                 Vector* seeds);
+
 #endif //JAVA_ANALYZER_INTERVAL_TESTCASE_H
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef INVARIANTS_H
+#define INVARIANTS_H
+
+#include "domain_interval.h"
+#include "ir_function.h"
+
+#include <stddef.h>
+
+/*
+ * Abstract state before every instruction of the analyzed method and of its
+ * callees, indexed by (function, pc, slot). Slots are the locals of the
+ * function followed by the stack, bottom first. Copies of a function inlined
+ * more than once are joined, and equal states are stored once.
+ *
+ * The store is filled with add, then sealed; lookups are only valid on a
+ * sealed store and take constant time.
+ */
+
+typedef struct InvariantStore InvariantStore;
+
+InvariantStore* invariant_store_new(void);
+int invariant_store_add(InvariantStore* store, const IrFunction* function, int pc, int num_locals, const IntervalState* state);
+int invariant_store_seal(InvariantStore* store);
+
+int invariant_store_function(const InvariantStore* store, const IrFunction* function);
+int invariant_store_functions(const InvariantStore* store);
+const IrFunction* invariant_store_function_ir(const InvariantStore* store, int function);
+int invariant_store_slots(const InvariantStore* store, int function, int pc);
+int invariant_store_locals(const InvariantStore* store, int function, int pc);
+int invariant_store_get(const InvariantStore* store, int function, int pc, int slot, Interval* interval);
+size_t invariant_store_distinct(const InvariantStore* store);
+
+void invariant_store_print(const InvariantStore* store);
+void invariant_store_delete(InvariantStore* store);
+
+#endif
@@ -6,6 +6,8 @@
 
 typedef struct {
     Vector* ir_instructions;
+    int max_locals;
+    int max_stack;
 } IrFunction;
 
 IrFunction* ir_function_build(const Method* m, const Config* cfg);
@@ -3,6 +3,8 @@
 
 #include "opcode.h"
 
+#include <stdint.h>
+
 typedef struct {
     Opcode opcode;
     int seq;
@@ -31,6 +33,7 @@ typedef struct {
 IrInstruction*
 ir_instruction_parse(cJSON* instruction_json);
 int ir_instruction_is_conditional(IrInstruction* ir_instruction);
+uint64_t ir_instruction_hash(uint64_t hash, const IrInstruction* ir_instruction);
 void ir_instruction_delete(IrInstruction* inst);
 void ir_instruction_free(IrInstruction* inst);
 #endif
@@ -6,9 +6,13 @@
 #include "ir_function.h"
 #include "method.h"
 
+#include <stdint.h>
+
 IrFunction* ir_program_get_function_ir(const Method* m, const Config* cfg);
 Cfg* ir_program_get_cfg(const Method* m, const Config* cfg);
 int ir_program_get_num_locals(const Method* m, const Config* cfg);
+uint64_t ir_program_get_hash(const Method* m, const Config* cfg);
+const char* ir_program_get_function_id(const IrFunction* ir_function);
 
 void ir_program_delete();
 
@@ -0,0 +1,37 @@
+#ifndef PRECONDITION_H
+#define PRECONDITION_H
+
+#include "config.h"
+#include "domain_interval.h"
+#include "interpreter_abstract.h"
+#include "method.h"
+#include "outcome.h"
+#include "vector.h"
+#include "verdict.h"
+
+/*
+ * Preconditions of the error sites the verdicts left unknown: a backward
+ * interval analysis runs from the failure condition of the site (a zero
+ * divisor, a null reference, an index out of bounds, reaching a throw) up to
+ * the method entry, met at every pc with the invariants of the forward one.
+ * An argument outside its interval cannot raise the error at the site, so
+ * the fuzzer draws its inputs from them. Only the sites of the method itself
+ * are followed, the calls it makes leave the state to the invariants.
+ */
+
+typedef struct {
+    int pc;
+    outcome kind;
+    Interval* arguments; // arguments[num_arguments]
+} Precondition;
+
+typedef struct {
+    int num_arguments;
+    Vector* conditions; // Vector<Precondition>, sites the entry cannot reach are left out
+} Preconditions;
+
+int precondition_compute(const Method* m, const Config* cfg, const AbstractResult* result, const Verdicts* verdicts, Preconditions* preconditions);
+void precondition_print(const Preconditions* preconditions);
+void precondition_delete(Preconditions* preconditions);
+
+#endif
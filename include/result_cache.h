@@ -0,0 +1,30 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "domain_interval.h"
+#include "interpreter_abstract.h"
+
+#include <stdint.h>
+
+/*
+ * Results of previous analyses, kept in a file between runs. An entry is
+ * reused as it is when the hash of the method (its ir, its callees, the
+ * analysis parameters) did not change, and its loop head states seed the
+ * analysis again when only the instructions changed but not the shape of
+ * the inlined cfg. Entries keep the invariants when the analysis recorded
+ * them, an analysis that records them only reuses such an entry.
+ */
+
+typedef struct {
+    int node;
+    IntervalState* state;
+} CachedHead;
+
+int result_cache_load(const char* path);
+int result_cache_lookup(const char* method_id, uint64_t hash, const Config* cfg, AbstractResult* result);
+int result_cache_seed(const char* method_id, uint64_t shape, int node, IntervalState* seed);
+void result_cache_store(const char* method_id, uint64_t hash, uint64_t shape, const AbstractResult* result, const Vector* heads);
+int result_cache_save(const char* path);
+void result_cache_delete();
+
+#endif
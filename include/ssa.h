@@ -0,0 +1,86 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "cfg.h"
+#include "graph.h"
+#include "opcode.h"
+#include "vector.h"
+
+#include <stdbool.h>
+
+/*
+ * SSA form of an inlined cfg. Variables are the slots of the dense abstract
+ * frame: max_locals locals followed by one variable per stack depth, so that
+ * values left on the stack across blocks are renamed like locals.
+ */
+
+typedef enum {
+    SSA_ENTRY, // unknown value reaching the method entry
+    SSA_PHI,
+    SSA_SIGMA, // copy of a local restricted by the branch leading to its block
+    SSA_EXPR, // store, incr, invoke argument or stack slot left at the end of a block
+    SSA_BRANCH, // comparison closing a conditional block, defines no variable
+} SsaValueKind;
+
+typedef enum {
+    EXPR_RANGE, // constant interval: push, get, unknown values
+    EXPR_VALUE,
+    EXPR_BINARY,
+    EXPR_NEGATE,
+} SsaExprKind;
+
+typedef struct {
+    SsaExprKind kind;
+    BinaryOperator op;
+    int lower; // EXPR_RANGE
+    int upper;
+    int value; // EXPR_VALUE
+    int left; // operand expressions
+    int right;
+} SsaExpr;
+
+typedef struct {
+    SsaValueKind kind;
+    int block;
+    int var; // -1 for SSA_BRANCH
+    int expr; // SSA_EXPR
+    Vector* operands; // Vector<int>, phi: one value per predecessor edge, sigma: the refined value
+    Vector* users; // Vector<int> values reading this one
+    IfCondition condition; // SSA_BRANCH
+    int left; // compared expressions of SSA_BRANCH
+    int right;
+    int branch; // SSA_SIGMA: value of the branch it is restricted by
+    int taken; // SSA_SIGMA: 1 on the branch target edge, 0 on the fall through
+} SsaValue;
+
+typedef struct {
+    int source;
+    int index; // successor index of the edge in source
+} SsaEdge;
+
+typedef struct {
+    Vector* successors; // Vector<int>, cfg edges, the branch target first
+    Vector* predecessors; // Vector<SsaEdge>, reachable ones only
+    Vector* values; // Vector<int> values defined in the block, phis and sigmas first
+    int branch; // SSA_BRANCH value, -1 if the block does not end with a conditional
+    int* exit_values; // reaching value of the observed locals at the end of the block
+    bool reachable;
+} SsaBlock;
+
+typedef struct {
+    int block_count;
+    int max_locals;
+    int max_stack;
+    int observed_locals;
+    SsaBlock* blocks;
+    Vector* values; // Vector<SsaValue>
+    Vector* exprs; // Vector<SsaExpr>
+} SsaForm;
+
+SsaForm* ssa_build(Cfg* cfg, Graph* flow, int max_locals, int max_stack, int observed_locals);
+SsaValue* ssa_value(const SsaForm* ssa, int value);
+SsaExpr* ssa_expr(const SsaForm* ssa, int expr);
+void ssa_print(const SsaForm* ssa);
+void ssa_delete(SsaForm* ssa);
+
+#endif
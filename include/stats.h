@@ -0,0 +1,46 @@
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * Counters of the parallel fixpoint, compiled in with -DSTATS (make stats).
+ * Every thread counts in its own slot, the slots are merged when the
+ * analysis is dumped, one JSON object per analysis.
+ */
+
+typedef enum {
+    EVENT_JOIN, // predecessor joins of the nodes, and loop head joins before widening starts
+    EVENT_WIDENING,
+    EVENT_NARROWING,
+    EVENT_COUNT,
+} ComponentEvent;
+
+typedef enum {
+    TIME_TASK, // whole node tasks, transfer and lock waits included
+    TIME_TRANSFER,
+    TIME_LOCK_WAIT,
+    TIME_COUNT,
+} TimeKind;
+
+typedef struct FixpointStats FixpointStats;
+
+#ifdef STATS
+#include <omp.h>
+
+FixpointStats* stats_new(const char* method_id, int threads, int nodes, int components);
+void stats_visit(FixpointStats* stats, int node);
+void stats_event(FixpointStats* stats, int component, ComponentEvent event);
+void stats_stabilized(FixpointStats* stats, int component, int iterations);
+void stats_time(FixpointStats* stats, TimeKind kind, double seconds);
+void stats_dump(FixpointStats* stats, const char* path, double elapsed);
+void stats_delete(FixpointStats* stats);
+
+#define STATS_RECORD(call) call
+#define STATS_START(timer) double timer = omp_get_wtime()
+#define STATS_STOP(stats, kind, timer) stats_time((stats), (kind), omp_get_wtime() - (timer))
+#else
+#define STATS_RECORD(call) ((void)0)
+#define STATS_START(timer) ((void)0)
+#define STATS_STOP(stats, kind, timer) ((void)0)
+#endif
+
+#endif
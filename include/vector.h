@@ -14,6 +14,7 @@ int vector_pop(Vector* v, void* out);
 void* vector_get(const Vector* v, size_t index);
 void vector_reverse(Vector* v);
 int vector_copy(Vector* dst, const Vector* src);
+void vector_clear(Vector* v);
 
 size_t vector_length(const Vector* v);
 
@@ -0,0 +1,49 @@
+#ifndef VERDICT_H
+#define VERDICT_H
+
+#include "config.h"
+#include "interpreter_abstract.h"
+#include "ir_function.h"
+#include "method.h"
+#include "outcome.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Outcomes decided from the invariants of the abstract analysis: every
+ * division and remainder, array access and throw is a site, impossible when
+ * its state excludes the error (or is never reached), certain when reaching
+ * it always raises the error. An array access is a site for a null reference
+ * and one for its index. The verdicts of the method follow from them; arrays
+ * are the only references that can be null, the others are new exceptions.
+ */
+
+typedef enum {
+    VERDICT_IMPOSSIBLE,
+    VERDICT_CERTAIN,
+    VERDICT_UNKNOWN,
+} Verdict;
+
+typedef struct {
+    const IrFunction* function;
+    int pc;
+    outcome kind;
+    Verdict verdict;
+} VerdictSite;
+
+typedef struct {
+    Vector* sites; // Vector<VerdictSite>
+    Verdict outcomes[OC_INFINITE_LOOP + 1];
+} Verdicts;
+
+int verdict_compute(const Method* m, const Config* cfg, const AbstractResult* result, Verdicts* verdicts);
+bool verdict_decided(const Verdicts* verdicts);
+Outcome verdict_outcome(const Verdicts* verdicts);
+size_t verdict_fuzz_goal(const Verdicts* verdicts, uint8_t* goal, size_t count);
+void verdict_print(const Verdicts* verdicts);
+void verdict_delete(Verdicts* verdicts);
+
+#endif
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+
+#include "batch.h"
+
+#include "cJSON/cJSON.h"
+#include "common.h"
+#include "domain_interval.h"
+#include "interpreter_abstract.h"
+#include "ir_program.h"
+#include "log.h"
+#include "method.h"
+#include "vector.h"
+
+#include <ctype.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+static char* trim(char* line)
+{
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+
+    char* end = line + strlen(line);
+    while (end > line && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+
+    return line;
+}
+
+static Vector* read_method_ids(const char* path)
+{
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!file) {
+        LOG_ERROR("Unable to open method list %s", path);
+        return NULL;
+    }
+
+    Vector* ids = vector_new(sizeof(char*));
+    char* line = NULL;
+    size_t capacity = 0;
+
+    while (getline(&line, &capacity, file) != -1) {
+        char* id = trim(line);
+        if (*id == '\0' || *id == '#') {
+            continue;
+        }
+
+        char* copy = strdup(id);
+        vector_push(ids, &copy);
+    }
+
+    free(line);
+    if (file != stdin) {
+        fclose(file);
+    }
+
+    return ids;
+}
+
+static long elapsed_us(const struct timeval* start, const struct timeval* end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000L + (end->tv_usec - start->tv_usec);
+}
+
+// locals[i][block], null where the block is unreachable
+static cJSON* result_to_json(const AbstractResult* result)
+{
+    cJSON* locals = cJSON_CreateArray();
+
+    for (int i = 0; i < result->num_locals; i++) {
+        cJSON* blocks = cJSON_CreateArray();
+
+        for (size_t j = 0; j < vector_length(result->results[i]); j++) {
+            Interval* iv = vector_get(result->results[i], j);
+
+            if (is_interval_bottom(*iv)) {
+                cJSON_AddItemToArray(blocks, cJSON_CreateNull());
+            } else {
+                int bounds[2] = { iv->lower, iv->upper };
+                cJSON_AddItemToArray(blocks, cJSON_CreateIntArray(bounds, 2));
+            }
+        }
+
+        cJSON_AddItemToArray(locals, blocks);
+    }
+
+    return locals;
+}
+
+static void analyze_method(const char* id, const Options* opts, const Config* cfg)
+{
+    cJSON* line = cJSON_CreateObject();
+    cJSON_AddStringToObject(line, "method", id);
+
+    Method* m = method_create((char*)id);
+    if (!m) {
+        cJSON_AddStringToObject(line, "error", "invalid method id");
+        goto print;
+    }
+
+    // an id the decompiled classes do not define has no code to analyze
+    if (!ir_program_get_function_ir(m, cfg)) {
+        cJSON_AddStringToObject(line, "error", "unknown method");
+        goto print;
+    }
+
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    AbstractContext* ctx = interpreter_abstract_setup(m, opts, cfg);
+    if (!ctx) {
+        cJSON_AddStringToObject(line, "error", "setup failed");
+        goto print;
+    }
+
+    AbstractResult result = interpreter_abstract_run(ctx);
+    gettimeofday(&end, NULL);
+
+    if (!result.results) {
+        cJSON_AddStringToObject(line, "error", "analysis failed");
+        goto print;
+    }
+
+    cJSON_AddNumberToObject(line, "time_us", elapsed_us(&start, &end));
+    if (result.degraded) {
+        cJSON_AddBoolToObject(line, "degraded", 1);
+    }
+    cJSON_AddItemToObject(line, "locals", result_to_json(&result));
+    abstract_result_delete(&result);
+
+print:;
+    char* text = cJSON_PrintUnformatted(line);
+
+#pragma omp critical(batch_output)
+    {
+        if (text) {
+            printf("%s\n", text);
+        }
+        fflush(stdout);
+    }
+
+    free(text);
+    cJSON_Delete(line);
+    method_delete(m);
+}
+
+int batch_run(const char* path, const Options* opts, const Config* cfg)
+{
+    int result = FAILURE;
+
+    Vector* ids = read_method_ids(path);
+    if (!ids) {
+        goto cleanup;
+    }
+
+    int count = vector_length(ids);
+    LOG_INFO("Batch of %d methods", count);
+
+    // the analyses spawn their node tasks into this same team
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            for (int i = 0; i < count; i++) {
+                const char* id = *(char**)vector_get(ids, i);
+
+#pragma omp task firstprivate(id)
+                analyze_method(id, opts, cfg);
+            }
+        }
+    }
+
+    result = SUCCESS;
+
+cleanup:
+    for (size_t i = 0; ids && i < vector_length(ids); i++) {
+        free(*(char**)vector_get(ids, i));
+    }
+    vector_delete(ids);
+
+    return result;
+}
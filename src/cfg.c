@@ -231,7 +231,7 @@ cleanup:
     free(visited);
     free(block_map);
     free(is_leader);
-    if (result) {
+    if (result && cfg) {
         vector_delete(cfg->blocks);
         free(cfg);
         cfg = NULL;
@@ -240,85 +240,191 @@ cleanup:
     return cfg;
 }
 
-int cfg_inline(Cfg* cfg, Config* config, Method* m)
+static BasicBlock* push_block_copy(Cfg* out, const BasicBlock* block)
 {
-    if (!cfg) {
-        return FAILURE;
+    BasicBlock* copy = basic_block_new(vector_length(out->blocks));
+    if (!copy) {
+        return NULL;
     }
 
-    IrFunction* ir_function = ir_program_get_function_ir(m, config);
-    BasicBlock* entry = *(BasicBlock**)vector_get(cfg->blocks, 0);
+    copy->og_id = block->og_id;
+    copy->ip_start = block->ip_start;
+    copy->ip_end = block->ip_end;
+    copy->ir_function = block->ir_function;
+    copy->num_locals = block->num_locals;
+
+    vector_push(out->blocks, &copy);
+    return copy;
+}
+
+// callee of an invoke if it can be inlined: a jpamb method not already being inlined
+static Method* inline_target(IrInstruction* ir_instruction, Config* config, Vector* inlining)
+{
+    char* method_id = get_method_signature(&ir_instruction->data.invoke);
+    if (!method_id) {
+        return NULL;
+    }
+
+    Method* callee = NULL;
+    if (strncmp(method_id, "jpamb.", strlen("jpamb.")) == 0) {
+        callee = method_create(method_id);
+    }
+    free(method_id);
+
+    if (!callee) {
+        return NULL;
+    }
 
+    IrFunction* callee_function = ir_program_get_function_ir(callee, config);
+    for (size_t i = 0; i < vector_length(inlining); i++) {
+        if (*(IrFunction**)vector_get(inlining, i) == callee_function) {
+            LOG_DEBUG("Recursive call to %s is not inlined", method_get_id(callee));
+            method_delete(callee);
+            return NULL;
+        }
+    }
+
+    return callee;
+}
+
+/*
+ * Appends a copy of cfg to out, with every inlinable call replaced by a copy of
+ * the callee blocks. A block is split after each inlined invoke: the invoke
+ * block enters the callee and the callee returns reach the continuation.
+ * The return blocks of this copy are pushed to returns, the index of its entry
+ * block is returned.
+ */
+static int inline_into(Cfg* out, const Cfg* cfg, Config* config, Vector* inlining, Vector* returns)
+{
     int length = vector_length(cfg->blocks);
+    int base = vector_length(out->blocks);
+
+    // entry copy of every block first, the layout of the original cfg is kept
     for (int i = 0; i < length; i++) {
         BasicBlock* block = *(BasicBlock**)vector_get(cfg->blocks, i);
-        for (int j = block->ip_start; j <= block->ip_end; j++) {
-            IrInstruction* ir_instruction = *(IrInstruction**)vector_get(ir_function->ir_instructions, j);
-            if (ir_instruction->opcode == OP_INVOKE) {
-                int id = vector_length(cfg->blocks);
-                // split the current block
-                BasicBlock* invoke_exit = basic_block_new(id);
-                invoke_exit->ip_start = j + 1;
-                invoke_exit->ip_end = block->ip_end;
-                invoke_exit->ir_function = block->ir_function;
-
-                vector_copy(invoke_exit->successors, block->successors);
-                vector_delete(block->successors);
-
-                block->successors = vector_new(sizeof(BasicBlock*));
-                // vector_push(block->successors, &invoke_exit);
+        if (!push_block_copy(out, block)) {
+            return -1;
+        }
+    }
 
-                InvokeOP* invoke = &ir_instruction->data.invoke;
-                char* method_id = get_method_signature(invoke);
+    for (int i = 0; i < length; i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(cfg->blocks, i);
+        BasicBlock* tail = *(BasicBlock**)vector_get(out->blocks, base + i);
+        Vector* ir_instructions = block->ir_function->ir_instructions;
+        Vector* ends = vector_new(sizeof(BasicBlock*)); // blocks reaching the end of the original one
+
+        for (int j = tail->ip_start; j <= block->ip_end; j++) {
+            IrInstruction* ir_instruction = *(IrInstruction**)vector_get(ir_instructions, j);
+            if (ir_instruction->opcode != OP_INVOKE) {
+                continue;
+            }
 
-                if (!method_id) {
-                    return FAILURE;
-                }
+            Method* callee = inline_target(ir_instruction, config, inlining);
+            if (!callee) {
+                continue;
+            }
 
-                char* method_id_copy = strdup(method_id);
-                char* root = strtok(method_id_copy, ".");
+            const Cfg* callee_cfg = ir_program_get_cfg(callee, config);
+            IrFunction* callee_function = ir_program_get_function_ir(callee, config);
+            method_delete(callee);
 
-                if (strcmp(root, "jpamb") != 0) {
-                    continue;
-                }
+            if (!callee_cfg) {
+                continue;
+            }
 
-                free(method_id_copy);
+            BasicBlock* continuation = NULL;
+            if (j < block->ip_end) {
+                continuation = push_block_copy(out, block);
+                continuation->ip_start = j + 1;
+            }
 
-                Method* invoke_method = method_create(method_id);
-                // recursive
-                if (strcmp(method_get_id(invoke_method), method_get_id(m)) == 0) {
-                    vector_push(block->successors, &entry);
-                    exit(1);
-                } else {
-                    Cfg* invoke_cfg = ir_program_get_cfg(invoke_method, config);
-                    cfg_inline(invoke_cfg, config, invoke_method);
+            Vector* callee_returns = vector_new(sizeof(BasicBlock*));
+            vector_push(inlining, &callee_function);
 
-                    IrFunction* invoke_function = ir_program_get_function_ir(invoke_method, config);
+            int callee_entry = inline_into(out, callee_cfg, config, inlining, callee_returns);
 
-                    vector_push(cfg->blocks, &invoke_exit);
-                    int actual_len = vector_length(cfg->blocks);
-                    for (int k = 0; k < vector_length(invoke_cfg->blocks); k++) {
-                        BasicBlock* invoke_cfg_block = *(BasicBlock**)vector_get(invoke_cfg->blocks, k);
-                        invoke_cfg_block->id = invoke_cfg_block->id + actual_len;
+            vector_pop(inlining, NULL);
 
-                        vector_push(cfg->blocks, &invoke_cfg_block);
+            if (callee_entry < 0) {
+                vector_delete(callee_returns);
+                vector_delete(ends);
+                return -1;
+            }
 
-                        IrInstruction* last = *(IrInstruction**)vector_get(invoke_cfg_block->ir_function->ir_instructions, invoke_cfg_block->ip_end);
-                        if (last->opcode == OP_RETURN) {
-                            vector_push(invoke_cfg_block->successors, &invoke_exit);
-                        }
-                    }
+            BasicBlock* entry = *(BasicBlock**)vector_get(out->blocks, callee_entry);
+            tail->ip_end = j;
+            vector_push(tail->successors, &entry);
 
-                    BasicBlock* invoke_cfg_entry = *(BasicBlock**)vector_get(invoke_cfg->blocks, 0);
-                    vector_push(block->successors, &invoke_cfg_entry);
+            if (continuation) {
+                for (size_t k = 0; k < vector_length(callee_returns); k++) {
+                    BasicBlock* callee_return = *(BasicBlock**)vector_get(callee_returns, k);
+                    vector_push(callee_return->successors, &continuation);
                 }
+                vector_delete(callee_returns);
+                tail = continuation;
+            } else {
+                // an invoke closing the block returns straight to its successors
+                vector_delete(ends);
+                ends = callee_returns;
+                tail = NULL;
+                break;
+            }
+        }
+
+        if (tail) {
+            vector_push(ends, &tail);
+
+            IrInstruction* last = *(IrInstruction**)vector_get(ir_instructions, tail->ip_end);
+            if (last->opcode == OP_RETURN) {
+                vector_push(returns, &tail);
+            }
+        }
+
+        for (size_t e = 0; e < vector_length(ends); e++) {
+            BasicBlock* end_block = *(BasicBlock**)vector_get(ends, e);
 
-                block->ip_end = j;
+            for (size_t k = 0; k < vector_length(block->successors); k++) {
+                BasicBlock* successor = *(BasicBlock**)vector_get(block->successors, k);
+                BasicBlock* successor_copy = *(BasicBlock**)vector_get(out->blocks, base + successor->id);
+                vector_push(end_block->successors, &successor_copy);
             }
         }
+
+        vector_delete(ends);
     }
 
-    return SUCCESS;
+    return base;
+}
+
+Cfg* cfg_inline(const Cfg* cfg, Config* config, Method* m)
+{
+    if (!cfg) {
+        return NULL;
+    }
+
+    Cfg* inlined = malloc(sizeof(Cfg));
+    if (!inlined) {
+        return NULL;
+    }
+
+    inlined->blocks = vector_new(sizeof(BasicBlock*));
+
+    Vector* inlining = vector_new(sizeof(IrFunction*));
+    Vector* returns = vector_new(sizeof(BasicBlock*));
+    IrFunction* ir_function = ir_program_get_function_ir(m, config);
+    vector_push(inlining, &ir_function);
+
+    int entry = inline_into(inlined, cfg, config, inlining, returns);
+
+    vector_delete(inlining);
+    vector_delete(returns);
+
+    if (entry < 0) {
+        cfg_delete(inlined);
+        return NULL;
+    }
+
+    return inlined;
 }
 
 void cfg_print(Cfg* cfg)
@@ -343,9 +449,7 @@ void cfg_delete(Cfg* cfg)
         if (cfg->blocks) {
             for (int i = 0; i < vector_length(cfg->blocks); i++) {
                 BasicBlock* block = *(BasicBlock**)vector_get(cfg->blocks, i);
-                if (block->successors) {
-                    vector_length(block->successors);
-                }
+                vector_delete(block->successors);
                 free(block);
             }
 
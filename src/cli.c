@@ -19,6 +19,12 @@
 #define ABSTRACT_TAG "a"
 #define ABSTRACT_TAG_F "abstract"
 
+#define BATCH_TAG "b"
+#define BATCH_TAG_F "batch"
+
+#define DETERMINISM_TAG "d"
+#define DETERMINISM_TAG_F "determinism"
+
 static bool is_abstract_only(const char* opt)
 {
     return strcmp(opt, ABSTRACT_TAG) == 0 || strcmp(opt, ABSTRACT_TAG_F) == 0;
@@ -29,11 +35,27 @@ static bool is_interpreter_only(const char* opt)
     return strcmp(opt, INTERPRETER_TAG) == 0 || strcmp(opt, INTERPRETER_TAG_F) == 0;
 }
 
+static bool is_batch_mode(const char* opt)
+{
+    return strcmp(opt, BATCH_TAG) == 0 || strcmp(opt, BATCH_TAG_F) == 0;
+}
+
+static bool is_determinism_mode(const char* opt)
+{
+    return strcmp(opt, DETERMINISM_TAG) == 0 || strcmp(opt, DETERMINISM_TAG_F) == 0;
+}
+
 static bool is_fuzz_mode(const char* opt)
 {
     return strcmp(opt, FUZZ_SHORT) == 0 || strcmp(opt, FUZZ_LONG) == 0;
 }
 
+static OptionsParseResult conflict(const char* first, const char* second)
+{
+    LOG_ERROR("The -%s and -%s options cannot be used together", first, second);
+    return OPT_CONFLICTING_MODES;
+}
+
 OptionsParseResult options_parse_args(const int argc, const char** argv, Options* opts)
 {
     int args_num = argc - 1;
@@ -42,6 +64,8 @@ OptionsParseResult options_parse_args(const int argc, const char** argv, Options
     opts->interpreter_only = false;
     opts->abstract_only = false;
     opts->fuzzer = false;
+    opts->batch = false;
+    opts->determinism = false;
     opts->method_id = NULL;
     opts->parameters = NULL;
 
@@ -54,7 +78,8 @@ OptionsParseResult options_parse_args(const int argc, const char** argv, Options
     }
 
     if (args_num > MANDATORY_ARGS_NUM) {
-        for (int i = 1; i <= OPTIONS_NUM; i++) {
+        // the last argument is never an option, "-" names stdin in batch mode
+        for (int i = 1; i <= OPTIONS_NUM && i < args_num; i++) {
             if (argv[i][0] && argv[i][0] == '-') {
                 LOG_INFO("Option: %s", argv[i]);
                 if (is_interpreter_only(argv[i] + 1)) {
@@ -63,6 +88,10 @@ OptionsParseResult options_parse_args(const int argc, const char** argv, Options
                     opts->abstract_only = true;
                 } else if (is_fuzz_mode(argv[i] + 1)) {
                     opts->fuzzer = true;
+                } else if (is_batch_mode(argv[i] + 1)) {
+                    opts->batch = true;
+                } else if (is_determinism_mode(argv[i] + 1)) {
+                    opts->determinism = true;
                 } else {
                     return OPT_OPTION_NOT_KNOWN;
                 }
@@ -71,7 +100,37 @@ OptionsParseResult options_parse_args(const int argc, const char** argv, Options
     }
 
     if (opts->abstract_only && opts->interpreter_only) {
-        return OPT_TOO_MANY_ARGS;
+        return conflict(ABSTRACT_TAG, INTERPRETER_TAG);
+    }
+
+    if (opts->batch && opts->interpreter_only) {
+        return conflict(BATCH_TAG, INTERPRETER_TAG);
+    }
+
+    if (opts->batch && opts->fuzzer) {
+        return conflict(BATCH_TAG, FUZZ_SHORT);
+    }
+
+    if (opts->determinism && opts->batch) {
+        return conflict(DETERMINISM_TAG, BATCH_TAG);
+    }
+
+    if (opts->determinism && opts->interpreter_only) {
+        return conflict(DETERMINISM_TAG, INTERPRETER_TAG);
+    }
+
+    if (opts->determinism && opts->fuzzer) {
+        return conflict(DETERMINISM_TAG, FUZZ_SHORT);
+    }
+
+    // both modes read a single last argument, the list or the method
+    for (int i = 1; (opts->batch || opts->determinism) && i < args_num; i++) {
+        if (argv[i][0] != '-') {
+            LOG_ERROR("The -%s option takes a single %s, %s is one too many",
+                opts->batch ? BATCH_TAG : DETERMINISM_TAG,
+                opts->batch ? "method id list" : "method id", argv[i]);
+            return OPT_CONFLICTING_MODES;
+        }
     }
 
     const char* method_id = NULL;
@@ -83,7 +142,7 @@ OptionsParseResult options_parse_args(const int argc, const char** argv, Options
         method_id = argv[args_num];
     }
 
-    if (is_info(method_id)) {
+    if (!opts->batch && is_info(method_id)) {
         opts->info = true;
     } else {
         opts->method_id = strdup(method_id);
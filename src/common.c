@@ -1,5 +1,6 @@
 #include "common.h"
 #include <limits.h>
+#include <string.h>
 
 int min(Vector* v)
 {
@@ -13,3 +14,29 @@ int min(Vector* v)
 
     return res;
 }
+
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+uint64_t hash_int(uint64_t hash, long value)
+{
+    return hash_bytes(hash, &value, sizeof(value));
+}
+
+// the terminator is hashed too, so that "ab" "c" differs from "a" "bc"
+uint64_t hash_string(uint64_t hash, const char* string)
+{
+    if (!string) {
+        return hash_int(hash, -1);
+    }
+
+    return hash_bytes(hash, string, strlen(string) + 1);
+}
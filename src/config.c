@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "config.h"
+#include "domain.h"
 #include "log.h"
 
 #include <stdlib.h>
@@ -12,6 +13,11 @@
 #define LINE_SIZE 256
 #define LINE_SEP " "
 
+#define DEFAULT_WIDENING_DELAY 3
+#define DEFAULT_NARROWING_ITERATIONS 2
+#define DEFAULT_PARTITION_DEPTH 4
+#define MAX_PARTITION_DEPTH 16
+
 #define PWD_MAX 256
 #define CONFIG_PATH_MAX 256
 
@@ -75,6 +81,46 @@ static int set_field(Config* cfg, char* line)
     } else if (strcmp(key, "threads") == 0) {
         cfg->threads = atoi(value);
         cfg->threads_set = true;
+    } else if (strcmp(key, "widening_delay") == 0) {
+        cfg->widening_delay = atoi(value);
+        cfg->widening_delay_set = true;
+    } else if (strcmp(key, "narrowing_iterations") == 0) {
+        cfg->narrowing_iterations = atoi(value);
+        cfg->narrowing_iterations_set = true;
+    } else if (strcmp(key, "sparse") == 0) {
+        cfg->sparse = (strcmp(value, "1") == 0) || (strcmp(value, "true") == 0);
+    } else if (strcmp(key, "engine") == 0) {
+        if (strcmp(value, "wpo") == 0) {
+            cfg->engine = ENGINE_WPO;
+        } else if (strcmp(value, "recursive") == 0) {
+            cfg->engine = ENGINE_RECURSIVE;
+        } else if (strcmp(value, "worklist") == 0) {
+            cfg->engine = ENGINE_WORKLIST;
+        } else if (strcmp(value, "compare") == 0) {
+            cfg->engine = ENGINE_COMPARE;
+        } else {
+            return 1;
+        }
+    } else if (strcmp(key, "domain") == 0) {
+        if (!domain_find(value)) {
+            return 1;
+        }
+        cfg->domain = strdup(value);
+    } else if (strcmp(key, "invariants") == 0) {
+        cfg->invariants = (strcmp(value, "1") == 0) || (strcmp(value, "true") == 0);
+    } else if (strcmp(key, "deadline") == 0) {
+        cfg->deadline = atoi(value);
+    } else if (strcmp(key, "zones") == 0) {
+        cfg->zones = (strcmp(value, "1") == 0) || (strcmp(value, "true") == 0);
+    } else if (strcmp(key, "partitions") == 0) {
+        cfg->partitions = atoi(value);
+    } else if (strcmp(key, "partition_depth") == 0) {
+        cfg->partition_depth = atoi(value);
+        cfg->partition_depth_set = true;
+    } else if (strcmp(key, "cache") == 0) {
+        cfg->cache = strdup(value);
+    } else if (strcmp(key, "stats") == 0) {
+        cfg->stats = strdup(value);
     }
     else {
         return 1;
@@ -168,6 +214,28 @@ Config* config_load()
         cfg->threads = 1;
     }
 
+    if (!cfg->widening_delay_set || cfg->widening_delay < 0) {
+        cfg->widening_delay = DEFAULT_WIDENING_DELAY;
+    }
+
+    if (!cfg->narrowing_iterations_set || cfg->narrowing_iterations < 0) {
+        cfg->narrowing_iterations = DEFAULT_NARROWING_ITERATIONS;
+    }
+
+    if (cfg->deadline < 0) {
+        cfg->deadline = 0;
+    }
+
+    if (cfg->partitions < 0) {
+        cfg->partitions = 0;
+    }
+
+    if (!cfg->partition_depth_set || cfg->partition_depth < 0) {
+        cfg->partition_depth = DEFAULT_PARTITION_DEPTH;
+    } else if (cfg->partition_depth > MAX_PARTITION_DEPTH) {
+        cfg->partition_depth = MAX_PARTITION_DEPTH;
+    }
+
     int check = sanity_check(cfg);
     if (check) {
         const char* missing = "unknown";
@@ -197,6 +265,9 @@ void config_delete(Config* cfg)
         free(cfg->tags);
         free(cfg->jpamb_source_path);
         free(cfg->jpamb_decompiled_path);
+        free(cfg->domain);
+        free(cfg->cache);
+        free(cfg->stats);
     }
 
     free(cfg);
@@ -218,4 +289,17 @@ void config_print(const Config* cfg)
     printf("analyzer jpamb_source_path:      %s\n", cfg->jpamb_source_path);
     printf("analyzer jpamb_decompiler_path:  %s\n", cfg->jpamb_decompiled_path);
     printf("analyzer threads:                %d\n", cfg->threads);
+    printf("analyzer widening_delay:         %d\n", cfg->widening_delay);
+    printf("analyzer narrowing_iterations:   %d\n", cfg->narrowing_iterations);
+    printf("analyzer sparse:                 %d\n", cfg->sparse);
+    printf("analyzer engine:                 %s\n",
+           (const char*[]) { "wpo", "recursive", "worklist", "compare" }[cfg->engine]);
+    printf("analyzer domain:                 %s\n", cfg->domain ? cfg->domain : "interval");
+    printf("analyzer invariants:             %d\n", cfg->invariants);
+    printf("analyzer deadline:               %d ms\n", cfg->deadline);
+    printf("analyzer zones:                  %d\n", cfg->zones);
+    printf("analyzer partitions:             %d\n", cfg->partitions);
+    printf("analyzer partition_depth:        %d\n", cfg->partition_depth);
+    printf("analyzer cache:                  %s\n", cfg->cache ? cfg->cache : "none");
+    printf("analyzer stats:                  %s\n", cfg->stats ? cfg->stats : "stderr");
 }
@@ -13,6 +13,7 @@ typedef struct {
     bool     is_initialized;
     _Atomic bool     is_complete;
     _Atomic uint64_t last_new_coverage_time_us;
+    uint8_t* goal;                 // pcs that have to be covered, all of them if NULL
 } coverage_state;
 
 static coverage_state coverage = {0};
@@ -118,6 +119,9 @@ size_t coverage_commit_thread(const uint8_t* bitmap) {
     if (new_bits > 0) {
         bool all_covered = true;
         for (size_t i = 0; i < coverage.nBits; i++) {
+            if (coverage.goal && !coverage.goal[i]) {
+                continue;
+            }
             if (atomic_load(&coverage.global_bits[i]) == 0) {
                 all_covered = false;
                 break;
@@ -145,8 +149,10 @@ void coverage_reset_all(void) {
     if (!coverage.is_initialized) return;
 
     free(coverage.global_bits);
+    free(coverage.goal);
 
     coverage.global_bits = NULL;
+    coverage.goal        = NULL;
     coverage.nBits       = 0;
     coverage.is_initialized = false;
     atomic_store(&coverage.is_complete, false);
@@ -183,3 +189,21 @@ bool coverage_is_complete(void) {
     if (!coverage.is_initialized) return false;
     return atomic_load(&coverage.is_complete);
 }
+
+/**
+ * Restrict completion to the pcs set in goal (nBits entries), the ones left
+ * open by the static verdicts. NULL goes back to full coverage.
+ */
+void coverage_set_goal(const uint8_t* goal) {
+    if (!coverage.is_initialized) return;
+
+    free(coverage.goal);
+    coverage.goal = NULL;
+
+    if (goal) {
+        coverage.goal = malloc(coverage.nBits);
+        if (coverage.goal) {
+            memcpy(coverage.goal, goal, coverage.nBits);
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+
+#include "determinism.h"
+
+#include "common.h"
+#include "domain_interval.h"
+#include "interpreter_abstract.h"
+#include "log.h"
+#include "vector.h"
+
+#include <omp.h>
+#include <stdlib.h>
+
+// randomized schedules tried for every thread count, on top of the plain one
+#define DETERMINISM_SEEDS 3
+
+static const int thread_counts[] = { 1, 2, 4, 8 };
+
+typedef struct {
+    Vector* states; // Vector<char*>, canonical X_out per node
+    Vector* result; // Vector<char*>, canonical AbstractResult per local
+} Run;
+
+static void run_clear(Run* run)
+{
+    Vector* vectors[] = { run->states, run->result };
+
+    for (int v = 0; v < 2; v++) {
+        for (size_t i = 0; vectors[v] && i < vector_length(vectors[v]); i++) {
+            free(*(char**)vector_get(vectors[v], i));
+        }
+        vector_delete(vectors[v]);
+    }
+
+    run->states = NULL;
+    run->result = NULL;
+}
+
+static void push_result(Vector* canonical, const AbstractResult* result)
+{
+    for (int i = 0; i < result->num_locals; i++) {
+        char* text = NULL;
+        size_t size = 0;
+        FILE* stream = open_memstream(&text, &size);
+        if (!stream) {
+            continue;
+        }
+
+        for (size_t j = 0; j < vector_length(result->results[i]); j++) {
+            Interval* iv = vector_get(result->results[i], j);
+            if (is_interval_bottom(*iv)) {
+                fprintf(stream, " bottom");
+            } else {
+                fprintf(stream, " [%d, %d]", iv->lower, iv->upper);
+            }
+        }
+
+        fclose(stream);
+        vector_push(canonical, &text);
+    }
+}
+
+static int run_once(const Method* m, const Options* opts, const Config* cfg, int threads, unsigned seed, Run* run)
+{
+    run->states = vector_new(sizeof(char*));
+    run->result = vector_new(sizeof(char*));
+    if (!run->states || !run->result) {
+        return FAILURE;
+    }
+
+    AbstractContext* ctx = interpreter_abstract_setup(m, opts, cfg);
+    if (!ctx) {
+        return FAILURE;
+    }
+
+    interpreter_abstract_set_schedule(ctx, threads, seed);
+    interpreter_abstract_record_states(ctx, run->states);
+
+    AbstractResult result = interpreter_abstract_run(ctx);
+    if (!result.results) {
+        return FAILURE;
+    }
+
+    push_result(run->result, &result);
+    abstract_result_delete(&result);
+
+    return SUCCESS;
+}
+
+// index of the first different entry, -1 if there is none
+static int first_divergence(const Vector* a, const Vector* b)
+{
+    size_t length = MIN(vector_length(a), vector_length(b));
+
+    for (size_t i = 0; i < length; i++) {
+        const char* x = *(char**)vector_get(a, i);
+        const char* y = *(char**)vector_get(b, i);
+
+        if (!x || !y || strcmp(x, y) != 0) {
+            return i;
+        }
+    }
+
+    return vector_length(a) == vector_length(b) ? -1 : (int)length;
+}
+
+static const char* entry(const Vector* v, int i)
+{
+    if (i >= (int)vector_length(v)) {
+        return "missing";
+    }
+
+    const char* text = *(char**)vector_get(v, i);
+    return text ? text : "unavailable";
+}
+
+static int compare_runs(const Run* reference, const Run* run, int threads, unsigned seed)
+{
+    int node = first_divergence(reference->states, run->states);
+    if (node != -1) {
+        LOG_ERROR("%d threads, seed %u: X_out of node %d diverges", threads, seed, node);
+        LOG_ERROR("  sequential: %s", entry(reference->states, node));
+        LOG_ERROR("  this run:   %s", entry(run->states, node));
+        return FAILURE;
+    }
+
+    int local = first_divergence(reference->result, run->result);
+    if (local != -1) {
+        LOG_ERROR("%d threads, seed %u: result of local %d diverges", threads, seed, local);
+        LOG_ERROR("  sequential:%s", entry(reference->result, local));
+        LOG_ERROR("  this run:  %s", entry(run->result, local));
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+int determinism_check(const Method* m, const Options* opts, const Config* cfg)
+{
+    // every run has to solve the fixpoint, all the way
+    Config local_cfg = *cfg;
+    local_cfg.cache = NULL;
+    local_cfg.deadline = 0;
+
+    Run reference = { 0 };
+    int result = FAILURE;
+
+    if (run_once(m, opts, &local_cfg, 1, 0, &reference)) {
+        LOG_ERROR("Sequential reference run failed");
+        goto cleanup;
+    }
+
+    if (cfg->sparse) {
+        LOG_INFO("The sparse analysis is sequential, only its results are compared");
+    }
+
+    int counts = sizeof(thread_counts) / sizeof(thread_counts[0]);
+    int max_threads = MAX(omp_get_max_threads(), thread_counts[counts - 1]);
+    int runs = 0;
+    int diverging = 0;
+
+    // the fixed counts, then the whole machine if it is larger
+    for (int t = 0; t <= counts; t++) {
+        int threads = t < counts ? thread_counts[t] : max_threads;
+        if (t == counts && threads == thread_counts[counts - 1]) {
+            break;
+        }
+
+        for (unsigned seed = 0; seed <= DETERMINISM_SEEDS; seed++) {
+            // the reference itself
+            if (threads == 1 && seed == 0) {
+                continue;
+            }
+
+            Run run = { 0 };
+            runs++;
+
+            if (run_once(m, opts, &local_cfg, threads, seed, &run)) {
+                LOG_ERROR("%d threads, seed %u: run failed", threads, seed);
+                diverging++;
+            } else if (compare_runs(&reference, &run, threads, seed)) {
+                diverging++;
+            }
+
+            run_clear(&run);
+        }
+    }
+
+    if (diverging) {
+        LOG_ERROR("%d of %d runs diverge from the sequential one", diverging, runs);
+    } else {
+        LOG_INFO("%d runs computed the same states as the sequential one", runs);
+        result = SUCCESS;
+    }
+
+cleanup:
+    run_clear(&reference);
+    return result;
+}
@@ -0,0 +1,21 @@
+#include "domain.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static const AbstractDomain* domains[] = {
+    &interval_domain,
+    &constant_domain,
+};
+
+// NULL if no domain has that name
+const AbstractDomain* domain_find(const char* name)
+{
+    for (size_t i = 0; i < sizeof(domains) / sizeof(domains[0]); i++) {
+        if (strcmp(domains[i]->name, name) == 0) {
+            return domains[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,275 @@
+#include "domain_congruence.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// x = r (mod m), m == 0 for the single value r
+typedef struct {
+    long m;
+    long r;
+} Residue;
+
+static long gcd(long a, long b)
+{
+    a = labs(a);
+    b = labs(b);
+
+    while (b) {
+        long t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+static long modulo(long x, long m)
+{
+    long r = x % m;
+    return r < 0 ? r + m : r;
+}
+
+static Residue unpack(Interval iv, Congruence c)
+{
+    if (iv.lower == iv.upper) {
+        return (Residue) { 0, iv.lower };
+    }
+
+    return (Residue) { congruence_modulus(c), congruence_residue(c) };
+}
+
+// wrapping around adds multiples of 2^32, only the power of two part of m survives
+static Residue wrap(Residue x)
+{
+    if (x.m == 0) {
+        return (Residue) { 1, 0 };
+    }
+
+    long m = x.m & -x.m;
+    return (Residue) { m, modulo(x.r, m) };
+}
+
+Congruence congruence_make(long modulus, long residue)
+{
+    modulus = labs(modulus);
+
+    // a single value is kept by the interval
+    if (modulus <= 1) {
+        return CONGRUENCE_TOP;
+    }
+
+    if (modulus > CONGRUENCE_MAX_MODULUS) {
+        long divisor = CONGRUENCE_MAX_MODULUS;
+        while (divisor > 1 && modulus % divisor) {
+            divisor--;
+        }
+
+        if (divisor == 1) {
+            return CONGRUENCE_TOP;
+        }
+        modulus = divisor;
+    }
+
+    return (Congruence)((modulus << 8) | modulo(residue, modulus));
+}
+
+int congruence_modulus(Congruence c)
+{
+    int m = c >> 8;
+    return m ? m : 1;
+}
+
+int congruence_residue(Congruence c)
+{
+    return c & 0xFF;
+}
+
+Congruence congruence_join(Interval a, Congruence ca, Interval b, Congruence cb)
+{
+    if (is_interval_bottom(a)) {
+        return cb;
+    }
+
+    if (is_interval_bottom(b)) {
+        return ca;
+    }
+
+    Residue x = unpack(a, ca);
+    Residue y = unpack(b, cb);
+
+    return congruence_make(gcd(gcd(x.m, y.m), x.r - y.r), x.r);
+}
+
+// false when no value has both congruences
+bool congruence_meet(Interval a, Congruence ca, Interval b, Congruence cb, Congruence* result)
+{
+    if (is_interval_bottom(a) || is_interval_bottom(b)) {
+        *result = CONGRUENCE_TOP;
+        return true;
+    }
+
+    Residue x = unpack(a, ca);
+    Residue y = unpack(b, cb);
+
+    if (x.m == 0 || y.m == 0) {
+        Residue exact = x.m == 0 ? x : y;
+        Residue other = x.m == 0 ? y : x;
+
+        *result = CONGRUENCE_TOP;
+        return other.m == 0 ? exact.r == other.r : modulo(exact.r - other.r, other.m) == 0;
+    }
+
+    long g = gcd(x.m, y.m);
+    if (modulo(x.r - y.r, g)) {
+        return false;
+    }
+
+    long lcm = x.m / g * y.m;
+    if (lcm > CONGRUENCE_MAX_MODULUS) {
+        *result = x.m >= y.m ? congruence_make(x.m, x.r) : congruence_make(y.m, y.r);
+        return true;
+    }
+
+    // the first value of x that y admits, within y.m / g steps
+    long v = x.r;
+    while (modulo(v - y.r, y.m)) {
+        v += x.m;
+    }
+
+    *result = congruence_make(lcm, v);
+    return true;
+}
+
+bool congruence_leq(Interval a, Congruence ca, Interval b, Congruence cb)
+{
+    if (is_interval_bottom(a)) {
+        return true;
+    }
+
+    if (is_interval_bottom(b)) {
+        return false;
+    }
+
+    Residue x = unpack(a, ca);
+    Residue y = unpack(b, cb);
+
+    if (y.m == 0) {
+        return x.m == 0 && x.r == y.r;
+    }
+
+    return x.m % y.m == 0 && modulo(x.r - y.r, y.m) == 0;
+}
+
+// whether the exact result of a op b can leave the int range
+static bool may_wrap(BinaryOperator op, Interval a, Interval b)
+{
+    long lower, upper;
+
+    switch (op) {
+    case BO_ADD:
+        lower = (long)a.lower + b.lower;
+        upper = (long)a.upper + b.upper;
+        break;
+    case BO_SUB:
+        lower = (long)a.lower - b.upper;
+        upper = (long)a.upper - b.lower;
+        break;
+    case BO_MUL: {
+        long products[4] = {
+            (long)a.lower * b.lower,
+            (long)a.lower * b.upper,
+            (long)a.upper * b.lower,
+            (long)a.upper * b.upper,
+        };
+
+        lower = upper = products[0];
+        for (int i = 1; i < 4; i++) {
+            lower = products[i] < lower ? products[i] : lower;
+            upper = products[i] > upper ? products[i] : upper;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    return lower < INT_MIN || upper > INT_MAX;
+}
+
+Congruence congruence_binary(BinaryOperator op, Interval a, Congruence ca, Interval b, Congruence cb)
+{
+    if (is_interval_bottom(a) || is_interval_bottom(b)) {
+        return CONGRUENCE_TOP;
+    }
+
+    Residue x = unpack(a, ca);
+    Residue y = unpack(b, cb);
+    Residue z;
+
+    switch (op) {
+    case BO_ADD:
+        z = (Residue) { gcd(x.m, y.m), x.r + y.r };
+        break;
+    case BO_SUB:
+        z = (Residue) { gcd(x.m, y.m), x.r - y.r };
+        break;
+    case BO_MUL:
+        z = (Residue) { gcd(gcd(x.m * y.m, x.r * y.m), y.r * x.m), x.r * y.r };
+        break;
+    case BO_REM:
+        // x % k is x minus a multiple of k, it keeps x modulo any divisor of k
+        if (y.m != 0 || y.r == 0) {
+            return CONGRUENCE_TOP;
+        }
+        z = (Residue) { gcd(x.m, y.r), x.r };
+        break;
+    default:
+        return CONGRUENCE_TOP;
+    }
+
+    if (may_wrap(op, a, b)) {
+        z = wrap(z);
+    }
+
+    return congruence_make(z.m, z.r);
+}
+
+Congruence congruence_negate(Interval a, Congruence ca)
+{
+    if (is_interval_bottom(a)) {
+        return CONGRUENCE_TOP;
+    }
+
+    Residue x = unpack(a, ca);
+    Residue z = { x.m, -x.r };
+
+    // -INT_MIN wraps around to itself
+    if (a.lower == INT_MIN) {
+        z = wrap(z);
+    }
+
+    return congruence_make(z.m, z.r);
+}
+
+/*
+ * Tightest interval within iv whose bounds have congruence c, bottom if
+ * there is none. The congruence of a slot always holds for its values, a
+ * single one included.
+ */
+Interval congruence_reduce(Interval iv, Congruence c)
+{
+    int m = congruence_modulus(c);
+    if (m == 1 || is_interval_bottom(iv)) {
+        return iv;
+    }
+
+    long r = congruence_residue(c);
+    long lower = iv.lower + modulo(r - iv.lower, m);
+    long upper = iv.upper - modulo(iv.upper - r, m);
+
+    if (lower > upper) {
+        return interval_bottom();
+    }
+
+    return (Interval) { (int)lower, (int)upper };
+}
@@ -0,0 +1,797 @@
+#include "domain_constant.h"
+#include "common.h"
+#include "log.h"
+#include "opcode.h"
+#include "type.h"
+#include "vector.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*** VALUES ***/
+
+// an interval rounded up to the domain, a single value or top
+static Interval constant_of(Interval iv)
+{
+    if (is_interval_bottom(iv) || iv.lower == iv.upper) {
+        return iv;
+    }
+
+    return interval_top();
+}
+
+static bool constant_equal(Interval a, Interval b)
+{
+    return a.lower == b.lower && a.upper == b.upper;
+}
+
+static Interval constant_join_single(Interval a, Interval b)
+{
+    return constant_of(interval_join_single(a, b));
+}
+
+// a value outside the range of its type was truncated into it
+static Interval constant_clamp(Interval iv, const Type* type)
+{
+    Interval range = interval_type_range(type);
+    if (!is_interval_bottom(iv) && (iv.lower < range.lower || iv.upper > range.upper)) {
+        return interval_top();
+    }
+
+    return iv;
+}
+
+/*** STATE ***/
+
+static int state_width(int max_locals, int max_stack)
+{
+    return max_locals + max_stack;
+}
+
+static int slots_in_use(const ConstantState* st)
+{
+    return st->max_locals + st->stack_len;
+}
+
+static void state_bind(ConstantState* st, Interval* slots, int max_locals, int max_stack)
+{
+    st->slots = slots;
+    st->max_locals = max_locals;
+    st->max_stack = max_stack;
+    st->stack_len = 0;
+    st->bottom = true;
+    st->version = 0;
+
+    for (int i = 0; i < state_width(max_locals, max_stack); i++) {
+        st->slots[i] = interval_bottom();
+    }
+}
+
+static ConstantState* state_new(int max_locals, int max_stack)
+{
+    ConstantState* st = malloc(sizeof(ConstantState) + sizeof(Interval) * state_width(max_locals, max_stack));
+    if (!st) {
+        LOG_ERROR("Cannot allocate a constant state");
+        return NULL;
+    }
+
+    state_bind(st, (Interval*)(st + 1), max_locals, max_stack);
+    return st;
+}
+
+static void commit_version(ConstantState* st, int changed, int* changed_out)
+{
+    if (changed) {
+        st->version++;
+
+        if (changed_out) {
+            *changed_out = 1;
+        }
+    }
+}
+
+static int write_slot(ConstantState* st, int i, Interval iv)
+{
+    if (constant_equal(st->slots[i], iv)) {
+        return 0;
+    }
+
+    st->slots[i] = iv;
+    return 1;
+}
+
+static int write_frame(ConstantState* st, int stack_len, bool bottom)
+{
+    if (st->stack_len == stack_len && st->bottom == bottom) {
+        return 0;
+    }
+
+    st->stack_len = stack_len;
+    st->bottom = bottom;
+
+    return 1;
+}
+
+static void state_set(ConstantState* st, Interval iv, bool bottom)
+{
+    int changed = 0;
+
+    for (int i = 0; i < st->max_locals; i++) {
+        changed |= write_slot(st, i, iv);
+    }
+
+    changed |= write_frame(st, 0, bottom);
+    commit_version(st, changed, NULL);
+}
+
+ConstantState* constant_new_top_state(int max_locals, int max_stack)
+{
+    ConstantState* st = state_new(max_locals, max_stack);
+    if (st) {
+        state_set(st, interval_top(), false);
+    }
+
+    return st;
+}
+
+ConstantState* constant_new_bottom_state(int max_locals, int max_stack)
+{
+    return state_new(max_locals, max_stack);
+}
+
+void constant_state_set_top(ConstantState* st)
+{
+    state_set(st, interval_top(), false);
+}
+
+void constant_state_set_bottom(ConstantState* st)
+{
+    state_set(st, interval_bottom(), true);
+}
+
+bool is_constant_state_bottom(const ConstantState* st)
+{
+    return !st || st->bottom;
+}
+
+// states allocated by a slab are released with it
+void constant_state_delete(ConstantState* st)
+{
+    free(st);
+}
+
+int constant_state_copy(ConstantState* dst, const ConstantState* src)
+{
+    if (!dst || !src) {
+        return FAILURE;
+    }
+
+    if (dst->max_locals != src->max_locals || dst->max_stack != src->max_stack) {
+        LOG_ERROR("Copy between abstract states of different frames");
+        return FAILURE;
+    }
+
+    int len = slots_in_use(src);
+    int changed = memcmp(dst->slots, src->slots, sizeof(Interval) * len) != 0;
+
+    memcpy(dst->slots, src->slots, sizeof(Interval) * len);
+    changed |= write_frame(dst, src->stack_len, src->bottom);
+    commit_version(dst, changed, NULL);
+
+    return SUCCESS;
+}
+
+// no argument type narrows to a single value, the arguments stay top
+int constant_state_set_arguments(ConstantState* st, const Vector* types)
+{
+    if (!st || !types) {
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+bool constant_state_leq(const ConstantState* a, const ConstantState* b)
+{
+    if (is_constant_state_bottom(a)) {
+        return true;
+    }
+
+    if (is_constant_state_bottom(b) || a->stack_len > b->stack_len) {
+        return false;
+    }
+
+    for (int i = 0; i < slots_in_use(a); i++) {
+        if (!is_interval_bottom(a->slots[i]) && !constant_equal(b->slots[i], interval_top())
+            && !constant_equal(a->slots[i], b->slots[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*** LATTICE ***/
+
+int constant_join(ConstantState* acc, const ConstantState* new, int* changed)
+{
+    if (!acc || !new || !changed) {
+        return FAILURE;
+    }
+    *changed = 0;
+
+    if (is_constant_state_bottom(new)) {
+        return SUCCESS;
+    }
+
+    if (is_constant_state_bottom(acc)) {
+        *changed = 1;
+        return constant_state_copy(acc, new);
+    }
+
+    int len = MIN(slots_in_use(acc), slots_in_use(new));
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        any |= write_slot(acc, i, constant_join_single(acc->slots[i], new->slots[i]));
+    }
+
+    // stacks of verified code agree on their height, keep the longest anyway
+    for (int i = slots_in_use(acc); i < slots_in_use(new); i++) {
+        acc->slots[i] = new->slots[i];
+    }
+
+    any |= write_frame(acc, MAX(acc->stack_len, new->stack_len), false);
+    commit_version(acc, any, changed);
+
+    return SUCCESS;
+}
+
+// no infinite ascending chain, widening is a join and needs no thresholds
+int constant_widening(ConstantState* acc, const ConstantState* new, const int* thresholds, int thresholds_count, int* changed)
+{
+    (void)thresholds;
+    (void)thresholds_count;
+
+    return constant_join(acc, new, changed);
+}
+
+// a value top after widening gets the one of new back
+int constant_narrowing(ConstantState* acc, const ConstantState* new, int* changed)
+{
+    if (!acc || !new || !changed) {
+        return FAILURE;
+    }
+    *changed = 0;
+
+    if (is_constant_state_bottom(acc) || is_constant_state_bottom(new)) {
+        return SUCCESS;
+    }
+
+    int len = MIN(slots_in_use(acc), slots_in_use(new));
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        if (constant_equal(acc->slots[i], interval_top()) && !is_interval_bottom(new->slots[i])) {
+            any |= write_slot(acc, i, new->slots[i]);
+        }
+    }
+
+    commit_version(acc, any, changed);
+
+    return SUCCESS;
+}
+
+/*** TRANSFER ***/
+
+static int stack_push(ConstantState* st, Interval iv)
+{
+    if (st->stack_len >= st->max_stack) {
+        LOG_ERROR("Abstract stack overflow, max stack %d", st->max_stack);
+        return FAILURE;
+    }
+
+    st->slots[st->max_locals + st->stack_len++] = iv;
+    return SUCCESS;
+}
+
+static int stack_pop(ConstantState* st, Interval* iv)
+{
+    if (!st->stack_len) {
+        LOG_ERROR("Abstract stack underflow");
+        return FAILURE;
+    }
+
+    st->stack_len--;
+
+    if (iv) {
+        *iv = st->slots[st->max_locals + st->stack_len];
+    }
+
+    return SUCCESS;
+}
+
+static int handle_push(ConstantState* st, IrInstruction* ins)
+{
+    PushOP* push = &ins->data.push;
+    int value;
+
+    if (push->value.type == TYPE_INT) {
+        value = push->value.data.int_value;
+    } else if (push->value.type == TYPE_BOOLEAN) {
+        value = push->value.data.bool_value;
+    } else if (push->value.type == TYPE_CHAR) {
+        value = push->value.data.char_value;
+    } else if (push->value.type == TYPE_REFERENCE) {
+        value = ARRAY_NULL;
+    } else {
+        return FAILURE;
+    }
+
+    return stack_push(st, (Interval) { value, value });
+}
+
+static int handle_load(ConstantState* st, IrInstruction* ins)
+{
+    LoadOP* load = &ins->data.load;
+
+    if (load->index < 0 || load->index >= st->max_locals) {
+        LOG_ERROR("Local is not defined, max locals: %d", st->max_locals);
+        return FAILURE;
+    }
+
+    return stack_push(st, constant_clamp(st->slots[load->index], load->type));
+}
+
+static int handle_store(ConstantState* st, IrInstruction* ins)
+{
+    StoreOP* store = &ins->data.store;
+    Interval iv;
+
+    if (stack_pop(st, &iv) || store->index < 0 || store->index >= st->max_locals) {
+        return FAILURE;
+    }
+
+    st->slots[store->index] = constant_clamp(iv, store->type);
+    return SUCCESS;
+}
+
+static int handle_dup(ConstantState* st)
+{
+    Interval iv;
+    if (stack_pop(st, &iv)) {
+        return FAILURE;
+    }
+
+    if (stack_push(st, iv)) {
+        return FAILURE;
+    }
+
+    return stack_push(st, iv);
+}
+
+static int handle_binary(ConstantState* st, IrInstruction* ins)
+{
+    Interval a, b, result;
+    if (stack_pop(st, &b) || stack_pop(st, &a)) {
+        return FAILURE;
+    }
+
+    if (interval_binary(ins->data.binary.op, a, b, &result)) {
+        LOG_ERROR("While constant binary op");
+        return FAILURE;
+    }
+
+    return stack_push(st, constant_of(result));
+}
+
+static int handle_negate(ConstantState* st)
+{
+    Interval iv;
+    if (stack_pop(st, &iv)) {
+        return FAILURE;
+    }
+
+    return stack_push(st, constant_of(interval_negate(iv)));
+}
+
+static int handle_incr(ConstantState* st, IrInstruction* ins)
+{
+    IncrOP* incr = &ins->data.incr;
+    if (incr->index < 0 || incr->index >= st->max_locals) {
+        return FAILURE;
+    }
+
+    Interval amount = { incr->amount, incr->amount };
+    Interval result;
+
+    interval_binary(BO_ADD, st->slots[incr->index], amount, &result);
+    st->slots[incr->index] = constant_of(result);
+
+    return SUCCESS;
+}
+
+static int handle_new_array(ConstantState* st, IrInstruction* ins)
+{
+    Interval length = interval_top();
+
+    // the outermost dimension is the deepest on the stack
+    for (int i = 0; i < ins->data.new_array.dim; i++) {
+        if (stack_pop(st, &length)) {
+            return FAILURE;
+        }
+    }
+
+    // a negative length throws
+    if (length.lower == length.upper && length.lower < 0) {
+        constant_state_set_bottom(st);
+        return SUCCESS;
+    }
+
+    return stack_push(st, length);
+}
+
+// the access goes on only with a non null array and a known index within its known length
+static bool array_access(ConstantState* st, Interval array, Interval index)
+{
+    bool null = array.lower == ARRAY_NULL && array.upper == ARRAY_NULL;
+    bool outside = index.lower == index.upper
+        && (index.lower < 0 || (array.lower == array.upper && index.lower >= array.lower));
+
+    if (null || outside) {
+        constant_state_set_bottom(st);
+        return false;
+    }
+
+    return true;
+}
+
+static int handle_array_length(ConstantState* st)
+{
+    Interval array;
+    if (stack_pop(st, &array)) {
+        return FAILURE;
+    }
+
+    if (array.lower == ARRAY_NULL && array.upper == ARRAY_NULL) {
+        constant_state_set_bottom(st);
+        return SUCCESS;
+    }
+
+    return stack_push(st, array.lower == array.upper ? array : interval_top());
+}
+
+static int handle_array_load(ConstantState* st)
+{
+    Interval index, array;
+    if (stack_pop(st, &index) || stack_pop(st, &array)) {
+        return FAILURE;
+    }
+
+    if (!array_access(st, array, index)) {
+        return SUCCESS;
+    }
+
+    return stack_push(st, interval_top());
+}
+
+static int handle_array_store(ConstantState* st)
+{
+    Interval index, array;
+    if (stack_pop(st, NULL) || stack_pop(st, &index) || stack_pop(st, &array)) {
+        return FAILURE;
+    }
+
+    array_access(st, array, index);
+    return SUCCESS;
+}
+
+int constant_transfer(ConstantState* out_state, IrInstruction* ir_instruction)
+{
+    if (!out_state || !ir_instruction) {
+        return FAILURE;
+    }
+
+    // an earlier instruction of the block always throws
+    if (is_constant_state_bottom(out_state)) {
+        return SUCCESS;
+    }
+
+    int result = SUCCESS;
+
+    switch (ir_instruction->opcode) {
+    case OP_LOAD:
+        result = handle_load(out_state, ir_instruction);
+        break;
+    case OP_PUSH:
+        result = handle_push(out_state, ir_instruction);
+        break;
+    case OP_STORE:
+        result = handle_store(out_state, ir_instruction);
+        break;
+    case OP_DUP:
+        result = handle_dup(out_state);
+        break;
+    case OP_BINARY:
+        result = handle_binary(out_state, ir_instruction);
+        break;
+    case OP_GET:
+    case OP_NEW:
+        result = stack_push(out_state, interval_top());
+        break;
+    case OP_NEGATE:
+        result = handle_negate(out_state);
+        break;
+    case OP_INCR:
+        result = handle_incr(out_state, ir_instruction);
+        break;
+    case OP_NEW_ARRAY:
+        result = handle_new_array(out_state, ir_instruction);
+        break;
+    case OP_ARRAY_LENGTH:
+        result = handle_array_length(out_state);
+        break;
+    case OP_ARRAY_LOAD:
+        result = handle_array_load(out_state);
+        break;
+    case OP_ARRAY_STORE:
+        result = handle_array_store(out_state);
+        break;
+    default:
+        break;
+    }
+
+    if (result) {
+        LOG_ERROR("%s", opcode_print(ir_instruction->opcode));
+    }
+
+    return SUCCESS;
+}
+
+// the callee frame starts with the arguments popped from the caller stack
+int constant_transfer_invoke(ConstantState* out_state, ConstantState* in_state, int locals_num)
+{
+    if (!out_state || !in_state) {
+        return FAILURE;
+    }
+
+    if (is_constant_state_bottom(in_state)) {
+        constant_state_set_bottom(out_state);
+        return SUCCESS;
+    }
+
+    if (locals_num > out_state->max_locals || locals_num > in_state->stack_len) {
+        LOG_ERROR("Invoke with %d arguments, stack len %d", locals_num, in_state->stack_len);
+        return FAILURE;
+    }
+
+    constant_state_set_top(out_state);
+    for (int i = locals_num - 1; i >= 0; i--) {
+        stack_pop(in_state, &out_state->slots[i]);
+    }
+
+    return SUCCESS;
+}
+
+// both edges start from the state before the branch, the one known not taken is dropped
+int constant_transfer_conditional(ConstantState* out_state_true, ConstantState* out_state_false, IrInstruction* ir_instruction)
+{
+    if (!out_state_true || !out_state_false || !ir_instruction) {
+        return FAILURE;
+    }
+
+    if (is_constant_state_bottom(out_state_true) || is_constant_state_bottom(out_state_false)) {
+        constant_state_set_bottom(out_state_true);
+        constant_state_set_bottom(out_state_false);
+        return SUCCESS;
+    }
+
+    Interval x, y = { 0, 0 };
+    int operands = ir_instruction->opcode == OP_IF ? 2 : 1;
+
+    if (ir_instruction->opcode != OP_IF && ir_instruction->opcode != OP_IF_ZERO) {
+        LOG_ERROR("%s", opcode_print(ir_instruction->opcode));
+        return SUCCESS;
+    }
+
+    if ((operands == 2 && stack_pop(out_state_true, &y)) || stack_pop(out_state_true, &x)) {
+        return FAILURE;
+    }
+
+    for (int i = 0; i < operands; i++) {
+        if (stack_pop(out_state_false, NULL)) {
+            return FAILURE;
+        }
+    }
+
+    Interval true_branch, false_branch;
+    interval_branch(ir_instruction->data.ift.condition, &x, &y, &true_branch, &false_branch);
+
+    if (is_interval_bottom(true_branch)) {
+        constant_state_set_bottom(out_state_true);
+    }
+
+    if (is_interval_bottom(false_branch)) {
+        constant_state_set_bottom(out_state_false);
+    }
+
+    return SUCCESS;
+}
+
+// the value returned leaves the frame, the caller continues from the edge
+int constant_transfer_return(ConstantState* out_state)
+{
+    if (!out_state) {
+        return FAILURE;
+    }
+
+    if (out_state->stack_len) {
+        out_state->stack_len--;
+    }
+
+    return SUCCESS;
+}
+
+static void constant_print(const char* prefix, int i, Interval iv)
+{
+    if (constant_equal(iv, interval_top()))
+        LOG_INFO("%s%d = [⊤]", prefix, i);
+    else if (is_interval_bottom(iv))
+        LOG_INFO("%s%d = [⊥]", prefix, i);
+    else
+        LOG_INFO("%s%d = %d", prefix, i, iv.lower);
+}
+
+void constant_state_print(const ConstantState* st)
+{
+    if (!st) {
+        LOG_INFO("(null)");
+        return;
+    }
+
+    if (is_constant_state_bottom(st)) {
+        LOG_INFO("[⊥]");
+        return;
+    }
+
+    LOG_INFO("Locals:");
+    for (int i = 0; i < st->max_locals; i++) {
+        constant_print("v", i, st->slots[i]);
+    }
+
+    LOG_INFO("Stack:");
+    for (int i = 0; i < st->stack_len; i++) {
+        constant_print("s", i, st->slots[st->max_locals + i]);
+    }
+}
+
+// bottom states compare equal whatever their slots hold
+void constant_state_write(FILE* stream, const ConstantState* st)
+{
+    if (is_constant_state_bottom(st)) {
+        fprintf(stream, "bottom");
+        return;
+    }
+
+    fprintf(stream, "stack %d:", st->stack_len);
+    for (int i = 0; i < slots_in_use(st); i++) {
+        fprintf(stream, " [%d, %d]", st->slots[i].lower, st->slots[i].upper);
+    }
+}
+
+/*** SLAB ***/
+
+// states of a whole analysis, with their slots in one allocation
+struct ConstantSlab {
+    int count;
+    ConstantState* states;
+    Interval* slots;
+};
+
+ConstantSlab* constant_slab_new(int count, int max_locals, int max_stack)
+{
+    ConstantSlab* slab = malloc(sizeof(ConstantSlab));
+    if (!slab) {
+        return NULL;
+    }
+
+    int width = state_width(max_locals, max_stack);
+
+    slab->count = 0;
+    slab->states = malloc(sizeof(ConstantState) * count);
+    slab->slots = malloc(sizeof(Interval) * width * count);
+
+    if (!slab->states || !slab->slots) {
+        constant_slab_delete(slab);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        state_bind(&slab->states[i], slab->slots + (size_t)width * i, max_locals, max_stack);
+    }
+
+    slab->count = count;
+
+    return slab;
+}
+
+ConstantState* constant_slab_state(ConstantSlab* slab, int index)
+{
+    if (!slab || index < 0 || index >= slab->count) {
+        return NULL;
+    }
+
+    return &slab->states[index];
+}
+
+void constant_slab_delete(ConstantSlab* slab)
+{
+    if (!slab) {
+        return;
+    }
+
+    free(slab->states);
+    free(slab->slots);
+    free(slab);
+}
+
+/*** ARENA ***/
+
+// scratch states of one thread, see interval_arena_new
+struct ConstantArena {
+    Vector* states; // Vector<ConstantState*>
+    size_t used;
+    int max_locals;
+    int max_stack;
+};
+
+ConstantArena* constant_arena_new(int max_locals, int max_stack)
+{
+    ConstantArena* arena = malloc(sizeof(ConstantArena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->states = vector_new(sizeof(ConstantState*));
+    arena->used = 0;
+    arena->max_locals = max_locals;
+    arena->max_stack = max_stack;
+
+    return arena;
+}
+
+// the returned state is bottom
+ConstantState* constant_arena_state(ConstantArena* arena)
+{
+    ConstantState* st;
+
+    if (arena->used < vector_length(arena->states)) {
+        st = *(ConstantState**)vector_get(arena->states, arena->used);
+        constant_state_set_bottom(st);
+    } else {
+        st = constant_new_bottom_state(arena->max_locals, arena->max_stack);
+        vector_push(arena->states, &st);
+    }
+
+    arena->used++;
+    return st;
+}
+
+void constant_arena_reset(ConstantArena* arena)
+{
+    arena->used = 0;
+}
+
+void constant_arena_delete(ConstantArena* arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    for (size_t i = 0; i < vector_length(arena->states); i++) {
+        constant_state_delete(*(ConstantState**)vector_get(arena->states, i));
+    }
+
+    vector_delete(arena->states);
+    free(arena);
+}
@@ -1,11 +1,14 @@
 #include "domain_interval.h"
 #include "common.h"
+#include "domain_congruence.h"
+#include "interval_kernels.h"
 #include "log.h"
 #include "opcode.h"
 #include "type.h"
 #include "vector.h"
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MAKE_INTERVAL(out, L, U) \
     do {                         \
@@ -17,23 +20,23 @@
         }                        \
     } while (0)
 
-static Interval interval_top(void)
+Interval interval_top(void)
 {
     return (Interval) { .lower = INT_MIN, .upper = INT_MAX };
 }
 
-static Interval interval_bottom(void)
+Interval interval_bottom(void)
 {
     return (Interval) { .lower = 1, .upper = -1 };
 }
 
-static int is_interval_bottom(Interval iv)
+bool is_interval_bottom(Interval iv)
 {
     Interval bottom = interval_bottom();
     return iv.lower == bottom.lower && iv.upper == bottom.upper;
 }
 
-static Interval interval_join_single(Interval a, Interval b)
+Interval interval_join_single(Interval a, Interval b)
 {
     if (is_interval_bottom(a)) {
         return b;
@@ -55,369 +58,874 @@ static Interval interval_intersect_single(Interval a, Interval b)
     };
 }
 
-static Interval interval_widen_single(Interval old, Interval newer)
+// largest threshold <= value, INT_MIN if there is none
+static int threshold_below(int value, const int* thresholds, int thresholds_count)
 {
-    Interval r = old;
+    int result = INT_MIN;
+    for (int i = 0; i < thresholds_count && thresholds[i] <= value; i++) {
+        result = thresholds[i];
+    }
 
-    if (newer.lower < old.lower) {
-        r.lower = INT_MIN;
+    return result;
+}
+
+// smallest threshold >= value, INT_MAX if there is none
+static int threshold_above(int value, const int* thresholds, int thresholds_count)
+{
+    for (int i = 0; i < thresholds_count; i++) {
+        if (thresholds[i] >= value) {
+            return thresholds[i];
+        }
     }
 
-    r.lower = MIN(r.lower, MIN(newer.lower, old.lower));
+    return INT_MAX;
+}
 
-    LOG_DEBUG("NEW UPPER %d", newer.upper);
-    LOG_DEBUG("OLD UPPER %d", old.upper);
+// thresholds must be sorted in ascending order
+Interval interval_widen_single(Interval old, Interval newer, const int* thresholds, int thresholds_count)
+{
+    if (is_interval_bottom(old)) {
+        return newer;
+    } else if (is_interval_bottom(newer)) {
+        return old;
+    }
+
+    Interval r = old;
+
+    if (newer.lower < old.lower) {
+        r.lower = threshold_below(newer.lower, thresholds, thresholds_count);
+    }
 
     if (newer.upper > old.upper) {
-        r.upper = INT_MAX;
+        r.upper = threshold_above(newer.upper, thresholds, thresholds_count);
     }
 
-    r.upper = MAX(r.upper, MAX(newer.upper, old.upper));
+    LOG_DEBUG("WIDEN [%d, %d] WITH [%d, %d] -> [%d, %d]", old.lower, old.upper, newer.lower, newer.upper, r.lower, r.upper);
+
+    return r;
+}
+
+Interval interval_narrow_single(Interval old, Interval newer)
+{
+    if (is_interval_bottom(old) || is_interval_bottom(newer)) {
+        return old;
+    }
 
-    LOG_DEBUG("RESULT UPPER %d", r.upper);
+    Interval r = interval_intersect_single(old, newer);
+    if (r.lower > r.upper) {
+        return old;
+    }
 
     return r;
 }
 
-IntervalState* interval_new_top_state(int num_locals)
+/*** STATE ***/
+
+static int state_width(int max_locals, int max_stack)
 {
-    IntervalState* st = malloc(sizeof(IntervalState));
-    if (!st) {
+    return max_locals + max_stack;
+}
+
+/*
+ * The slots of a state, their congruences and the stack origins live in a
+ * page that copies share: a copy takes a reference to the page of its source
+ * instead of its contents, and a state writes to its page only once no other
+ * state holds it. An edge state, the input it feeds and the output it came
+ * from usually end up on a single page. Stamps stay with each state, they
+ * count the versions of that state only.
+ */
+struct IntervalPage {
+    int refs;
+    Interval slots[]; // then elements[width], origin[max_stack] and congruence[width]
+};
+
+static size_t page_size(int max_locals, int max_stack)
+{
+    int width = state_width(max_locals, max_stack);
+    return sizeof(IntervalPage) + sizeof(Interval) * 2 * width + sizeof(int) * max_stack + sizeof(Congruence) * width;
+}
+
+static IntervalPage* page_new(int max_locals, int max_stack)
+{
+    IntervalPage* page = malloc(page_size(max_locals, max_stack));
+    if (!page) {
+        LOG_ERROR("Cannot allocate an abstract state page");
         return NULL;
     }
 
-    st->locals = vector_new(sizeof(int));
-    st->stack = vector_new(sizeof(int));
-    st->env = vector_new(sizeof(Interval));
+    page->refs = 1;
+    return page;
+}
 
-    for (int i = 0; i < num_locals; i++) {
-        vector_push(st->locals, &i);
+// pages move between threads with the states holding them
+static void page_retain(IntervalPage* page)
+{
+#pragma omp atomic seq_cst
+    page->refs++;
+}
 
-        Interval iv = interval_top();
-        vector_push(st->env, &iv);
+static void page_release(IntervalPage* page)
+{
+    if (!page) {
+        return;
     }
 
-    return st;
+    int refs;
+#pragma omp atomic capture seq_cst
+    refs = --page->refs;
+
+    if (!refs) {
+        free(page);
+    }
 }
 
-IntervalState* interval_new_bottom_state(int num_locals)
+static bool page_shared(const IntervalPage* page)
 {
-    IntervalState* st = malloc(sizeof(IntervalState));
-    if (!st) {
-        return NULL;
+    int refs;
+#pragma omp atomic read seq_cst
+    refs = page->refs;
+
+    return refs > 1;
+}
+
+static void state_attach(IntervalState* st, IntervalPage* page)
+{
+    st->page = page;
+    st->slots = page->slots;
+    st->elements = st->slots + state_width(st->max_locals, st->max_stack);
+    st->origin = (int*)(st->elements + state_width(st->max_locals, st->max_stack));
+    st->congruence = (Congruence*)(st->origin + st->max_stack);
+}
+
+static void state_bind(IntervalState* st, unsigned* stamp, IntervalPage* page, int max_locals, int max_stack)
+{
+    st->stamp = stamp;
+    st->max_locals = max_locals;
+    st->max_stack = max_stack;
+    st->stack_len = 0;
+    st->bottom = true;
+    st->version = 0;
+    st->scratch = false;
+    st->spare = NULL;
+
+    memset(st->stamp, 0, sizeof(unsigned) * state_width(max_locals, max_stack));
+    state_attach(st, page);
+}
+
+/*
+ * Arena states are rewritten over and over: the page they leave while no
+ * other state holds it is kept as a spare and taken again by the next write,
+ * instead of going back to malloc.
+ */
+static void state_leave(IntervalState* st)
+{
+    if (st->scratch && !st->spare && !page_shared(st->page)) {
+        st->spare = st->page;
+    } else {
+        page_release(st->page);
     }
+}
 
-    st->locals = vector_new(sizeof(int));
-    st->stack = vector_new(sizeof(int));
-    st->env = vector_new(sizeof(Interval));
+static IntervalPage* state_take(IntervalState* st)
+{
+    IntervalPage* page = st->spare;
+    if (page) {
+        st->spare = NULL;
+        return page;
+    }
 
-    for (int i = 0; i < num_locals; i++) {
-        vector_push(st->locals, &i);
+    return page_new(st->max_locals, st->max_stack);
+}
 
-        Interval iv = interval_bottom();
-        vector_push(st->env, &iv);
+// before a partial write through the slots, a shared page is replaced by a copy
+int interval_state_own(IntervalState* st)
+{
+    if (!page_shared(st->page)) {
+        return SUCCESS;
     }
 
-    return st;
+    IntervalPage* page = state_take(st);
+    if (!page) {
+        return FAILURE;
+    }
+
+    memcpy(page->slots, st->slots, page_size(st->max_locals, st->max_stack) - sizeof(IntervalPage));
+    page_release(st->page);
+    state_attach(st, page);
+
+    return SUCCESS;
 }
 
-void interval_state_delete(IntervalState* st)
+// raw initialization of a page no other state holds, no version is recorded
+static void state_fill(IntervalState* st, Interval iv, bool bottom)
 {
-    if (!st) {
-        return;
+    for (int i = 0; i < state_width(st->max_locals, st->max_stack); i++) {
+        st->elements[i] = interval_top();
+        st->congruence[i] = CONGRUENCE_TOP;
     }
 
-    vector_delete(st->env);
-    vector_delete(st->locals);
-    vector_delete(st->stack);
-    free(st);
+    for (int i = 0; i < st->max_locals; i++) {
+        st->slots[i] = iv;
+    }
+
+    st->stack_len = 0;
+    st->bottom = bottom;
 }
 
-int interval_state_copy(IntervalState* dst, const IntervalState* src)
+static int slots_in_use(const IntervalState* st)
 {
-    if (!dst || !src) {
-        return FAILURE;
+    return st->max_locals + st->stack_len;
+}
+
+/*
+ * Versioned writes: an operation stamps the slots it changes with the next
+ * version of the state, and commit_version makes it the current one if
+ * anything changed. Writes that only touch the stack bookkeeping still count,
+ * transfer results depend on it.
+ */
+static int write_slot(IntervalState* st, int i, Interval iv)
+{
+    if (st->slots[i].lower == iv.lower && st->slots[i].upper == iv.upper) {
+        return 0;
     }
 
-    if (vector_copy(dst->locals, src->locals)) {
-        return FAILURE;
+    st->slots[i] = iv;
+    st->stamp[i] = st->version + 1;
+
+    return 1;
+}
+
+static int write_elements(IntervalState* st, int i, Interval iv)
+{
+    if (st->elements[i].lower == iv.lower && st->elements[i].upper == iv.upper) {
+        return 0;
     }
 
-    if (vector_copy(dst->stack, src->stack)) {
-        return FAILURE;
+    st->elements[i] = iv;
+    st->stamp[i] = st->version + 1;
+
+    return 1;
+}
+
+static int write_congruence(IntervalState* st, int i, Congruence c)
+{
+    if (st->congruence[i] == c) {
+        return 0;
+    }
+
+    st->congruence[i] = c;
+    st->stamp[i] = st->version + 1;
+
+    return 1;
+}
+
+// false when the congruence of slot i leaves no value in its interval
+static bool reduce_slot(IntervalState* st, int i, int* changed)
+{
+    if (st->congruence[i] == CONGRUENCE_TOP) {
+        return true;
+    }
+
+    Interval iv = congruence_reduce(st->slots[i], st->congruence[i]);
+    if (is_interval_bottom(iv) && !is_interval_bottom(st->slots[i])) {
+        return false;
+    }
+
+    *changed |= write_slot(st, i, iv);
+    return true;
+}
+
+static int write_origin(IntervalState* st, int i, int origin)
+{
+    if (st->origin[i] == origin) {
+        return 0;
+    }
+
+    st->origin[i] = origin;
+    return 1;
+}
+
+static int write_frame(IntervalState* st, int stack_len, bool bottom)
+{
+    if (st->stack_len == stack_len && st->bottom == bottom) {
+        return 0;
+    }
+
+    st->stack_len = stack_len;
+    st->bottom = bottom;
+
+    return 1;
+}
+
+static void commit_version(IntervalState* st, int changed, int* changed_out)
+{
+    if (changed) {
+        st->version++;
+
+        if (changed_out) {
+            *changed_out = 1;
+        }
     }
+}
+
+static Interval* stack_slot(const IntervalState* st, int i)
+{
+    return &st->slots[st->max_locals + i];
+}
 
-    if (vector_copy(dst->env, src->env)) {
+static int stack_push(IntervalState* st, Interval iv, Congruence c, int origin)
+{
+    if (st->stack_len >= st->max_stack) {
+        LOG_ERROR("Abstract stack overflow, max stack %d", st->max_stack);
         return FAILURE;
     }
 
+    *stack_slot(st, st->stack_len) = iv;
+    st->elements[st->max_locals + st->stack_len] = interval_top();
+    st->congruence[st->max_locals + st->stack_len] = c;
+    st->origin[st->stack_len] = origin;
+    st->stack_len++;
+
     return SUCCESS;
 }
 
-int interval_join(IntervalState* acc, const IntervalState* new, int* changed)
+static int stack_pop(IntervalState* st, Interval* iv, Congruence* c, int* origin)
 {
-    if (!acc || !new || !changed) {
+    if (!st->stack_len) {
+        LOG_ERROR("Abstract stack underflow");
         return FAILURE;
     }
 
-    // *changed = 0;
+    st->stack_len--;
 
-    int acc_env_len = vector_length(acc->env);
-    int new_env_len = vector_length(new->env);
+    if (iv) {
+        *iv = *stack_slot(st, st->stack_len);
+    }
 
-    while (vector_length(acc->env) < new_env_len) {
-        Interval bottom = interval_bottom();
-        vector_push(acc->env, &bottom);
-        *changed = 1;
+    if (c) {
+        *c = st->congruence[st->max_locals + st->stack_len];
     }
 
-    for (int i = 0; i < new_env_len; i++) {
-        Interval* a = vector_get(acc->env, i);
-        Interval b = *(Interval*)vector_get(new->env, i);
+    if (origin) {
+        *origin = st->origin[st->stack_len];
+    }
 
-        Interval r = interval_join_single(*a, b);
+    return SUCCESS;
+}
 
-        if (r.lower != a->lower || r.upper != a->upper) {
-            *a = r;
-            *changed = 1;
+static int stack_push_array(IntervalState* st, Interval length, Interval elements, int origin)
+{
+    if (stack_push(st, length, CONGRUENCE_TOP, origin)) {
+        return FAILURE;
+    }
+
+    st->elements[st->max_locals + st->stack_len - 1] = elements;
+    return SUCCESS;
+}
+
+// elements of the slot stack_pop just removed, it is left in place
+static Interval popped_elements(const IntervalState* st)
+{
+    return st->elements[st->max_locals + st->stack_len];
+}
+
+// the stack no longer holds copies of a local that has been written
+static void forget_origin(IntervalState* st, int local)
+{
+    for (int i = 0; i < st->stack_len; i++) {
+        if (st->origin[i] == local) {
+            st->origin[i] = -1;
         }
     }
+}
 
-    int locals_len = MIN(vector_length(acc->locals), vector_length(new->locals));
+static IntervalState* state_new(int max_locals, int max_stack, Interval iv, bool bottom)
+{
+    IntervalState* st = malloc(sizeof(IntervalState) + sizeof(unsigned) * state_width(max_locals, max_stack));
+    IntervalPage* page = page_new(max_locals, max_stack);
+    if (!st || !page) {
+        free(st);
+        free(page);
+        return NULL;
+    }
 
-    for (int i = 0; i < locals_len; i++) {
-        int* nameA = (int*)vector_get(acc->locals, i);
-        int nameB = *(int*)vector_get(new->locals, i);
+    state_bind(st, (unsigned*)(st + 1), page, max_locals, max_stack);
+    state_fill(st, iv, bottom);
 
-        if (*nameA == nameB)
-            continue;
+    return st;
+}
 
-        int new_name = vector_length(acc->env);
+IntervalState* interval_new_top_state(int max_locals, int max_stack)
+{
+    return state_new(max_locals, max_stack, interval_top(), false);
+}
 
-        Interval a = *(Interval*)vector_get(acc->env, *nameA);
-        Interval b = *(Interval*)vector_get(new->env, nameB);
+IntervalState* interval_new_bottom_state(int max_locals, int max_stack)
+{
+    return state_new(max_locals, max_stack, interval_bottom(), true);
+}
 
-        Interval r = interval_join_single(a, b);
+// a rewrite of the whole state leaves a shared page without copying it
+static int state_replace(IntervalState* st, Interval iv, bool bottom)
+{
+    IntervalPage* page = state_take(st);
+    if (!page) {
+        return FAILURE;
+    }
+
+    IntervalState old = *st;
+    Interval top = interval_top();
+    state_attach(st, page);
+    state_fill(st, iv, bottom);
+
+    int changed = old.stack_len != 0 || old.bottom != bottom;
+    for (int i = 0; i < st->max_locals; i++) {
+        if (old.slots[i].lower != iv.lower || old.slots[i].upper != iv.upper
+            || old.elements[i].lower != top.lower || old.elements[i].upper != top.upper
+            || old.congruence[i] != CONGRUENCE_TOP) {
+            st->stamp[i] = st->version + 1;
+            changed = 1;
+        }
+    }
 
-        vector_push(acc->env, &r);
+    page_release(old.page);
+    commit_version(st, changed, NULL);
 
-        *nameA = new_name;
-        *changed = 1;
+    return SUCCESS;
+}
+
+static void state_set(IntervalState* st, Interval iv, bool bottom)
+{
+    int changed = 0;
+
+    if (page_shared(st->page)) {
+        state_replace(st, iv, bottom);
+        return;
     }
 
-    for (size_t i = locals_len; i < vector_length(new->locals); i++) {
-        vector_push(acc->locals, vector_get(new->locals, i));
+    for (int i = 0; i < st->max_locals; i++) {
+        changed |= write_slot(st, i, iv);
+        changed |= write_congruence(st, i, CONGRUENCE_TOP);
     }
 
-    int lenA = vector_length(acc->stack);
-    int lenB = vector_length(new->stack);
+    changed |= write_frame(st, 0, bottom);
+    commit_version(st, changed, NULL);
+}
 
-    for (int i = 0; i < MAX(lenA, lenB); i++) {
-        int* nameA = vector_get(acc->stack, i);
-        int* nameB = vector_get(new->stack, i);
+void interval_state_set_top(IntervalState* st)
+{
+    state_set(st, interval_top(), false);
+}
 
-        if (nameA && nameB) {
-            if (*nameA != *nameB) {
-                int new_name = vector_length(acc->env);
+void interval_state_set_bottom(IntervalState* st)
+{
+    state_set(st, interval_bottom(), true);
+}
 
-                Interval a = *(Interval*)vector_get(acc->env, *nameA);
-                Interval b = *(Interval*)vector_get(new->env, *nameB);
-                Interval r = interval_join_single(a, b);
+// states allocated by a slab are released with it
+void interval_state_delete(IntervalState* st)
+{
+    if (!st) {
+        return;
+    }
 
-                vector_push(acc->env, &r);
-                *nameA = new_name;
-                *changed = 1;
-            }
-        } else {
-            Interval a = nameA ? *(Interval*)vector_get(acc->env, *nameA) : interval_bottom();
-            Interval b = nameB ? *(Interval*)vector_get(new->env, *nameB) : interval_bottom();
-            Interval r = interval_join_single(a, b);
+    page_release(st->page);
+    page_release(st->spare);
+    free(st);
+}
 
-            vector_push(acc->env, &r);
-            *changed = 1;
+int interval_state_copy(IntervalState* dst, const IntervalState* src)
+{
+    if (!dst || !src) {
+        return FAILURE;
+    }
+
+    if (dst->max_locals != src->max_locals || dst->max_stack != src->max_stack) {
+        LOG_ERROR("Copy between abstract states of different frames");
+        return FAILURE;
+    }
+
+    int changed = 0;
+
+    // dst takes the page of src, the slots that differ are stamped beforehand
+    if (dst->page != src->page) {
+        int len = slots_in_use(src);
+
+        if (!interval_kernels()->equal(dst->slots, src->slots, len)
+            || !interval_kernels()->equal(dst->elements, src->elements, len)
+            || memcmp(dst->congruence, src->congruence, sizeof(Congruence) * len)) {
+            for (int i = 0; i < len; i++) {
+                if (dst->slots[i].lower != src->slots[i].lower || dst->slots[i].upper != src->slots[i].upper
+                    || dst->elements[i].lower != src->elements[i].lower || dst->elements[i].upper != src->elements[i].upper
+                    || dst->congruence[i] != src->congruence[i]) {
+                    dst->stamp[i] = dst->version + 1;
+                    changed = 1;
+                }
+            }
         }
+
+        changed |= memcmp(dst->origin, src->origin, sizeof(int) * src->stack_len) != 0;
+
+        page_retain(src->page);
+        state_leave(dst);
+        state_attach(dst, src->page);
     }
 
+    changed |= write_frame(dst, src->stack_len, src->bottom);
+    commit_version(dst, changed, NULL);
+
     return SUCCESS;
 }
 
-int interval_intersection(IntervalState* acc, const IntervalState* constraint, int* changed)
+bool interval_state_leq(const IntervalState* a, const IntervalState* b)
 {
-    if (!acc || !constraint || !changed)
-        return FAILURE;
-    *changed = 0;
+    return interval_state_leq_since(a, b, 0);
+}
 
-    int env_len = vector_length(acc->env);
-    int c_len = vector_length(constraint->env);
-    int max_len = (env_len > c_len ? env_len : c_len);
+// a <= b, looking only at the slots of a changed after version since
+bool interval_state_leq_since(const IntervalState* a, const IntervalState* b, unsigned since)
+{
+    if (is_interval_state_bottom(a)) {
+        return true;
+    }
 
-    while (vector_length(acc->env) < max_len) {
-        Interval top = interval_top();
-        vector_push(acc->env, &top);
+    if (is_interval_state_bottom(b) || a->stack_len > b->stack_len) {
+        return false;
     }
 
-    for (int i = 0; i < max_len; i++) {
-        Interval* a = vector_get(acc->env, i);
+    if (a->page == b->page) {
+        return true;
+    }
 
-        Interval b = interval_top();
-        if (i < c_len)
-            b = *(Interval*)vector_get(constraint->env, i);
+    if (!interval_kernels()->leq(a->slots, b->slots, a->stamp, since, slots_in_use(a))
+        || !interval_kernels()->leq(a->elements, b->elements, a->stamp, since, slots_in_use(a))) {
+        return false;
+    }
 
-        Interval r = interval_intersect_single(*a, b);
-        if (r.lower != a->lower || r.upper != a->upper) {
-            *a = r;
-            *changed = 1;
+    for (int i = 0; i < slots_in_use(a); i++) {
+        if (b->congruence[i] != CONGRUENCE_TOP && (since == 0 || a->stamp[i] > since)
+            && !congruence_leq(a->slots[i], a->congruence[i], b->slots[i], b->congruence[i])) {
+            return false;
         }
     }
 
-    for (size_t i = 0; i < vector_length(acc->locals); i++) {
-        int* nameA = vector_get(acc->locals, i);
-        int nameB = *(int*)vector_get(constraint->locals, i);
+    return true;
+}
+
+/*** LATTICE ***/
 
-        if (*nameA != nameB) {
-            int new_name = vector_length(acc->env);
+// before the intervals are joined, the single values still give a modulus
+static int join_congruences(IntervalState* acc, const IntervalState* new, int len)
+{
+    int changed = 0;
 
-            Interval a = *(Interval*)vector_get(acc->env, *nameA);
-            Interval b = *(Interval*)vector_get(constraint->env, nameB);
-            Interval r = interval_intersect_single(a, b);
+    for (int i = 0; i < len; i++) {
+        Congruence c = congruence_join(acc->slots[i], acc->congruence[i], new->slots[i], new->congruence[i]);
+        changed |= write_congruence(acc, i, c);
+    }
+
+    return changed;
+}
 
-            vector_push(acc->env, &r);
-            *nameA = new_name;
+// reduction of the first len slots, the state is unreachable if one is left empty
+static void reduce_slots(IntervalState* st, int len, int* changed)
+{
+    for (int i = 0; i < len; i++) {
+        if (!reduce_slot(st, i, changed)) {
+            interval_state_set_bottom(st);
             *changed = 1;
+            return;
         }
     }
+}
 
-    for (size_t i = 0; i < vector_length(acc->stack); i++) {
-        int* nameA = vector_get(acc->stack, i);
-        int nameB = *(int*)vector_get(constraint->stack, i);
+int interval_join(IntervalState* acc, const IntervalState* new, int* changed)
+{
+    if (!acc || !new || !changed) {
+        return FAILURE;
+    }
 
-        if (*nameA != nameB) {
-            int new_name = vector_length(acc->env);
+    if (is_interval_state_bottom(new)) {
+        return SUCCESS;
+    }
 
-            Interval a = *(Interval*)vector_get(acc->env, *nameA);
-            Interval b = *(Interval*)vector_get(constraint->env, nameB);
-            Interval r = interval_intersect_single(a, b);
+    if (is_interval_state_bottom(acc)) {
+        *changed = 1;
+        return interval_state_copy(acc, new);
+    }
 
-            vector_push(acc->env, &r);
-            *nameA = new_name;
-            *changed = 1;
+    if (acc->page == new->page && acc->stack_len >= new->stack_len) {
+        return SUCCESS;
+    }
+
+    if (interval_state_own(acc)) {
+        return FAILURE;
+    }
+
+    int len = MIN(slots_in_use(acc), slots_in_use(new));
+    int any = join_congruences(acc, new, len);
+    any |= interval_kernels()->join(acc->slots, new->slots, acc->stamp, acc->version + 1, len);
+    any |= interval_kernels()->join(acc->elements, new->elements, acc->stamp, acc->version + 1, len);
+
+    int stack_len = MIN(acc->stack_len, new->stack_len);
+    for (int i = 0; i < stack_len; i++) {
+        if (acc->origin[i] != new->origin[i]) {
+            any |= write_origin(acc, i, -1);
         }
     }
 
+    // stacks of verified code agree on their height, keep the longest anyway
+    for (int i = acc->stack_len; i < new->stack_len; i++) {
+        int slot = acc->max_locals + i;
+
+        acc->slots[slot] = new->slots[slot];
+        acc->elements[slot] = new->elements[slot];
+        acc->congruence[slot] = new->congruence[slot];
+        acc->stamp[slot] = acc->version + 1;
+        acc->origin[i] = -1;
+    }
+
+    any |= write_frame(acc, MAX(acc->stack_len, new->stack_len), false);
+    reduce_slots(acc, len, &any);
+    commit_version(acc, any, changed);
+
+    return SUCCESS;
+}
+
+int interval_intersection(IntervalState* acc, const IntervalState* constraint, int* changed)
+{
+    if (!acc || !constraint || !changed)
+        return FAILURE;
+    *changed = 0;
+
+    if (interval_state_own(acc)) {
+        return FAILURE;
+    }
+
+    int len = MIN(slots_in_use(acc), slots_in_use(constraint));
+    int any = 0;
+
+    for (int i = 0; i < len && any != -1; i++) {
+        Congruence c;
+        if (!congruence_meet(acc->slots[i], acc->congruence[i], constraint->slots[i], constraint->congruence[i], &c)) {
+            any = -1;
+        } else if (acc->slots[i].lower != acc->slots[i].upper) {
+            any |= write_congruence(acc, i, c);
+        }
+    }
+
+    // elements are left alone, the ranges given for an empty array may be disjoint
+    if (any != -1) {
+        int met = interval_kernels()->meet(acc->slots, constraint->slots, acc->stamp, acc->version + 1, len);
+        any = met == -1 ? -1 : any | met;
+    }
+
+    // an empty slot makes the whole state unreachable
+    if (any == -1) {
+        interval_state_set_bottom(acc);
+        *changed = 1;
+        return SUCCESS;
+    }
+
+    reduce_slots(acc, len, &any);
+    commit_version(acc, any, changed);
+
     return SUCCESS;
 }
 
 int interval_widening(IntervalState* acc, const IntervalState* new, int* changed)
+{
+    return interval_widening_thresholds(acc, new, NULL, 0, changed);
+}
+
+int interval_widening_thresholds(IntervalState* acc, const IntervalState* new, const int* thresholds, int thresholds_count, int* changed)
 {
     if (!acc || !new || !changed)
         return FAILURE;
     *changed = 0;
 
-    if (vector_length(new->locals) != vector_length(acc->locals)) {
+    if (is_interval_state_bottom(new)) {
+        return SUCCESS;
+    }
+
+    if (is_interval_state_bottom(acc)) {
+        *changed = 1;
+        return interval_state_copy(acc, new);
+    }
+
+    if (acc->stack_len != new->stack_len) {
         LOG_ERROR("solve in interval widening");
     }
 
-    for (size_t i = 0; i < vector_length(new->locals); i++) {
-        int in_iv_id = *(int*)vector_get(acc->locals, i);
-        int new_iv_id = *(int*)vector_get(new->locals, i);
+    if (interval_state_own(acc)) {
+        return FAILURE;
+    }
 
-        Interval* in_iv = vector_get(acc->env, in_iv_id);
-        Interval* new_iv = vector_get(new->env, new_iv_id);
+    // congruences have no infinite ascending chain, they are joined
+    int len = MIN(slots_in_use(acc), slots_in_use(new));
+    int any = join_congruences(acc, new, len);
+    any |= interval_kernels()->widen(acc->slots, new->slots, acc->stamp, acc->version + 1, len,
+        thresholds, thresholds_count);
+    any |= interval_kernels()->widen(acc->elements, new->elements, acc->stamp, acc->version + 1, len,
+        thresholds, thresholds_count);
 
-        Interval r = interval_widen_single(*in_iv, *new_iv);
+    reduce_slots(acc, len, &any);
+    commit_version(acc, any, changed);
 
-        if (r.lower != new_iv->lower || r.upper != new_iv->upper) {
-            int* a = vector_get(acc->locals, i);
-            *a = vector_length(acc->env);
-            vector_push(acc->env, &r);
+    return SUCCESS;
+}
 
-            *changed = 1;
-        }
+/*
+ * Refines acc with new. Both are expected to be sound for the same program
+ * point, so their meet is sound as well; it is the caller that bounds the
+ * number of descending steps.
+ */
+int interval_narrowing(IntervalState* acc, const IntervalState* new, int* changed)
+{
+    if (!acc || !new || !changed)
+        return FAILURE;
+    *changed = 0;
+
+    if (is_interval_state_bottom(acc) || is_interval_state_bottom(new)) {
+        return SUCCESS;
+    }
+
+    if (interval_state_own(acc)) {
+        return FAILURE;
+    }
+
+    int len = MIN(slots_in_use(acc), slots_in_use(new));
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        any |= write_slot(acc, i, interval_narrow_single(acc->slots[i], new->slots[i]));
+        any |= write_elements(acc, i, interval_narrow_single(acc->elements[i], new->elements[i]));
     }
 
+    reduce_slots(acc, len, &any);
+    commit_version(acc, any, changed);
+
     return SUCCESS;
 }
 
 // Abstract arithmetic (stack operands)
-Interval interval_add(Interval* a, Interval* b)
+
+/*
+ * Exact bounds of a result, computed in 64 bits, mapped back to int the way
+ * java wraps around: bounds that wrap by the same multiple of 2^32 keep the
+ * range, any other result may be every int.
+ */
+static Interval wrap_bounds(long lower, long upper)
 {
-    Interval r;
-    r.lower = a->lower + b->lower;
-    r.upper = a->upper + b->upper;
+    if (lower > upper) {
+        return interval_bottom();
+    }
+
+    Interval r = { (int)(unsigned)lower, (int)(unsigned)upper };
+    if (upper - lower > UINT_MAX || r.lower > r.upper) {
+        return interval_top();
+    }
+
     return r;
 }
 
-Interval interval_sub(const Interval* a, const Interval* b)
+static Interval wrap_hull(long a, long b, long c, long d)
 {
-    Interval r;
+    return wrap_bounds(MIN(MIN(a, b), MIN(c, d)), MAX(MAX(a, b), MAX(c, d)));
+}
 
-    long tmp_lower = (long)a->lower - (long)b->upper;
-    long tmp_upper = (long)a->upper - (long)b->lower;
+Interval interval_add(Interval* a, Interval* b)
+{
+    return wrap_bounds((long)a->lower + b->lower, (long)a->upper + b->upper);
+}
 
-    if (tmp_lower < INT_MIN)
-        tmp_lower = INT_MIN;
-    if (tmp_lower > INT_MAX)
-        tmp_lower = INT_MAX;
+Interval interval_sub(const Interval* a, const Interval* b)
+{
+    return wrap_bounds((long)a->lower - b->upper, (long)a->upper - b->lower);
+}
 
-    if (tmp_upper < INT_MIN)
-        tmp_upper = INT_MIN;
-    if (tmp_upper > INT_MAX)
-        tmp_upper = INT_MAX;
+Interval interval_mul(Interval* a, Interval* b)
+{
+    return wrap_hull((long)a->lower * b->lower, (long)a->lower * b->upper,
+        (long)a->upper * b->lower, (long)a->upper * b->upper);
+}
 
-    r.lower = (int)tmp_lower;
-    r.upper = (int)tmp_upper;
+// -INT_MIN wraps around to itself
+Interval interval_negate(Interval a)
+{
+    return wrap_bounds(-(long)a.upper, -(long)a.lower);
+}
 
-    return r;
+// a divisor of a single sign gives its extremes at the corners, INT_MIN / -1 wraps
+static Interval div_hull(const Interval* a, long lower, long upper)
+{
+    return wrap_hull(a->lower / lower, a->lower / upper, a->upper / lower, a->upper / upper);
 }
 
-Interval interval_mul(Interval* a, Interval* b)
+/*
+ * A zero divisor throws, so only the negative and the positive divisors give
+ * a result. Dividing by zero alone is left at top, the verdicts report it.
+ */
+Interval interval_div(Interval* a, Interval* b)
 {
-    int cand[4] = {
-        a->lower * b->lower,
-        a->lower * b->upper,
-        a->upper * b->lower,
-        a->upper * b->upper
-    };
+    if (b->lower == 0 && b->upper == 0) {
+        return interval_top();
+    }
 
-    Interval r;
-    r.lower = cand[0];
-    r.upper = cand[0];
-    for (int i = 1; i < 4; i++) {
-        if (cand[i] < r.lower) {
-            r.lower = cand[i];
-        }
-        if (cand[i] > r.upper) {
-            r.upper = cand[i];
-        }
+    Interval r = interval_bottom();
+
+    if (b->lower < 0) {
+        r = div_hull(a, b->lower, MIN(b->upper, -1));
     }
+
+    if (b->upper > 0) {
+        r = interval_join_single(r, div_hull(a, MAX(b->lower, 1), b->upper));
+    }
+
     return r;
 }
 
-Interval interval_div(Interval* a, Interval* b)
+/*
+ * Java remainder: the sign of the dividend, smaller than the divisor in
+ * magnitude and never larger than the dividend. A divisor of zero throws, so
+ * only the other ones bound the result.
+ */
+Interval interval_rem(const Interval* a, const Interval* b)
 {
-    if (b->lower <= 0 && b->upper >= 0) {
+    long divisor = MAX(labs((long)b->lower), labs((long)b->upper)) - 1;
+    if (divisor < 0) {
         return interval_top();
     }
 
-    int cand[4] = {
-        a->lower / b->lower,
-        a->lower / b->upper,
-        a->upper / b->lower,
-        a->upper / b->upper
-    };
-
-    Interval r;
-    r.lower = cand[0];
-    r.upper = cand[0];
-    for (int i = 1; i < 4; i++) {
-        if (cand[i] < r.lower) {
-            r.lower = cand[i];
-        }
-        if (cand[i] > r.upper) {
-            r.upper = cand[i];
-        }
-    }
-    return r;
+    long lower = a->lower >= 0 ? 0 : MAX((long)a->lower, -divisor);
+    long upper = a->upper <= 0 ? 0 : MIN((long)a->upper, divisor);
+
+    return (Interval) { (int)lower, (int)upper };
+}
+
+int interval_binary(BinaryOperator op, Interval a, Interval b, Interval* result)
+{
+    switch (op) {
+    case BO_MUL:
+        *result = interval_mul(&a, &b);
+        break;
+    case BO_ADD:
+        *result = interval_add(&a, &b);
+        break;
+    case BO_DIV:
+        *result = interval_div(&a, &b);
+        break;
+    case BO_SUB:
+        *result = interval_sub(&a, &b);
+        break;
+    case BO_REM:
+        *result = interval_rem(&a, &b);
+        break;
+    default:
+        return FAILURE;
+    }
+
+    return SUCCESS;
 }
 
 static int handle_push(IntervalState* out_state, IrInstruction* ir_instruction)
@@ -438,18 +946,81 @@ static int handle_push(IntervalState* out_state, IrInstruction* ir_instruction)
         value = push->value.data.bool_value;
     } else if (push->value.type == TYPE_CHAR) {
         value = push->value.data.char_value;
+    } else if (push->value.type == TYPE_REFERENCE) {
+        value = ARRAY_NULL;
     } else {
         return FAILURE;
     }
 
-    int new_name = vector_length(out_state->env);
     Interval interval = (Interval) { .lower = value, .upper = value };
-    vector_push(out_state->env, &interval);
 
-    if (vector_push(out_state->stack, &new_name)) {
+    return stack_push(out_state, interval, CONGRUENCE_TOP, -1);
+}
+
+// values a slot of the given type can hold, NULL standing for int
+Interval interval_type_range(const Type* type)
+{
+    if (!type) {
+        return interval_top();
+    }
+
+    switch (type->kind) {
+    case TK_BOOLEAN:
+        return (Interval) { 0, 1 };
+    case TK_CHAR:
+        return (Interval) { 0, 65535 };
+    case TK_REFERENCE:
+    case TK_ARRAY:
+        return (Interval) { ARRAY_NULL, INT_MAX };
+    default:
+        return interval_top();
+    }
+}
+
+/*
+ * A value outside the range of its type was truncated into it, a char keeps
+ * its low 16 bits, and its congruence is lost with it.
+ */
+static void type_clamp(Interval* iv, Congruence* c, const Type* type)
+{
+    Interval range = interval_type_range(type);
+    if (iv->lower < range.lower || iv->upper > range.upper) {
+        *iv = range;
+        *c = CONGRUENCE_TOP;
+    }
+}
+
+/*
+ * Sets the locals holding the arguments to the range of their declared types,
+ * and the elements of an array argument to the range of its element type.
+ */
+int interval_state_set_arguments(IntervalState* st, const Vector* types)
+{
+    if (!st || !types || interval_state_own(st)) {
         return FAILURE;
     }
 
+    if (st->bottom) {
+        return SUCCESS;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < (int)vector_length(types) && i < st->max_locals; i++) {
+        Type* type = *(Type**)vector_get(types, i);
+        Interval range = interval_type_range(type);
+        Interval elements = type && type->kind == TK_ARRAY ? interval_type_range(type->array.element_type) : interval_top();
+
+        if (range.lower != st->slots[i].lower || range.upper != st->slots[i].upper
+            || elements.lower != st->elements[i].lower || elements.upper != st->elements[i].upper) {
+            st->slots[i] = range;
+            st->elements[i] = elements;
+            st->congruence[i] = CONGRUENCE_TOP;
+            st->stamp[i] = st->version + 1;
+            changed = 1;
+        }
+    }
+
+    commit_version(st, changed, NULL);
     return SUCCESS;
 }
 
@@ -464,16 +1035,20 @@ static int handle_load(IntervalState* out_state, IrInstruction* ir_instruction)
         return FAILURE;
     }
 
-    int* name = vector_get(out_state->locals, load->index);
-    if (!name) {
-        LOG_ERROR("Name is not defined, locals len: %ld", vector_length(out_state->locals));
+    if (load->index < 0 || load->index >= out_state->max_locals) {
+        LOG_ERROR("Local is not defined, max locals: %d", out_state->max_locals);
         return FAILURE;
     }
 
-    if (vector_push(out_state->stack, name)) {
+    Interval iv = out_state->slots[load->index];
+    Congruence c = out_state->congruence[load->index];
+    type_clamp(&iv, &c, load->type);
+
+    if (stack_push(out_state, iv, c, load->index)) {
         return FAILURE;
     }
 
+    out_state->elements[out_state->max_locals + out_state->stack_len - 1] = out_state->elements[load->index];
     return SUCCESS;
 }
 
@@ -486,22 +1061,23 @@ static int handle_store(IntervalState* out_state, IrInstruction* ir_instruction)
     if (!store)
         return FAILURE;
 
-    int name_old;
-    vector_pop(out_state->stack, &name_old);
-
-    int new_name = vector_length(out_state->env);
-    Interval iv = *(Interval*)vector_get(out_state->env, name_old);
-    vector_push(out_state->env, &iv);
+    Interval iv;
+    Congruence c;
+    if (stack_pop(out_state, &iv, &c, NULL)) {
+        return FAILURE;
+    }
 
-    if (store->index == vector_length(out_state->locals)) {
-        vector_push(out_state->locals, &new_name);
-    } else if (store->index < vector_length(out_state->locals)) {
-        int* local_name = vector_get(out_state->locals, store->index);
-        *local_name = new_name;
-    } else {
+    if (store->index < 0 || store->index >= out_state->max_locals) {
         return FAILURE;
     }
 
+    type_clamp(&iv, &c, store->type);
+
+    out_state->slots[store->index] = iv;
+    out_state->elements[store->index] = popped_elements(out_state);
+    out_state->congruence[store->index] = c;
+    forget_origin(out_state, store->index);
+
     return SUCCESS;
 }
 
@@ -511,16 +1087,20 @@ static int handle_dup(IntervalState* out_state, IrInstruction* ir_instruction)
         return FAILURE;
     }
 
-    int name;
-    if (vector_pop(out_state->stack, &name)) {
+    Interval iv;
+    Congruence c;
+    int origin;
+    if (stack_pop(out_state, &iv, &c, &origin)) {
         return FAILURE;
     }
 
-    if (vector_push(out_state->stack, &name)) {
-        return FAILURE;
-    }
-    if (vector_push(out_state->stack, &name)) {
-        return FAILURE;
+    Interval elements = popped_elements(out_state);
+
+    for (int i = 0; i < 2; i++) {
+        if (stack_push(out_state, iv, c, origin)) {
+            return FAILURE;
+        }
+        out_state->elements[out_state->max_locals + out_state->stack_len - 1] = elements;
     }
 
     return SUCCESS;
@@ -532,15 +1112,9 @@ static int handle_get(IntervalState* out_state, IrInstruction* ir_instruction)
         return FAILURE;
     }
 
-    int name = vector_length(out_state->env);
     Interval interval = { .lower = 0, .upper = 1 };
-    vector_push(out_state->env, &interval);
-
-    if (vector_push(out_state->stack, &name)) {
-        return FAILURE;
-    }
 
-    return SUCCESS;
+    return stack_push(out_state, interval, CONGRUENCE_TOP, -1);
 }
 
 static int handle_binary(IntervalState* out_state, IrInstruction* ir_instruction)
@@ -554,56 +1128,28 @@ static int handle_binary(IntervalState* out_state, IrInstruction* ir_instruction
         return FAILURE;
     }
 
-    int name1, name2;
-    vector_pop(out_state->stack, &name2);
-    vector_pop(out_state->stack, &name1);
-
-    Interval* interval1 = vector_get(out_state->env, name1);
-    Interval* interval2 = vector_get(out_state->env, name2);
+    Interval interval1, interval2;
+    Congruence congruence1, congruence2;
+    if (stack_pop(out_state, &interval2, &congruence2, NULL) || stack_pop(out_state, &interval1, &congruence1, NULL)) {
+        return FAILURE;
+    }
 
     Interval result;
-    switch (binary->op) {
-    case BO_MUL:
-        result = interval_mul(interval1, interval2);
-        break;
-
-    case BO_ADD:
-        result = interval_add(interval1, interval2);
-        break;
-
-    case BO_DIV:
-        result = interval_div(interval1, interval2);
-        break;
-
-    case BO_SUB:
-        result = interval_sub(interval1, interval2);
-        break;
-
-    // case BO_REM:
-    //     break;
-    default:
+    if (interval_binary(binary->op, interval1, interval2, &result)) {
         LOG_ERROR("While abstract binary op");
         return FAILURE;
     }
 
-    int new_name = vector_length(out_state->env);
-
-    vector_push(out_state->env, &result);
-    vector_push(out_state->stack, &new_name);
+    Congruence c = congruence_binary(binary->op, interval1, congruence1, interval2, congruence2);
 
-    return SUCCESS;
+    return stack_push(out_state, congruence_reduce(result, c), c, -1);
 }
 
 static int handle_new(IntervalState* st, IrInstruction* ins)
 {
-    int name = vector_length(st->env);
-    Interval top = interval_top();
-    vector_push(st->env, &top);
-    vector_push(st->stack, &name);
-    return SUCCESS;
+    return stack_push(st, interval_top(), CONGRUENCE_TOP, -1);
 }
 
-int ciao = 0;
 static int handle_incr(IntervalState* st, IrInstruction* ins)
 {
     if (!st || !ins) {
@@ -611,38 +1157,166 @@ static int handle_incr(IntervalState* st, IrInstruction* ins)
     }
 
     IncrOP* incr = &ins->data.incr;
-    int* iv_id = vector_get(st->locals, incr->index);
+    if (incr->index < 0 || incr->index >= st->max_locals) {
+        return FAILURE;
+    }
 
-    Interval iv = *(Interval*)vector_get(st->env, *iv_id);
+    Interval* iv = &st->slots[incr->index];
+    Congruence* c = &st->congruence[incr->index];
 
-    if (iv.lower < INT_MAX) {
-        iv.lower++;
-    }
+    if (!is_interval_bottom(*iv)) {
+        long lower = (long)iv->lower + incr->amount;
+        long upper = (long)iv->upper + incr->amount;
+        Interval amount = { incr->amount, incr->amount };
 
-    if (iv.upper < INT_MAX)
-        iv.upper++;
+        *c = congruence_binary(BO_ADD, *iv, *c, amount, CONGRUENCE_TOP);
 
-    *iv_id = vector_length(st->env);
+        *iv = congruence_reduce(wrap_bounds(lower, upper), *c);
+    }
 
-    vector_push(st->env, &iv);
+    forget_origin(st, incr->index);
 
     return SUCCESS;
 }
 
 static int handle_negate(IntervalState* st, IrInstruction* ins)
 {
-    int new_name = vector_length(st->env);
-    int iv_id;
-    vector_pop(st->stack, &iv_id);
+    Interval iv;
+    Congruence c;
+    if (stack_pop(st, &iv, &c, NULL)) {
+        return FAILURE;
+    }
+
+    c = congruence_negate(iv, c);
+
+    iv = interval_negate(iv);
+
+    return stack_push(st, iv, c, -1);
+}
+
+/*** ARRAYS ***/
+
+static Interval interval_meet(Interval a, Interval b)
+{
+    Interval r = interval_intersect_single(a, b);
+    return r.lower > r.upper ? interval_bottom() : r;
+}
+
+
+static void refine_local(IntervalState* st, int origin, Interval iv)
+{
+    if (origin >= 0) {
+        st->slots[origin] = iv;
+    }
+}
+
+/*
+ * The access goes on only with a non null array and an index within its
+ * length, which both operands keep afterwards. Returns false, with the state
+ * made unreachable, when no access can go on.
+ */
+static bool array_access(IntervalState* st, Interval array, int array_origin, Interval index, Congruence c, int index_origin)
+{
+    Interval length = interval_meet(array, (Interval) { 0, INT_MAX });
+    Interval inside = is_interval_bottom(length) || length.upper == 0
+        ? interval_bottom()
+        : congruence_reduce(interval_meet(index, (Interval) { 0, length.upper - 1 }), c);
+
+    if (is_interval_bottom(inside)) {
+        interval_state_set_bottom(st);
+        return false;
+    }
+
+    refine_local(st, array_origin, length);
+    refine_local(st, index_origin, inside);
+
+    return true;
+}
+
+static int handle_new_array(IntervalState* st, IrInstruction* ins)
+{
+    NewArrayOP* new_array = &ins->data.new_array;
+    Interval length = interval_top();
+
+    // the outermost dimension is the deepest on the stack
+    for (int i = 0; i < new_array->dim; i++) {
+        if (stack_pop(st, &length, NULL, NULL)) {
+            return FAILURE;
+        }
+    }
+
+    // a negative length throws
+    length = interval_meet(length, (Interval) { 0, INT_MAX });
+    if (is_interval_bottom(length)) {
+        interval_state_set_bottom(st);
+        return SUCCESS;
+    }
+
+    Interval elements = new_array->dim == 1 ? (Interval) { 0, 0 } : interval_top();
+    return stack_push_array(st, length, elements, -1);
+}
+
+static int handle_array_length(IntervalState* st)
+{
+    Interval array;
+    int origin;
+    if (stack_pop(st, &array, NULL, &origin)) {
+        return FAILURE;
+    }
+
+    Interval length = interval_meet(array, (Interval) { 0, INT_MAX });
+    if (is_interval_bottom(length)) {
+        interval_state_set_bottom(st);
+        return SUCCESS;
+    }
+
+    refine_local(st, origin, length);
+    return stack_push(st, length, CONGRUENCE_TOP, -1);
+}
+
+static int handle_array_load(IntervalState* st, IrInstruction* ins)
+{
+    Interval index, array;
+    Congruence c;
+    int index_origin, array_origin;
+    if (stack_pop(st, &index, &c, &index_origin) || stack_pop(st, &array, NULL, &array_origin)) {
+        return FAILURE;
+    }
+
+    Interval elements = popped_elements(st);
+    if (!array_access(st, array, array_origin, index, c, index_origin)) {
+        return SUCCESS;
+    }
+
+    Interval value = interval_meet(elements, interval_type_range(ins->data.array_load.type));
+    return stack_push(st, is_interval_bottom(value) ? interval_type_range(ins->data.array_load.type) : value, CONGRUENCE_TOP, -1);
+}
+
+// the stored value may end up in any array, every slot gets it
+static int handle_array_store(IntervalState* st, IrInstruction* ins)
+{
+    Interval value, index, array;
+    Congruence c;
+    int index_origin, array_origin;
+    if (stack_pop(st, &value, NULL, NULL) || stack_pop(st, &index, &c, &index_origin)
+        || stack_pop(st, &array, NULL, &array_origin)) {
+        return FAILURE;
+    }
+
+    if (!array_access(st, array, array_origin, index, c, index_origin)) {
+        return SUCCESS;
+    }
 
-    Interval iv = *(Interval*)vector_get(st->env, iv_id);
+    // a char store keeps the low 16 bits
+    Interval range = interval_type_range(ins->data.array_store.type);
+    if (value.lower < range.lower || value.upper > range.upper) {
+        value = range;
+    }
 
-    int tmp = iv.lower;
-    iv.lower = -iv.upper;
-    iv.upper = -tmp;
+    for (int i = 0; i < slots_in_use(st); i++) {
+        st->elements[i] = interval_join_single(st->elements[i], value);
+    }
 
-    vector_push(st->env, &iv);
-    vector_push(st->stack, &new_name);
     return SUCCESS;
 }
 
@@ -652,6 +1326,15 @@ int interval_transfer(IntervalState* out_state, IrInstruction* ir_instruction)
         return FAILURE;
     }
 
+    if (interval_state_own(out_state)) {
+        return FAILURE;
+    }
+
+    // an earlier instruction of the block always throws
+    if (is_interval_state_bottom(out_state)) {
+        return SUCCESS;
+    }
+
     int result = SUCCESS;
 
     switch (ir_instruction->opcode) {
@@ -682,11 +1365,17 @@ int interval_transfer(IntervalState* out_state, IrInstruction* ir_instruction)
     case OP_INCR:
         result = handle_incr(out_state, ir_instruction);
         break;
-    case OP_ARRAY_STORE:
     case OP_NEW_ARRAY:
-    case OP_ARRAY_LOAD:
+        result = handle_new_array(out_state, ir_instruction);
+        break;
     case OP_ARRAY_LENGTH:
-        result = FAILURE;
+        result = handle_array_length(out_state);
+        break;
+    case OP_ARRAY_LOAD:
+        result = handle_array_load(out_state, ir_instruction);
+        break;
+    case OP_ARRAY_STORE:
+        result = handle_array_store(out_state, ir_instruction);
         break;
     default:
         break;
@@ -699,7 +1388,26 @@ int interval_transfer(IntervalState* out_state, IrInstruction* ir_instruction)
     return SUCCESS;
 }
 
-static int handle_if_aux(IfCondition condition,
+
+// x without the single value of y when it is a bound of x, the reduction the congruences need
+static Interval interval_exclude(Interval x, Interval y)
+{
+    if (y.lower != y.upper || is_interval_bottom(x)) {
+        return x;
+    }
+
+    if (x.lower == y.lower && x.upper == y.lower) {
+        return interval_bottom();
+    } else if (x.lower == y.lower) {
+        return (Interval) { x.lower + 1, x.upper };
+    } else if (x.upper == y.lower) {
+        return (Interval) { x.lower, x.upper - 1 };
+    }
+
+    return x;
+}
+
+int interval_branch(IfCondition condition,
     Interval* x,
     Interval* y,
     Interval* true_branch,
@@ -734,7 +1442,7 @@ static int handle_if_aux(IfCondition condition,
         MAKE_INTERVAL(true_branch, L, U);
 
         if (L <= U) {
-            *false_branch = *x; // approx: x minus intersection → TOP
+            *false_branch = interval_exclude(*x, *y);
         } else {
             *true_branch = bottom;
             *false_branch = *x;
@@ -752,7 +1460,7 @@ static int handle_if_aux(IfCondition condition,
         MAKE_INTERVAL(false_branch, L, U);
 
         if (L <= U) {
-            *true_branch = *x; // approx complement
+            *true_branch = interval_exclude(*x, *y);
         } else {
             // always true
             *true_branch = *x;
@@ -775,11 +1483,9 @@ static int handle_if_aux(IfCondition condition,
             *false_branch = *x;
             return SUCCESS;
         }
-        if (yL > INT_MIN)
-            yL--;
-
-        MAKE_INTERVAL(true_branch, xL, yL);
-        MAKE_INTERVAL(false_branch, yU, xU);
+        // yU > xL here, yU - 1 cannot overflow
+        MAKE_INTERVAL(true_branch, xL, MIN(xU, yU - 1));
+        MAKE_INTERVAL(false_branch, MAX(xL, yL), xU);
         return SUCCESS;
     }
 
@@ -798,8 +1504,9 @@ static int handle_if_aux(IfCondition condition,
             return SUCCESS;
         }
 
-        MAKE_INTERVAL(true_branch, xL, yU);
-        MAKE_INTERVAL(false_branch, yU + 1, xU);
+        // yL < xU here, yL + 1 cannot overflow
+        MAKE_INTERVAL(true_branch, xL, MIN(xU, yU));
+        MAKE_INTERVAL(false_branch, MAX(xL, yL + 1), xU);
         return SUCCESS;
     }
 
@@ -818,8 +1525,9 @@ static int handle_if_aux(IfCondition condition,
             return SUCCESS;
         }
 
+        // yL < xU here, yL + 1 cannot overflow
         MAKE_INTERVAL(true_branch,
-            (xL > (yU + 1) ? xL : (yU + 1)),
+            (xL > (yL + 1) ? xL : (yL + 1)),
             xU);
 
         MAKE_INTERVAL(false_branch,
@@ -847,9 +1555,10 @@ static int handle_if_aux(IfCondition condition,
             (xL > yL ? xL : yL),
             xU);
 
+        // yU > xL here, yU - 1 cannot overflow
         MAKE_INTERVAL(false_branch,
             xL,
-            yL - 1);
+            (xU < (yU - 1) ? xU : (yU - 1)));
         return SUCCESS;
     }
 
@@ -858,6 +1567,22 @@ static int handle_if_aux(IfCondition condition,
     }
 }
 
+/*
+ * A branch that cannot be taken makes its whole state unreachable. The
+ * congruence c of the operand reduces the branch first, so x != 11 is never
+ * false for an even x.
+ */
+static void refine_branch(IntervalState* st, int origin, Interval branch, Congruence c)
+{
+    branch = congruence_reduce(branch, c);
+
+    if (is_interval_bottom(branch)) {
+        interval_state_set_bottom(st);
+    } else if (origin >= 0) {
+        st->slots[origin] = branch;
+    }
+}
+
 static int handle_if_zero(IntervalState* out_state_true, IntervalState* out_state_false, IrInstruction* ir_instruction)
 {
     if (!out_state_true || !out_state_false || !ir_instruction) {
@@ -869,21 +1594,20 @@ static int handle_if_zero(IntervalState* out_state_true, IntervalState* out_stat
         return FAILURE;
     }
 
-    int name, dummy;
-    vector_pop(out_state_true->stack, &name);
-    vector_pop(out_state_false->stack, &dummy);
+    Interval interval1;
+    Congruence congruence1;
+    int origin;
+    if (stack_pop(out_state_true, &interval1, &congruence1, &origin) || stack_pop(out_state_false, NULL, NULL, NULL)) {
+        return FAILURE;
+    }
 
-    Interval* interval1 = vector_get(out_state_true->env, name);
     Interval interval2 = { .lower = 0, .upper = 0 };
 
     Interval true_branch, false_branch;
-    handle_if_aux(ift->condition, interval1, &interval2, &true_branch, &false_branch);
+    interval_branch(ift->condition, &interval1, &interval2, &true_branch, &false_branch);
 
-    Interval* true_interval = vector_get(out_state_true->env, name);
-    *true_interval = true_branch;
-
-    Interval* false_interval = vector_get(out_state_false->env, name);
-    *false_interval = false_branch;
+    refine_branch(out_state_true, origin, true_branch, congruence1);
+    refine_branch(out_state_false, origin, false_branch, congruence1);
 
     return SUCCESS;
 }
@@ -899,24 +1623,22 @@ static int handle_if(IntervalState* out_state_true, IntervalState* out_state_fal
         return FAILURE;
     }
 
-    int name1, name2, dummy;
-    vector_pop(out_state_true->stack, &name2);
-    vector_pop(out_state_true->stack, &name1);
-
-    vector_pop(out_state_false->stack, &dummy);
-    vector_pop(out_state_false->stack, &dummy);
+    Interval interval1, interval2;
+    Congruence congruence1;
+    int origin;
+    if (stack_pop(out_state_true, &interval2, NULL, NULL) || stack_pop(out_state_true, &interval1, &congruence1, &origin)) {
+        return FAILURE;
+    }
 
-    Interval* interval1 = vector_get(out_state_true->env, name1);
-    Interval* interval2 = vector_get(out_state_true->env, name2);
+    if (stack_pop(out_state_false, NULL, NULL, NULL) || stack_pop(out_state_false, NULL, NULL, NULL)) {
+        return FAILURE;
+    }
 
     Interval true_branch, false_branch;
-    handle_if_aux(ift->condition, interval1, interval2, &true_branch, &false_branch);
+    interval_branch(ift->condition, &interval1, &interval2, &true_branch, &false_branch);
 
-    Interval* true_interval = vector_get(out_state_true->env, name1);
-    *true_interval = true_branch;
-
-    Interval* false_interval = vector_get(out_state_false->env, name1);
-    *false_interval = false_branch;
+    refine_branch(out_state_true, origin, true_branch, congruence1);
+    refine_branch(out_state_false, origin, false_branch, congruence1);
 
     return SUCCESS;
 }
@@ -927,6 +1649,16 @@ int interval_transfer_conditional(IntervalState* out_state_true, IntervalState*
         return FAILURE;
     }
 
+    if (interval_state_own(out_state_true) || interval_state_own(out_state_false)) {
+        return FAILURE;
+    }
+
+    if (is_interval_state_bottom(out_state_true) || is_interval_state_bottom(out_state_false)) {
+        interval_state_set_bottom(out_state_true);
+        interval_state_set_bottom(out_state_false);
+        return SUCCESS;
+    }
+
     int result = SUCCESS;
 
     switch (ir_instruction->opcode) {
@@ -941,17 +1673,6 @@ int interval_transfer_conditional(IntervalState* out_state_true, IntervalState*
         break;
     }
 
-    /*
-#ifdef DEBUG
-    LOG_DEBUG("---------------------------------------");
-    LOG_DEBUG("TRUE");
-    interval_state_print(out_state_true);
-    LOG_DEBUG("FALSE");
-    interval_state_print(out_state_false);
-    LOG_DEBUG("---------------------------------------");
-#endif
-*/
-
     if (result) {
         LOG_ERROR("%s", opcode_print(ir_instruction->opcode));
     }
@@ -959,44 +1680,63 @@ int interval_transfer_conditional(IntervalState* out_state_true, IntervalState*
     return SUCCESS;
 }
 
+// the callee frame starts with the arguments popped from the caller stack
 int interval_transfer_invoke(IntervalState* out_state, IntervalState* in_state, int locals_num)
 {
     if (!out_state || !in_state) {
         return FAILURE;
     }
 
-    LOG_INFO("IN STATE ENV LEN: %ld, OUT STATE LEN %ld", vector_length(in_state->env), vector_length(out_state->env));
-    LOG_INFO("LOCALS NUM: %d", locals_num);
-    for (int i = locals_num - 1; i >= 0; i--) {
-        interval_state_print(in_state);
-        int id;
-        vector_pop(in_state->stack, &id);
+    if (is_interval_state_bottom(in_state)) {
+        interval_state_set_bottom(out_state);
+        return SUCCESS;
+    }
 
-        LOG_INFO("1");
-        Interval* iv = vector_get(in_state->env, id);
-        LOG_INFO("2");
+    if (locals_num > out_state->max_locals || locals_num > in_state->stack_len) {
+        LOG_ERROR("Invoke with %d arguments, stack len %d", locals_num, in_state->stack_len);
+        return FAILURE;
+    }
 
-        int name = vector_length(out_state->env);
-        LOG_INFO("3");
+    interval_state_set_top(out_state);
+    if (interval_state_own(out_state)) {
+        return FAILURE;
+    }
 
-        if (!iv) {
-            interval_state_print(in_state);
-            LOG_INFO("AH");
-        }
+    for (int i = locals_num - 1; i >= 0; i--) {
+        stack_pop(in_state, &out_state->slots[i], &out_state->congruence[i], NULL);
+        out_state->elements[i] = popped_elements(in_state);
+    }
 
-        Interval new_iv = { .lower = iv->lower, .upper = iv->upper };
-        vector_push(out_state->locals, &name);
-        LOG_INFO("4");
-        vector_push(out_state->env, &new_iv);
-        LOG_INFO("5");
+    return SUCCESS;
+}
+
+// the value returned leaves the frame, the caller continues from the edge
+int interval_transfer_return(IntervalState* out_state)
+{
+    if (!out_state) {
+        return FAILURE;
+    }
+
+    if (out_state->stack_len) {
+        out_state->stack_len--;
     }
 
     return SUCCESS;
 }
 
+static void interval_print(const char* prefix, int i, Interval iv)
+{
+    if (iv.lower == INT_MIN && iv.upper == INT_MAX)
+        LOG_INFO("%s%d = [⊤]", prefix, i);
+    else if (is_interval_bottom(iv))
+        LOG_INFO("%s%d = [⊥]", prefix, i);
+    else
+        LOG_INFO("%s%d = [%d,%d]", prefix, i, iv.lower, iv.upper);
+}
+
 void interval_state_print(const IntervalState* st)
 {
-    if (!st || !st->env || !st->locals || !st->stack) {
+    if (!st || !st->slots) {
         LOG_INFO("(null)");
         return;
     }
@@ -1007,65 +1747,178 @@ void interval_state_print(const IntervalState* st)
     }
 
     LOG_INFO("Locals:");
-    for (size_t i = 0; i < vector_length(st->locals); i++) {
-        int name = *(int*)vector_get(st->locals, i);
-        Interval* iv = vector_get(st->env, name);
-        if (iv->lower == INT_MIN && iv->upper == INT_MAX)
-            LOG_INFO("v%d = n%d [⊤]", i, name);
-        else if (iv->lower == 1 && iv->upper == 0)
-            LOG_INFO("v%d = n%d [⊥]", i, name);
-        else
-            LOG_INFO("v%d = n%d [%d,%d]", i, name, iv->lower, iv->upper);
+    for (int i = 0; i < st->max_locals; i++) {
+        interval_print("v", i, st->slots[i]);
     }
 
     LOG_INFO("Stack:");
-    for (size_t i = 0; i < vector_length(st->stack); i++) {
-        int* name = vector_get(st->stack, i);
-        if (!name) {
-            LOG_ERROR("NULL NAME ON STACK");
-        }
-        Interval* iv = vector_get(st->env, *name);
-        if (!iv) {
-            LOG_ERROR("NULL ENV INTERVAL");
-        }
-        if (iv->lower == INT_MIN && iv->upper == INT_MAX)
-            LOG_INFO("[%d] = n%d [⊤]", i, *name);
-        else if (iv->lower == 1 && iv->upper == 0)
-            LOG_INFO("v%d = n%d [⊥]", i, *name);
-        else
-            LOG_INFO("[%d] = n%d [%d,%d]", i, *name, iv->lower, iv->upper);
+    for (int i = 0; i < st->stack_len; i++) {
+        interval_print("s", i, *stack_slot(st, i));
+    }
+}
+
+// origins included, bottom states compare equal whatever their slots hold
+void interval_state_write(FILE* stream, const IntervalState* st)
+{
+    if (is_interval_state_bottom(st)) {
+        fprintf(stream, "bottom");
+        return;
     }
 
-    LOG_INFO("Env (all names):");
-    for (size_t i = 0; i < vector_length(st->env); i++) {
-        Interval* iv = vector_get(st->env, i);
-        if (iv->lower == INT_MIN && iv->upper == INT_MAX)
-            LOG_INFO("n%d = [⊤]", i);
-        else if (iv->lower == 1 && iv->upper == 0)
-            LOG_INFO("v%d = [⊥]", i);
-        else
-            LOG_INFO("n%d = [%d,%d]", i, iv->lower, iv->upper);
+    fprintf(stream, "stack %d:", st->stack_len);
+    for (int i = 0; i < st->max_locals + st->stack_len; i++) {
+        fprintf(stream, " [%d, %d]", st->slots[i].lower, st->slots[i].upper);
+    }
+    for (int i = 0; i < st->stack_len; i++) {
+        fprintf(stream, " o%d", st->origin[i]);
     }
 }
 
+// kept up to date by every operation that empties a slot
 bool is_interval_state_bottom(const IntervalState* state)
 {
-    if (!state) {
-        return true;
+    return !state || state->bottom;
+}
+
+/*** SLAB ***/
+
+/*
+ * States of a whole analysis, with their stamps in one allocation: every
+ * state has the same frame, so the stamps of state i start at a fixed offset.
+ * All states start on a single bottom page and only get one of their own when
+ * the analysis reaches them.
+ */
+struct IntervalSlab {
+    int count;
+    IntervalState* states;
+    unsigned* stamps;
+};
+
+IntervalSlab* interval_slab_new(int count, int max_locals, int max_stack)
+{
+    IntervalSlab* slab = malloc(sizeof(IntervalSlab));
+    if (!slab) {
+        return NULL;
     }
 
-    if (!vector_length(state->env) && !vector_length(state->locals) && !vector_length(state->stack)) {
-        return true;
+    int width = state_width(max_locals, max_stack);
+    IntervalPage* bottom = page_new(max_locals, max_stack);
+
+    slab->count = 0;
+    slab->states = malloc(sizeof(IntervalState) * count);
+    slab->stamps = malloc(sizeof(unsigned) * width * count);
+
+    if (!bottom || !slab->states || !slab->stamps) {
+        free(bottom);
+        interval_slab_delete(slab);
+        return NULL;
     }
 
-    Interval bottom = interval_bottom();
+    for (int i = 0; i < count; i++) {
+        IntervalState* st = &slab->states[i];
+
+        state_bind(st, slab->stamps + (size_t)width * i, bottom, max_locals, max_stack);
+        page_retain(bottom);
+    }
+
+    if (count) {
+        state_fill(&slab->states[0], interval_bottom(), true);
+    }
+
+    page_release(bottom);
+    slab->count = count;
+
+    return slab;
+}
+
+IntervalState* interval_slab_state(IntervalSlab* slab, int index)
+{
+    if (!slab || index < 0 || index >= slab->count) {
+        return NULL;
+    }
 
-    for (size_t i = 0; i < vector_length(state->env); i++) {
-        Interval* iv = vector_get(state->env, i);
-        if (bottom.lower == iv->lower && bottom.upper == iv->upper) {
-            return true;
+    return &slab->states[index];
+}
+
+void interval_slab_delete(IntervalSlab* slab)
+{
+    if (!slab) {
+        return;
+    }
+
+    for (int i = 0; i < slab->count; i++) {
+        page_release(slab->states[i].page);
+    }
+
+    free(slab->states);
+    free(slab->stamps);
+    free(slab);
+}
+
+/*** ARENA ***/
+
+/*
+ * Scratch states of one thread. States are handed out in order and all given
+ * back at once by interval_arena_reset, so once warm the arena does not
+ * allocate.
+ */
+struct IntervalArena {
+    Vector* states; // Vector<IntervalState*>
+    size_t used;
+    int max_locals;
+    int max_stack;
+};
+
+IntervalArena* interval_arena_new(int max_locals, int max_stack)
+{
+    IntervalArena* arena = malloc(sizeof(IntervalArena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->states = vector_new(sizeof(IntervalState*));
+    arena->used = 0;
+    arena->max_locals = max_locals;
+    arena->max_stack = max_stack;
+
+    return arena;
+}
+
+// the returned state is bottom
+IntervalState* interval_arena_state(IntervalArena* arena)
+{
+    IntervalState* st;
+
+    if (arena->used < vector_length(arena->states)) {
+        st = *(IntervalState**)vector_get(arena->states, arena->used);
+        interval_state_set_bottom(st);
+    } else {
+        st = interval_new_bottom_state(arena->max_locals, arena->max_stack);
+        if (st) {
+            st->scratch = true;
         }
+        vector_push(arena->states, &st);
+    }
+
+    arena->used++;
+    return st;
+}
+
+void interval_arena_reset(IntervalArena* arena)
+{
+    arena->used = 0;
+}
+
+void interval_arena_delete(IntervalArena* arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    for (size_t i = 0; i < vector_length(arena->states); i++) {
+        interval_state_delete(*(IntervalState**)vector_get(arena->states, i));
     }
 
-    return false;
+    vector_delete(arena->states);
+    free(arena);
 }
@@ -0,0 +1,1159 @@
+#include "domain_zone.h"
+
+#include "common.h"
+#include "log.h"
+#include "opcode.h"
+#include "type.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*** ZONE ***/
+
+static long* entry(const Zone* z, int i, int j)
+{
+    return &z->m[i * z->size + j];
+}
+
+Zone* zone_new(int vars)
+{
+    Zone* z = malloc(sizeof(Zone));
+    if (!z) {
+        return NULL;
+    }
+
+    z->size = vars + 1;
+    z->m = malloc(sizeof(long) * z->size * z->size);
+    if (!z->m) {
+        free(z);
+        return NULL;
+    }
+
+    zone_set_top(z);
+    return z;
+}
+
+void zone_set_top(Zone* z)
+{
+    for (int i = 0; i < z->size * z->size; i++) {
+        z->m[i] = ZONE_INF;
+    }
+
+    for (int i = 0; i < z->size; i++) {
+        *entry(z, i, i) = 0;
+    }
+
+    z->bottom = false;
+    z->closed = true;
+}
+
+void zone_set_bottom(Zone* z)
+{
+    z->bottom = true;
+    z->closed = true;
+}
+
+int zone_copy(Zone* dst, const Zone* src)
+{
+    if (dst->size != src->size) {
+        return FAILURE;
+    }
+
+    memcpy(dst->m, src->m, sizeof(long) * src->size * src->size);
+    dst->bottom = src->bottom;
+    dst->closed = src->closed;
+
+    return SUCCESS;
+}
+
+/*
+ * row[j] = min(row[j], via + through[j]), the step shared by the closure and
+ * by adding a constraint. It runs over a whole row with no branch, so that
+ * it is vectorized.
+ */
+static void relax_row(long* row, long via, const long* through, int size)
+{
+#pragma omp simd
+    for (int j = 0; j < size; j++) {
+        long path = through[j] >= ZONE_INF ? ZONE_INF : via + through[j];
+        row[j] = path < row[j] ? path : row[j];
+    }
+}
+
+static void check_cycles(Zone* z)
+{
+    for (int i = 0; i < z->size; i++) {
+        if (*entry(z, i, i) < 0) {
+            zone_set_bottom(z);
+            return;
+        }
+    }
+}
+
+// Floyd-Warshall, a negative cycle means that no valuation satisfies the zone
+void zone_close(Zone* z)
+{
+    if (z->bottom || z->closed) {
+        return;
+    }
+
+    for (int k = 0; k < z->size; k++) {
+        const long* through = entry(z, k, 0);
+
+        for (int i = 0; i < z->size; i++) {
+            long via = *entry(z, i, k);
+            if (via < ZONE_INF) {
+                relax_row(entry(z, i, 0), via, through, z->size);
+            }
+        }
+    }
+
+    z->closed = true;
+    check_cycles(z);
+}
+
+/*
+ * Adds v_j - v_i <= c. On a closed zone a new shortest path goes through the
+ * new edge at most once, so a single pass over the rows closes it again.
+ */
+void zone_add(Zone* z, int i, int j, long c)
+{
+    zone_close(z);
+
+    if (z->bottom || c >= *entry(z, i, j)) {
+        return;
+    }
+
+    long back = *entry(z, j, i);
+    if (back < ZONE_INF && back + c < 0) {
+        zone_set_bottom(z);
+        return;
+    }
+
+    // the cycle through the new edge is not negative, so row j does not change
+    const long* through = entry(z, j, 0);
+    for (int a = 0; a < z->size; a++) {
+        long via = *entry(z, a, i);
+        if (via < ZONE_INF && a != j) {
+            relax_row(entry(z, a, 0), via + c, through, z->size);
+        }
+    }
+}
+
+void zone_forget(Zone* z, int v)
+{
+    zone_close(z);
+
+    if (z->bottom) {
+        return;
+    }
+
+    for (int k = 0; k < z->size; k++) {
+        *entry(z, v, k) = ZONE_INF;
+        *entry(z, k, v) = ZONE_INF;
+    }
+    *entry(z, v, v) = 0;
+}
+
+// v := w + c, w != v, w = 0 assigns the constant c
+void zone_assign(Zone* z, int v, int w, long c)
+{
+    zone_forget(z, v);
+    zone_add(z, w, v, c);
+    zone_add(z, v, w, -c);
+}
+
+// v := v + c
+void zone_shift(Zone* z, int v, long c)
+{
+    if (z->bottom) {
+        return;
+    }
+
+    for (int k = 0; k < z->size; k++) {
+        if (k == v) {
+            continue;
+        }
+
+        if (*entry(z, v, k) < ZONE_INF) {
+            *entry(z, v, k) -= c;
+        }
+
+        if (*entry(z, k, v) < ZONE_INF) {
+            *entry(z, k, v) += c;
+        }
+    }
+}
+
+// bounds of v_p - v_m, -ZONE_INF and ZONE_INF when unbounded
+void zone_range(Zone* z, int p, int m, long* lower, long* upper)
+{
+    zone_close(z);
+
+    long above = *entry(z, m, p);
+    long below = *entry(z, p, m);
+
+    *upper = above;
+    *lower = below >= ZONE_INF ? -ZONE_INF : -below;
+}
+
+// the join of closed zones is closed, else it is only sound
+int zone_join(Zone* acc, const Zone* z, int* changed)
+{
+    if (acc->size != z->size) {
+        return FAILURE;
+    }
+
+    if (z->bottom) {
+        return SUCCESS;
+    }
+
+    if (acc->bottom) {
+        *changed = 1;
+        return zone_copy(acc, z);
+    }
+
+    int any = 0;
+    for (int i = 0; i < z->size * z->size; i++) {
+        if (z->m[i] > acc->m[i]) {
+            acc->m[i] = z->m[i];
+            any = 1;
+        }
+    }
+
+    acc->closed = acc->closed && z->closed;
+    if (any) {
+        *changed = 1;
+    }
+
+    return SUCCESS;
+}
+
+// bounds that grew are dropped; acc is not closed again, or it could grow back
+int zone_widen(Zone* acc, const Zone* z, int* changed)
+{
+    if (acc->size != z->size) {
+        return FAILURE;
+    }
+
+    if (z->bottom) {
+        return SUCCESS;
+    }
+
+    if (acc->bottom) {
+        *changed = 1;
+        return zone_copy(acc, z);
+    }
+
+    int any = 0;
+    for (int i = 0; i < z->size * z->size; i++) {
+        if (z->m[i] > acc->m[i]) {
+            acc->m[i] = ZONE_INF;
+            any = 1;
+        }
+    }
+
+    if (any) {
+        acc->closed = false;
+        *changed = 1;
+    }
+
+    return SUCCESS;
+}
+
+void zone_print(const Zone* z)
+{
+    if (z->bottom) {
+        LOG_INFO("  [⊥]");
+        return;
+    }
+
+    for (int i = 0; i < z->size; i++) {
+        for (int j = 0; j < z->size; j++) {
+            long c = *entry(z, i, j);
+            if (i != j && c < ZONE_INF) {
+                LOG_INFO("  v%d - v%d <= %ld", j, i, c);
+            }
+        }
+    }
+}
+
+void zone_delete(Zone* z)
+{
+    if (!z) {
+        return;
+    }
+
+    free(z->m);
+    free(z);
+}
+
+/*** FORMS ***/
+
+// v_p - v_m + c, a local or -1 for the constant 0 on either side
+typedef struct {
+    int p;
+    int m;
+    long c;
+    bool known;
+} ZoneForm;
+
+static ZoneForm form_unknown(void)
+{
+    return (ZoneForm) { .p = -1, .m = -1, .c = 0, .known = false };
+}
+
+static ZoneForm form_local(int local)
+{
+    return (ZoneForm) { .p = local, .m = -1, .c = 0, .known = true };
+}
+
+static ZoneForm form_constant(long c)
+{
+    return (ZoneForm) { .p = -1, .m = -1, .c = c, .known = true };
+}
+
+// a + sign * b, if it still has one local on each side at most
+static ZoneForm form_combine(ZoneForm a, ZoneForm b, int sign)
+{
+    if (!a.known || !b.known) {
+        return form_unknown();
+    }
+
+    int locals[4] = { a.p, a.m, b.p, b.m };
+    int coefficients[4] = { 1, -1, sign, -sign };
+
+    // equal locals cancel out
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4 && locals[i] >= 0; j++) {
+            if (locals[j] == locals[i]) {
+                coefficients[i] += coefficients[j];
+                coefficients[j] = 0;
+            }
+        }
+    }
+
+    ZoneForm result = form_constant(a.c + sign * b.c);
+    for (int i = 0; i < 4; i++) {
+        if (locals[i] < 0 || coefficients[i] == 0) {
+            continue;
+        }
+
+        if (coefficients[i] == 1 && result.p == -1) {
+            result.p = locals[i];
+        } else if (coefficients[i] == -1 && result.m == -1) {
+            result.m = locals[i];
+        } else {
+            return form_unknown();
+        }
+    }
+
+    return result;
+}
+
+static ZoneForm form_negate(ZoneForm f)
+{
+    return f.known ? (ZoneForm) { .p = f.m, .m = f.p, .c = -f.c, .known = true } : form_unknown();
+}
+
+static bool form_uses(ZoneForm f, int local)
+{
+    return f.known && (f.p == local || f.m == local);
+}
+
+static bool form_equal(ZoneForm a, ZoneForm b)
+{
+    if (!a.known || !b.known) {
+        return a.known == b.known;
+    }
+
+    return a.p == b.p && a.m == b.m && a.c == b.c;
+}
+
+static bool is_int(const Type* type)
+{
+    return !type || type->kind == TK_INT;
+}
+
+// a + sign * b over the bounds of two int values, false if it may wrap around
+static bool fits(Interval a, Interval b, int sign)
+{
+    if (is_interval_bottom(a) || is_interval_bottom(b)) {
+        return false;
+    }
+
+    long lower = sign > 0 ? (long)a.lower + b.lower : (long)a.lower - b.upper;
+    long upper = sign > 0 ? (long)a.upper + b.upper : (long)a.upper - b.lower;
+
+    return lower >= INT_MIN && upper <= INT_MAX;
+}
+
+/*** PACKING ***/
+
+struct ZonePacking {
+    int num_locals;
+    int* parent; // union find, until sealed
+    int* cluster; // per local, -1 if it is in no cluster
+    int* index; // per local, its variable in the zone of its cluster
+    int* sizes; // variables per cluster
+    int count;
+};
+
+ZonePacking* zone_packing_new(int num_locals)
+{
+    ZonePacking* packing = calloc(1, sizeof(ZonePacking));
+    if (!packing) {
+        return NULL;
+    }
+
+    packing->num_locals = num_locals;
+    packing->parent = malloc(sizeof(int) * MAX(num_locals, 1));
+    packing->cluster = malloc(sizeof(int) * MAX(num_locals, 1));
+    packing->index = calloc(MAX(num_locals, 1), sizeof(int));
+
+    if (!packing->parent || !packing->cluster || !packing->index) {
+        zone_packing_delete(packing);
+        return NULL;
+    }
+
+    for (int i = 0; i < num_locals; i++) {
+        packing->parent[i] = i;
+        packing->cluster[i] = -1;
+    }
+
+    return packing;
+}
+
+static int packing_find(ZonePacking* packing, int local)
+{
+    while (packing->parent[local] != local) {
+        packing->parent[local] = packing->parent[packing->parent[local]];
+        local = packing->parent[local];
+    }
+
+    return local;
+}
+
+static void packing_relate(ZonePacking* packing, int a, int b)
+{
+    if (a < 0 || b < 0 || a >= packing->num_locals || b >= packing->num_locals) {
+        return;
+    }
+
+    packing->parent[packing_find(packing, a)] = packing_find(packing, b);
+}
+
+/*
+ * Relates the locals an instruction range could put in one constraint: a
+ * store of a form into a local, a comparison of two forms. Forms are followed
+ * as in the transfer, without their bounds.
+ */
+void zone_packing_scan(ZonePacking* packing, const IrFunction* function, int ip_start, int ip_end)
+{
+    ZoneForm stack[64];
+    int stack_len = 0;
+
+#define PACK_POP() (stack_len ? stack[--stack_len] : form_unknown())
+#define PACK_PUSH(f)                                                 \
+    do {                                                             \
+        if (stack_len < (int)(sizeof(stack) / sizeof(stack[0]))) { \
+            stack[stack_len++] = (f);                                \
+        }                                                            \
+    } while (0)
+
+    for (int ip = ip_start; ip <= ip_end; ip++) {
+        IrInstruction* ir = *(IrInstruction**)vector_get(function->ir_instructions, ip);
+
+        switch (ir->opcode) {
+        case OP_LOAD:
+            PACK_PUSH(form_local(ir->data.load.index));
+            break;
+        case OP_PUSH:
+            PACK_PUSH(form_constant(0));
+            break;
+        case OP_DUP: {
+            ZoneForm f = PACK_POP();
+            PACK_PUSH(f);
+            PACK_PUSH(f);
+            break;
+        }
+        case OP_STORE: {
+            ZoneForm f = PACK_POP();
+            if (f.known) {
+                packing_relate(packing, ir->data.store.index, f.p);
+                packing_relate(packing, ir->data.store.index, f.m);
+            }
+            break;
+        }
+        case OP_BINARY: {
+            ZoneForm b = PACK_POP();
+            ZoneForm a = PACK_POP();
+            BinaryOperator op = ir->data.binary.op;
+            PACK_PUSH(op == BO_ADD || op == BO_SUB ? form_combine(a, b, op == BO_ADD ? 1 : -1) : form_unknown());
+            break;
+        }
+        case OP_NEGATE: {
+            ZoneForm f = PACK_POP();
+            PACK_PUSH(form_negate(f));
+            break;
+        }
+        case OP_IF: {
+            ZoneForm b = PACK_POP();
+            ZoneForm a = PACK_POP();
+            ZoneForm d = form_combine(a, b, -1);
+            if (d.known) {
+                packing_relate(packing, d.p, d.m);
+            }
+            break;
+        }
+        case OP_IF_ZERO: {
+            ZoneForm d = PACK_POP();
+            if (d.known) {
+                packing_relate(packing, d.p, d.m);
+            }
+            break;
+        }
+        case OP_INCR:
+            break;
+        default:
+            // only the forms are followed, anything else ends the range
+            stack_len = 0;
+            break;
+        }
+    }
+
+#undef PACK_POP
+#undef PACK_PUSH
+}
+
+// returns the number of clusters, locals alone in theirs are left out
+int zone_packing_seal(ZonePacking* packing)
+{
+    int* members = calloc(MAX(packing->num_locals, 1), sizeof(int));
+    int* ids = malloc(sizeof(int) * MAX(packing->num_locals, 1));
+    if (!members || !ids) {
+        free(members);
+        free(ids);
+        return 0;
+    }
+
+    for (int i = 0; i < packing->num_locals; i++) {
+        members[packing_find(packing, i)]++;
+        ids[i] = -1;
+    }
+
+    packing->count = 0;
+    packing->sizes = calloc(MAX(packing->num_locals, 1), sizeof(int));
+
+    for (int i = 0; packing->sizes && i < packing->num_locals; i++) {
+        int root = packing_find(packing, i);
+        if (members[root] < 2) {
+            continue;
+        }
+
+        if (ids[root] == -1) {
+            ids[root] = packing->count++;
+        }
+
+        packing->cluster[i] = ids[root];
+        packing->index[i] = ++packing->sizes[ids[root]];
+    }
+
+    free(members);
+    free(ids);
+
+    return packing->sizes ? packing->count : 0;
+}
+
+void zone_packing_delete(ZonePacking* packing)
+{
+    if (!packing) {
+        return;
+    }
+
+    free(packing->parent);
+    free(packing->cluster);
+    free(packing->index);
+    free(packing->sizes);
+    free(packing);
+}
+
+/*** STATE ***/
+
+struct ZoneState {
+    const ZonePacking* packing;
+    Zone** zones; // per cluster
+    ZoneForm* stack;
+    int stack_len;
+    int max_stack;
+    bool bottom;
+};
+
+ZoneState* zone_state_new(const ZonePacking* packing, int max_stack)
+{
+    ZoneState* zs = calloc(1, sizeof(ZoneState));
+    if (!zs) {
+        return NULL;
+    }
+
+    zs->packing = packing;
+    zs->max_stack = max_stack;
+    zs->zones = calloc(MAX(packing->count, 1), sizeof(Zone*));
+    zs->stack = malloc(sizeof(ZoneForm) * MAX(max_stack, 1));
+
+    if (!zs->zones || !zs->stack) {
+        zone_state_delete(zs);
+        return NULL;
+    }
+
+    for (int k = 0; k < packing->count; k++) {
+        zs->zones[k] = zone_new(packing->sizes[k]);
+        if (!zs->zones[k]) {
+            zone_state_delete(zs);
+            return NULL;
+        }
+    }
+
+    zone_state_set_bottom(zs);
+    return zs;
+}
+
+ZoneState* zone_state_clone(const ZoneState* zs)
+{
+    ZoneState* clone = zone_state_new(zs->packing, zs->max_stack);
+    if (clone) {
+        zone_state_copy(clone, zs);
+    }
+
+    return clone;
+}
+
+void zone_state_set_bottom(ZoneState* zs)
+{
+    zs->bottom = true;
+    zs->stack_len = 0;
+}
+
+bool is_zone_state_bottom(const ZoneState* zs)
+{
+    return zs->bottom;
+}
+
+int zone_state_copy(ZoneState* dst, const ZoneState* src)
+{
+    if (dst->packing != src->packing || dst->max_stack != src->max_stack) {
+        return FAILURE;
+    }
+
+    for (int k = 0; k < src->packing->count; k++) {
+        zone_copy(dst->zones[k], src->zones[k]);
+    }
+
+    memcpy(dst->stack, src->stack, sizeof(ZoneForm) * src->stack_len);
+    dst->stack_len = src->stack_len;
+    dst->bottom = src->bottom;
+
+    return SUCCESS;
+}
+
+// a bottom zone makes the whole state unreachable
+static void settle(ZoneState* zs)
+{
+    for (int k = 0; k < zs->packing->count && !zs->bottom; k++) {
+        if (zs->zones[k]->bottom) {
+            zone_state_set_bottom(zs);
+        }
+    }
+}
+
+static void bound_local(ZoneState* zs, int local, Interval iv)
+{
+    const ZonePacking* packing = zs->packing;
+    if (local >= packing->num_locals || packing->cluster[local] == -1) {
+        return;
+    }
+
+    if (is_interval_bottom(iv)) {
+        zone_state_set_bottom(zs);
+        return;
+    }
+
+    Zone* z = zs->zones[packing->cluster[local]];
+    int v = packing->index[local];
+
+    zone_add(z, 0, v, iv.upper);
+    zone_add(z, v, 0, -(long)iv.lower);
+}
+
+static void sync_stack(ZoneState* zs, int stack_len)
+{
+    stack_len = MIN(stack_len, zs->max_stack);
+
+    for (int i = zs->stack_len; i < stack_len; i++) {
+        zs->stack[i] = form_unknown();
+    }
+
+    zs->stack_len = stack_len;
+}
+
+void zone_state_from_intervals(ZoneState* zs, const IntervalState* st)
+{
+    if (is_interval_state_bottom(st)) {
+        zone_state_set_bottom(zs);
+        return;
+    }
+
+    for (int k = 0; k < zs->packing->count; k++) {
+        zone_set_top(zs->zones[k]);
+    }
+
+    zs->bottom = false;
+    zs->stack_len = 0;
+    sync_stack(zs, st->stack_len);
+
+    zone_state_meet_intervals(zs, st);
+}
+
+void zone_state_meet_intervals(ZoneState* zs, const IntervalState* st)
+{
+    if (zs->bottom) {
+        return;
+    }
+
+    if (is_interval_state_bottom(st)) {
+        zone_state_set_bottom(zs);
+        return;
+    }
+
+    for (int local = 0; local < MIN(zs->packing->num_locals, st->max_locals) && !zs->bottom; local++) {
+        bound_local(zs, local, st->slots[local]);
+    }
+
+    settle(zs);
+}
+
+static void join_stacks(ZoneState* acc, const ZoneState* zs)
+{
+    int stack_len = MIN(acc->stack_len, zs->stack_len);
+
+    for (int i = 0; i < stack_len; i++) {
+        if (!form_equal(acc->stack[i], zs->stack[i])) {
+            acc->stack[i] = form_unknown();
+        }
+    }
+
+    acc->stack_len = stack_len;
+}
+
+static int combine_states(ZoneState* acc, const ZoneState* zs, int* changed, int (*combine)(Zone*, const Zone*, int*))
+{
+    if (acc->packing != zs->packing) {
+        return FAILURE;
+    }
+
+    if (zs->bottom) {
+        return SUCCESS;
+    }
+
+    if (acc->bottom) {
+        *changed = 1;
+        return zone_state_copy(acc, zs);
+    }
+
+    for (int k = 0; k < acc->packing->count; k++) {
+        combine(acc->zones[k], zs->zones[k], changed);
+    }
+
+    ZoneForm before[acc->stack_len + 1];
+    int before_len = acc->stack_len;
+    memcpy(before, acc->stack, sizeof(ZoneForm) * before_len);
+
+    join_stacks(acc, zs);
+
+    if (acc->stack_len != before_len) {
+        *changed = 1;
+    }
+    for (int i = 0; i < acc->stack_len; i++) {
+        if (!form_equal(before[i], acc->stack[i])) {
+            *changed = 1;
+        }
+    }
+
+    return SUCCESS;
+}
+
+int zone_state_join(ZoneState* acc, const ZoneState* zs, int* changed)
+{
+    return combine_states(acc, zs, changed, zone_join);
+}
+
+int zone_state_widen(ZoneState* acc, const ZoneState* zs, int* changed)
+{
+    return combine_states(acc, zs, changed, zone_widen);
+}
+
+/*** TRANSFER ***/
+
+static ZoneForm pop(ZoneState* zs)
+{
+    return zs->stack_len ? zs->stack[--zs->stack_len] : form_unknown();
+}
+
+static void push(ZoneState* zs, ZoneForm f)
+{
+    if (zs->stack_len < zs->max_stack) {
+        zs->stack[zs->stack_len++] = f;
+    }
+}
+
+static Interval before_stack(const IntervalState* before, int from_top)
+{
+    int i = before->stack_len - 1 - from_top;
+    return i >= 0 ? before->slots[before->max_locals + i] : interval_top();
+}
+
+// the stack no longer holds forms of a local that has been written
+static void forget_forms(ZoneState* zs, int local)
+{
+    for (int i = 0; i < zs->stack_len; i++) {
+        if (form_uses(zs->stack[i], local)) {
+            zs->stack[i] = form_unknown();
+        }
+    }
+}
+
+static bool clustered(const ZonePacking* packing, int local)
+{
+    return local >= 0 && local < packing->num_locals && packing->cluster[local] != -1;
+}
+
+static void assign_local(ZoneState* zs, int local, ZoneForm f, Interval value)
+{
+    const ZonePacking* packing = zs->packing;
+    if (!clustered(packing, local)) {
+        return;
+    }
+
+    int k = packing->cluster[local];
+    Zone* z = zs->zones[k];
+    int v = packing->index[local];
+
+    if (f.known && f.m == -1 && f.p == local) {
+        zone_shift(z, v, f.c);
+    } else if (f.known && f.m == -1 && f.p == -1) {
+        zone_assign(z, v, 0, f.c);
+    } else if (f.known && f.m == -1 && clustered(packing, f.p) && packing->cluster[f.p] == k) {
+        zone_assign(z, v, packing->index[f.p], f.c);
+    } else {
+        zone_forget(z, v);
+        bound_local(zs, local, value);
+    }
+}
+
+/*
+ * Follows ir from before to after, the interval states around it. Forms are
+ * only built when the bounds of before show that Java computes them without
+ * wrapping around.
+ */
+void zone_state_transfer(ZoneState* zs, const IntervalState* before, const IntervalState* after, IrInstruction* ir)
+{
+    if (zs->bottom) {
+        return;
+    }
+
+    if (is_interval_state_bottom(after)) {
+        zone_state_set_bottom(zs);
+        return;
+    }
+
+    sync_stack(zs, before->stack_len);
+
+    switch (ir->opcode) {
+    case OP_LOAD:
+        push(zs, form_local(ir->data.load.index));
+        break;
+    case OP_PUSH: {
+        Value* value = &ir->data.push.value;
+        if (value->type == TYPE_INT) {
+            push(zs, form_constant(value->data.int_value));
+        } else if (value->type == TYPE_BOOLEAN) {
+            push(zs, form_constant(value->data.bool_value));
+        } else if (value->type == TYPE_CHAR) {
+            push(zs, form_constant(value->data.char_value));
+        } else {
+            push(zs, form_unknown());
+        }
+        break;
+    }
+    case OP_DUP: {
+        ZoneForm f = pop(zs);
+        push(zs, f);
+        push(zs, f);
+        break;
+    }
+    case OP_STORE: {
+        int local = ir->data.store.index;
+        assign_local(zs, local, pop(zs), before_stack(before, 0));
+        forget_forms(zs, local);
+        break;
+    }
+    case OP_INCR: {
+        int local = ir->data.incr.index;
+        Interval amount = { ir->data.incr.amount, ir->data.incr.amount };
+
+        if (local < before->max_locals && fits(before->slots[local], amount, 1)) {
+            assign_local(zs, local, (ZoneForm) { .p = local, .m = -1, .c = amount.lower, .known = true }, interval_top());
+        } else {
+            assign_local(zs, local, form_unknown(), interval_top());
+        }
+        forget_forms(zs, local);
+        break;
+    }
+    case OP_BINARY: {
+        ZoneForm b = pop(zs);
+        ZoneForm a = pop(zs);
+        BinaryOP* binary = &ir->data.binary;
+        int sign = binary->op == BO_ADD ? 1 : binary->op == BO_SUB ? -1 : 0;
+
+        if (sign && is_int(binary->type) && fits(before_stack(before, 1), before_stack(before, 0), sign)) {
+            push(zs, form_combine(a, b, sign));
+        } else {
+            push(zs, form_unknown());
+        }
+        break;
+    }
+    case OP_NEGATE: {
+        ZoneForm f = pop(zs);
+        Interval value = before_stack(before, 0);
+
+        if (f.known && is_int(ir->data.negate.type) && !is_interval_bottom(value) && value.lower > INT_MIN) {
+            push(zs, form_negate(f));
+        } else {
+            push(zs, form_unknown());
+        }
+        break;
+    }
+    default:
+        // the stack effect is taken from the interval state
+        for (int i = 0; i < zs->stack_len; i++) {
+            zs->stack[i] = form_unknown();
+        }
+        break;
+    }
+
+    sync_stack(zs, after->stack_len);
+
+    settle(zs);
+}
+
+static IfCondition negate_condition(IfCondition condition)
+{
+    switch (condition) {
+    case IF_EQ:
+        return IF_NE;
+    case IF_NE:
+        return IF_EQ;
+    case IF_LT:
+        return IF_GE;
+    case IF_GE:
+        return IF_LT;
+    case IF_GT:
+        return IF_LE;
+    case IF_LE:
+    default:
+        return IF_GT;
+    }
+}
+
+// d op 0, on the zone holding the locals of d
+static void constrain(ZoneState* zs, ZoneForm d, IfCondition condition)
+{
+    const ZonePacking* packing = zs->packing;
+
+    if (zs->bottom || !d.known) {
+        return;
+    }
+
+    if (d.p == -1 && d.m == -1) {
+        bool holds = (condition == IF_EQ && d.c == 0) || (condition == IF_NE && d.c != 0)
+            || (condition == IF_LT && d.c < 0) || (condition == IF_LE && d.c <= 0)
+            || (condition == IF_GT && d.c > 0) || (condition == IF_GE && d.c >= 0);
+        if (!holds) {
+            zone_state_set_bottom(zs);
+        }
+        return;
+    }
+
+    if ((d.p != -1 && !clustered(packing, d.p)) || (d.m != -1 && !clustered(packing, d.m))) {
+        return;
+    }
+
+    int k = d.p != -1 ? packing->cluster[d.p] : packing->cluster[d.m];
+    if (d.p != -1 && d.m != -1 && packing->cluster[d.m] != k) {
+        return;
+    }
+
+    Zone* z = zs->zones[k];
+    int p = d.p == -1 ? 0 : packing->index[d.p];
+    int m = d.m == -1 ? 0 : packing->index[d.m];
+
+    // v_p - v_m + c op 0
+    switch (condition) {
+    case IF_LE:
+        zone_add(z, m, p, -d.c);
+        break;
+    case IF_LT:
+        zone_add(z, m, p, -d.c - 1);
+        break;
+    case IF_GE:
+        zone_add(z, p, m, d.c);
+        break;
+    case IF_GT:
+        zone_add(z, p, m, d.c - 1);
+        break;
+    case IF_EQ:
+        zone_add(z, m, p, -d.c);
+        zone_add(z, p, m, d.c);
+        break;
+    case IF_NE: {
+        long lower, upper;
+        zone_range(z, p, m, &lower, &upper);
+        if (lower == upper && lower == -d.c) {
+            zone_set_bottom(z);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    settle(zs);
+}
+
+// zs_true and zs_false both hold the state before the branch
+void zone_state_branch(ZoneState* zs_true, ZoneState* zs_false, IrInstruction* ir)
+{
+    if (zs_true->bottom) {
+        zone_state_set_bottom(zs_false);
+        return;
+    }
+
+    ZoneForm d;
+    if (ir->opcode == OP_IF) {
+        ZoneForm b = pop(zs_true);
+        ZoneForm a = pop(zs_true);
+        pop(zs_false);
+        pop(zs_false);
+        d = form_combine(a, b, -1);
+    } else {
+        d = pop(zs_true);
+        pop(zs_false);
+    }
+
+    constrain(zs_true, d, ir->data.ift.condition);
+    constrain(zs_false, d, negate_condition(ir->data.ift.condition));
+}
+
+static bool form_range(ZoneState* zs, ZoneForm f, Interval* iv)
+{
+    const ZonePacking* packing = zs->packing;
+
+    if (!f.known || (f.p == -1 && f.m == -1)) {
+        return false;
+    }
+
+    if ((f.p != -1 && !clustered(packing, f.p)) || (f.m != -1 && !clustered(packing, f.m))) {
+        return false;
+    }
+
+    int k = f.p != -1 ? packing->cluster[f.p] : packing->cluster[f.m];
+    if (f.p != -1 && f.m != -1 && packing->cluster[f.m] != k) {
+        return false;
+    }
+
+    long lower, upper;
+    zone_range(zs->zones[k], f.p == -1 ? 0 : packing->index[f.p], f.m == -1 ? 0 : packing->index[f.m], &lower, &upper);
+
+    // forms hold int values, the zone may only know less
+    lower = lower <= -ZONE_INF ? INT_MIN : MAX(lower + f.c, (long)INT_MIN);
+    upper = upper >= ZONE_INF ? INT_MAX : MIN(upper + f.c, (long)INT_MAX);
+
+    *iv = (Interval) { (int)lower, (int)upper };
+    return true;
+}
+
+/*
+ * Gives st what the zones know of its locals and of its stack, scratch being
+ * any state of the same frame.
+ */
+void zone_state_reduce(ZoneState* zs, IntervalState* st, IntervalState* scratch)
+{
+    if (zs->bottom) {
+        interval_state_set_bottom(st);
+        return;
+    }
+
+    if (is_interval_state_bottom(st)) {
+        zone_state_set_bottom(zs);
+        return;
+    }
+
+    interval_state_copy(scratch, st);
+    if (interval_state_own(scratch)) {
+        return;
+    }
+
+    for (int local = 0; local < MIN(zs->packing->num_locals, st->max_locals); local++) {
+        form_range(zs, form_local(local), &scratch->slots[local]);
+    }
+
+    for (int i = 0; i < MIN(zs->stack_len, st->stack_len); i++) {
+        form_range(zs, zs->stack[i], &scratch->slots[st->max_locals + i]);
+    }
+
+    int changed = 0;
+    interval_intersection(st, scratch, &changed);
+
+    if (is_interval_state_bottom(st)) {
+        zone_state_set_bottom(zs);
+    }
+}
+
+void zone_state_print(const ZoneState* zs)
+{
+    if (zs->bottom) {
+        LOG_INFO("[⊥]");
+        return;
+    }
+
+    const ZonePacking* packing = zs->packing;
+    for (int k = 0; k < packing->count; k++) {
+        char line[256];
+        int used = snprintf(line, sizeof(line), "zone %d:", k);
+
+        for (int local = 0; local < packing->num_locals && used < (int)sizeof(line); local++) {
+            if (packing->cluster[local] == k) {
+                used += snprintf(line + used, sizeof(line) - used, " v%d=l%d", packing->index[local], local);
+            }
+        }
+
+        LOG_INFO("%s", line);
+        zone_print(zs->zones[k]);
+    }
+}
+
+void zone_state_delete(ZoneState* zs)
+{
+    if (!zs) {
+        return;
+    }
+
+    for (int k = 0; zs->zones && k < zs->packing->count; k++) {
+        zone_delete(zs->zones[k]);
+    }
+
+    free(zs->zones);
+    free(zs->stack);
+    free(zs);
+}
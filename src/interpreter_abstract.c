@@ -1,515 +1,2294 @@
+#define _GNU_SOURCE
+#include <string.h>
+
 #include "interpreter_abstract.h"
 #include "cfg.h"
+#include "common.h"
+#include "domain.h"
+#include "domain_congruence.h"
+#include "domain_constant.h"
 #include "domain_interval.h"
+#include "domain_zone.h"
 #include "graph.h"
 #include "ir_program.h"
 #include "log.h"
+#include "result_cache.h"
+#include "ssa.h"
+#include "stats.h"
 #include "wpo.h"
 
-#include <limits.h>
-#include <omp.h>
+#include <limits.h>
+#include <omp.h>
+
+typedef struct {
+    int source;
+    int index; // 0 for the branch target or the only successor, 1 for the fall through
+    unsigned seen; // version of the edge state when the target last pulled it
+} FlowEdge;
+
+enum { PHASE_START, PHASE_ASCENDING, PHASE_DESCENDING };
+
+struct AbstractContext {
+    Cfg* cfg;
+    Graph* flow; // cfg edges, loop back edges redirected to the component exits
+    Vector** predecessors; // Vector<FlowEdge> predecessors[nodes_num], built from flow
+    WPO wpo;
+    int block_count;
+    int exit_count;
+    int* loop_iteration;
+    int* widening_delay; // per component
+    Vector** thresholds; // Vector<int> thresholds[num_components], sorted
+    Vector** inductions; // Vector<Induction> inductions[num_components]
+    int* phase; // per component
+    int* narrowing_left; // per component
+    int narrowing_iterations;
+    const AbstractDomain* domain; // of the dense analysis, the sparse one runs on intervals
+    AbstractArena** arenas; // scratch states, one arena per thread
+    int arena_count;
+    int threads; // team size of the fixpoint, 0 for the OpenMP default
+    unsigned schedule_seed; // non zero to randomize the order tasks are spawned in
+    unsigned long schedule_ticks;
+    Engine engine;
+    bool invariants; // record the state before every instruction
+    bool zones; // refine the loops with zones once the intervals are stable
+    int partitions; // states kept per block by the trace partitioning, at most 1 when it is off
+    int partition_depth;
+    double deadline; // omp_get_wtime() after which heads are widened at once, 0 for none
+    int expired; // set once the deadline passed, read concurrently
+    Vector* record; // Vector<char*>, receives the canonical X_out of every node when set
+    int max_locals; // frame of every state, large enough for all inlined functions
+    int max_stack;
+    unsigned* applied; // per node, version of X_in its outputs were computed from
+    unsigned* checked_version; // per component, version of the exit state at the last failed check
+    SsaForm* ssa; // set when the sparse analysis is selected
+    char* method_id; // set when results are cached
+    uint64_t hash;
+    uint64_t shape;
+    AbstractState** seeds; // per node, head states of a previous analysis of the same cfg shape
+    AbstractState* entry; // arguments within the range of their types, NULL for top
+    bool cache_hit;
+    AbstractResult cached;
+#ifdef STATS
+    FixpointStats* stats;
+    char* stats_path; // NULL for stderr
+#endif
+};
+
+typedef struct {
+    int local;
+    int step;
+} Induction;
+
+static int compare_int(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void push_threshold(Vector* thresholds, long value)
+{
+    if (value >= INT_MIN && value <= INT_MAX) {
+        int threshold = (int)value;
+        vector_push(thresholds, &threshold);
+    }
+}
+
+/*
+ * Widening thresholds of a loop: every integer constant pushed in the loop
+ * body, plus the neighbours of the constants used as branch operands, so that
+ * both strict and non strict comparisons keep their bound.
+ */
+static Vector* harvest_thresholds(AbstractContext* ctx, Vector* component_nodes)
+{
+    Vector* collected = vector_new(sizeof(int));
+    if (!collected) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < vector_length(component_nodes); i++) {
+        int node = *(int*)vector_get(component_nodes, i);
+        if (node >= ctx->block_count) {
+            continue;
+        }
+
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+        Vector* ir_instructions = block->ir_function->ir_instructions;
+
+        for (int ip = block->ip_start; ip <= block->ip_end; ip++) {
+            IrInstruction* ir = *(IrInstruction**)vector_get(ir_instructions, ip);
+
+            if (ir->opcode == OP_PUSH && ir->data.push.value.type == TYPE_INT) {
+                push_threshold(collected, ir->data.push.value.data.int_value);
+            } else if (ir->opcode == OP_IF_ZERO) {
+                push_threshold(collected, -1);
+                push_threshold(collected, 0);
+                push_threshold(collected, 1);
+            } else if (ir->opcode == OP_IF && ip > block->ip_start) {
+                IrInstruction* operand = *(IrInstruction**)vector_get(ir_instructions, ip - 1);
+                if (operand->opcode == OP_PUSH && operand->data.push.value.type == TYPE_INT) {
+                    long value = operand->data.push.value.data.int_value;
+                    push_threshold(collected, value - 1);
+                    push_threshold(collected, value + 1);
+                }
+            }
+        }
+    }
+
+    Vector* thresholds = vector_new(sizeof(int));
+    int count = vector_length(collected);
+
+    if (count) {
+        qsort(vector_get(collected, 0), count, sizeof(int), compare_int);
+    }
+
+    for (int i = 0; i < count; i++) {
+        int* value = vector_get(collected, i);
+        if (i == 0 || *value != *(int*)vector_get(collected, i - 1)) {
+            vector_push(thresholds, value);
+        }
+    }
+
+    vector_delete(collected);
+    return thresholds;
+}
+
+static int is_component_node(AbstractContext* ctx, int component_id, int node)
+{
+    C* component = vector_get(ctx->wpo.Cx, component_id);
+    for (size_t i = 0; i < vector_length(component->components); i++) {
+        if (*(int*)vector_get(component->components, i) == node) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Induction variables of a loop: locals whose only write in it is one
+ * increment by a constant, in a block of the loop itself (not of a nested one)
+ * other than the head. Such a local moves by step at most once per iteration.
+ */
+static Vector* find_inductions(AbstractContext* ctx, int component_id)
+{
+    Vector* inductions = vector_new(sizeof(Induction));
+    if (!inductions) {
+        return NULL;
+    }
+
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    BasicBlock* head_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, head);
+    IrInstruction* last = *(IrInstruction**)vector_get(head_block->ir_function->ir_instructions, head_block->ip_end);
+
+    // the guard bounding the locals is the branch closing the head
+    if (!ir_instruction_is_conditional(last)) {
+        return inductions;
+    }
+
+    int num_locals = head_block->num_locals;
+    int* writes = calloc(num_locals, sizeof(int));
+    IrInstruction** increments = calloc(num_locals, sizeof(IrInstruction*));
+    int* increment_blocks = calloc(num_locals, sizeof(int));
+    if (!writes || !increments || !increment_blocks) {
+        goto cleanup;
+    }
+
+    C* component = vector_get(ctx->wpo.Cx, component_id);
+    for (size_t i = 0; i < vector_length(component->components); i++) {
+        int node = *(int*)vector_get(component->components, i);
+        if (node >= ctx->block_count) {
+            continue;
+        }
+
+        // inlined callees reuse the local slots
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+        if (block->ir_function != head_block->ir_function) {
+            goto cleanup;
+        }
+
+        for (int ip = block->ip_start; ip <= block->ip_end; ip++) {
+            IrInstruction* ir = *(IrInstruction**)vector_get(block->ir_function->ir_instructions, ip);
+            int local = -1;
+
+            if (ir->opcode == OP_STORE) {
+                local = ir->data.store.index;
+            } else if (ir->opcode == OP_INCR) {
+                local = ir->data.incr.index;
+                if (local >= 0 && local < num_locals) {
+                    increments[local] = ir;
+                    increment_blocks[local] = node;
+                }
+            }
+
+            if (local >= 0 && local < num_locals) {
+                writes[local]++;
+            }
+        }
+    }
+
+    for (int local = 0; local < num_locals; local++) {
+        IrInstruction* increment = increments[local];
+        int block = increment_blocks[local];
+
+        if (writes[local] == 1 && increment && increment->data.incr.amount
+            && block != head && ctx->wpo.node_to_component[block] == component_id) {
+            Induction induction = { .local = local, .step = increment->data.incr.amount };
+            vector_push(inductions, &induction);
+        }
+    }
+
+cleanup:
+    free(writes);
+    free(increments);
+    free(increment_blocks);
+
+    return inductions;
+}
+
+/*
+ * Abstract states flow along the cfg edges, the WPO edges are only used for
+ * scheduling. An edge closing a loop feeds the exit of the loop instead of its
+ * head, the exit decides whether the head has to be updated.
+ */
+static void redirect_back_edges(AbstractContext* ctx)
+{
+    for (int u = 0; u < ctx->block_count; u++) {
+        Node* node = vector_get(ctx->flow->nodes, u);
+
+        for (size_t i = 0; i < vector_length(node->successors); i++) {
+            int* v = vector_get(node->successors, i);
+            int component_id = ctx->wpo.node_to_component[*v];
+
+            if (component_id == -1 || *(int*)vector_get(ctx->wpo.heads, component_id) != *v) {
+                continue;
+            }
+
+            if (is_component_node(ctx, component_id, u)) {
+                *v = *(int*)vector_get(ctx->wpo.exits, component_id);
+            }
+        }
+    }
+}
+
+static void build_predecessors(AbstractContext* ctx)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+
+    ctx->predecessors = malloc(sizeof(Vector*) * nodes_num);
+    for (int i = 0; i < nodes_num; i++) {
+        ctx->predecessors[i] = vector_new(sizeof(FlowEdge));
+    }
+
+    for (int u = 0; u < ctx->block_count; u++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, u);
+        IrInstruction* last = *(IrInstruction**)vector_get(block->ir_function->ir_instructions, block->ip_end);
+        int conditional = ir_instruction_is_conditional(last);
+
+        Node* node = vector_get(ctx->flow->nodes, u);
+        for (size_t i = 0; i < vector_length(node->successors); i++) {
+            int v = *(int*)vector_get(node->successors, i);
+            FlowEdge edge = { .source = u, .index = conditional ? MIN((int)i, 1) : 0, .seen = UINT_MAX };
+
+            vector_push(ctx->predecessors[v], &edge);
+        }
+    }
+}
+
+/*
+ * Key of a cached result: the ir of the method and of its callees, and every
+ * parameter the analysis depends on.
+ */
+static uint64_t analysis_hash(const Method* m, const Config* cfg, const AbstractDomain* domain)
+{
+    uint64_t hash = ir_program_get_hash(m, cfg);
+
+    hash = hash_string(hash, domain->name);
+    hash = hash_int(hash, cfg->widening_delay);
+    hash = hash_int(hash, cfg->narrowing_iterations);
+    hash = hash_int(hash, cfg->sparse);
+    hash = hash_int(hash, cfg->zones);
+    hash = hash_int(hash, cfg->partitions);
+    hash = hash_int(hash, cfg->partition_depth);
+
+    return hash;
+}
+
+// blocks, edges and frame of the inlined cfg, node ids mean the same on an equal shape
+static uint64_t shape_hash(AbstractContext* ctx)
+{
+    uint64_t hash = hash_int(HASH_SEED, ctx->block_count);
+
+    hash = hash_int(hash, ctx->exit_count);
+    hash = hash_int(hash, ctx->max_locals);
+    hash = hash_int(hash, ctx->max_stack);
+
+    for (int i = 0; i < ctx->block_count; i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
+        Node* node = vector_get(ctx->flow->nodes, i);
+
+        hash = hash_int(hash, block->ip_end - block->ip_start);
+        hash = hash_int(hash, block->num_locals);
+
+        for (size_t j = 0; j < vector_length(node->successors); j++) {
+            hash = hash_int(hash, *(int*)vector_get(node->successors, j));
+        }
+        hash = hash_int(hash, -1);
+    }
+
+    return hash;
+}
+
+AbstractContext* interpreter_abstract_setup(const Method* m, const Options* opts, const Config* cfg)
+{
+    AbstractContext* ctx = NULL;
+    Cfg* control_flow_graph = NULL;
+    Graph* graph = NULL;
+
+    if (!m || !opts || !cfg) {
+        goto cleanup;
+    }
+
+    // the budget covers the construction of the cfg as well
+    double started = omp_get_wtime();
+
+    const AbstractDomain* domain = domain_find(cfg->domain ? cfg->domain : "interval");
+    if (!domain) {
+        LOG_ERROR("Unknown abstract domain %s", cfg->domain);
+        goto cleanup;
+    }
+
+    IrFunction* ir_function = ir_program_get_function_ir(m, cfg);
+    if (!ir_function) {
+        goto cleanup;
+    }
+
+    uint64_t hash = 0;
+    if (cfg->cache) {
+        hash = analysis_hash(m, cfg, domain);
+
+        AbstractResult cached;
+        if (result_cache_lookup(method_get_id(m), hash, cfg, &cached) == SUCCESS) {
+            LOG_INFO("Reusing the cached result of %s", method_get_id(m));
+            ctx = calloc(1, sizeof(AbstractContext));
+            if (ctx) {
+                ctx->domain = domain;
+                ctx->cache_hit = true;
+                ctx->cached = cached;
+            } else {
+                abstract_result_delete(&cached);
+            }
+            goto cleanup;
+        }
+    }
+
+    // the cached cfgs are shared by concurrent analyses, each one inlines its own copy
+    const Cfg* method_cfg = ir_program_get_cfg(m, cfg);
+
+#ifdef DEBUG
+    LOG_DEBUG("BEFORE");
+    cfg_print((Cfg*)method_cfg);
+#endif
+
+    control_flow_graph = cfg_inline(method_cfg, (Config*)cfg, (Method*)m);
+    if (!control_flow_graph) {
+        goto cleanup;
+    }
+
+#ifdef DEBUG
+    LOG_DEBUG("AFTER");
+    cfg_print(control_flow_graph);
+#endif
+
+    graph = graph_from_cfg(control_flow_graph);
+    if (!graph) {
+        goto cleanup;
+    }
+
+    WPO wpo;
+    // Graph* test = graph_create_test_8_nodes();
+    // if (wpo_construct_aux(test, &wpo)) {
+    if (wpo_construct_aux(graph, &wpo)) {
+        goto cleanup;
+    }
+
+    ctx = calloc(1, sizeof(AbstractContext));
+    if (!ctx) {
+        goto cleanup;
+    }
+
+    ctx->block_count = vector_length(control_flow_graph->blocks);
+    ctx->exit_count = vector_length(wpo.wpo->nodes) - ctx->block_count;
+    ctx->wpo = wpo;
+    ctx->domain = domain;
+    ctx->cfg = control_flow_graph;
+    ctx->flow = graph;
+
+    ctx->max_locals = 0;
+    ctx->max_stack = 0;
+    for (int i = 0; i < ctx->block_count; i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
+
+        ctx->max_locals = MAX(ctx->max_locals, MAX(block->num_locals, block->ir_function->max_locals));
+        ctx->max_stack = MAX(ctx->max_stack, block->ir_function->max_stack);
+    }
+
+    // built on the cfg edges, before the back edges are redirected
+    ctx->ssa = NULL;
+    if (cfg->sparse && domain != &interval_domain) {
+        LOG_ERROR("The sparse analysis runs on intervals only, falling back to the dense analysis");
+    } else if (cfg->sparse) {
+        BasicBlock* entry_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, 0);
+        ctx->ssa = ssa_build(ctx->cfg, graph, ctx->max_locals, ctx->max_stack, entry_block->num_locals);
+        if (!ctx->ssa) {
+            LOG_ERROR("While building the SSA form, falling back to the dense analysis");
+        }
+    }
+
+    redirect_back_edges(ctx);
+    build_predecessors(ctx);
+
+    int num_components = vector_length(ctx->wpo.Cx);
+    ctx->loop_iteration = calloc(num_components, sizeof(int));
+    ctx->phase = calloc(num_components, sizeof(int));
+    ctx->narrowing_left = calloc(num_components, sizeof(int));
+    ctx->narrowing_iterations = cfg->narrowing_iterations;
+    ctx->engine = cfg->engine;
+    ctx->invariants = cfg->invariants;
+    ctx->zones = cfg->zones;
+    ctx->partitions = cfg->partitions;
+    ctx->partition_depth = cfg->partition_depth;
+    ctx->deadline = cfg->deadline ? started + cfg->deadline / 1000.0 : 0;
+    ctx->checked_version = calloc(num_components, sizeof(unsigned));
+
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    ctx->applied = malloc(sizeof(unsigned) * nodes_num);
+    for (int i = 0; i < nodes_num; i++) {
+        ctx->applied[i] = UINT_MAX;
+    }
+
+    // the arguments start within the range of their types
+    Vector* arg_types = method_get_arguments_as_types(m);
+    ctx->entry = arg_types ? domain->new_top(ctx->max_locals, ctx->max_stack) : NULL;
+    if (ctx->entry && domain->set_arguments(ctx->entry, arg_types)) {
+        domain->delete(ctx->entry);
+        ctx->entry = NULL;
+    }
+    vector_delete(arg_types);
+
+    ctx->arena_count = omp_get_max_threads();
+    ctx->arenas = malloc(sizeof(AbstractArena*) * ctx->arena_count);
+    for (int i = 0; i < ctx->arena_count; i++) {
+        ctx->arenas[i] = domain->arena_new(ctx->max_locals, ctx->max_stack);
+    }
+    ctx->widening_delay = malloc(sizeof(int) * num_components);
+    ctx->thresholds = malloc(sizeof(Vector*) * num_components);
+    ctx->inductions = malloc(sizeof(Vector*) * num_components);
+
+    for (int i = 0; i < num_components; i++) {
+        C* component = vector_get(ctx->wpo.Cx, i);
+        ctx->thresholds[i] = harvest_thresholds(ctx, component->components);
+        ctx->inductions[i] = find_inductions(ctx, i);
+
+        // thresholds already stop widening at the loop bounds, delaying it
+        // further only costs iterations
+        if (vector_length(ctx->thresholds[i])) {
+            ctx->widening_delay[i] = MIN(cfg->widening_delay, 1);
+        } else {
+            ctx->widening_delay[i] = cfg->widening_delay;
+        }
+    }
+
+#ifdef STATS
+    ctx->stats = stats_new(method_get_id(m), ctx->arena_count, nodes_num, num_components);
+    ctx->stats_path = cfg->stats ? strdup(cfg->stats) : NULL;
+#endif
+
+    if (cfg->cache) {
+        ctx->method_id = strdup(method_get_id(m));
+        ctx->hash = hash;
+        ctx->shape = shape_hash(ctx);
+    }
+
+#ifdef DEBUG
+    graph_print(wpo.wpo);
+
+    if (ctx->ssa) {
+        ssa_print(ctx->ssa);
+    }
+
+    for (size_t i = 0; i < vector_length(ctx->wpo.Cx); i++) {
+        LOG_DEBUG("COMPONENT %d, WITH HEAD: %d", i, *(int*)vector_get(ctx->wpo.heads, i));
+        C* component = vector_get(ctx->wpo.Cx, i);
+        for (size_t j = 0; j < vector_length(component->components); j++) {
+            LOG_DEBUG("%d", *(int*)vector_get(component->components, j));
+        }
+    }
+#endif
+
+cleanup:
+    if (!ctx) {
+        graph_delete(graph);
+        cfg_delete(control_flow_graph);
+    }
+
+    return ctx;
+}
+
+static int block_num_locals(AbstractContext* ctx, int node)
+{
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+    return block->num_locals;
+}
+
+static int is_component_head(AbstractContext* ctx, int node)
+{
+    int component_id = ctx->wpo.node_to_component[node];
+    return component_id != -1 && *(int*)vector_get(ctx->wpo.heads, component_id) == node;
+}
+
+// tasks are tied, a visit runs on a single thread from start to end
+static AbstractArena* thread_arena(AbstractContext* ctx)
+{
+    return ctx->arenas[omp_get_thread_num()];
+}
+
+/*
+ * Anytime analysis: once the deadline passed, every head still ascending is
+ * widened without delay nor thresholds and descending steps are skipped, so
+ * the fixpoint ends after about one more pass. Every state is still sound.
+ */
+static bool deadline_expired(AbstractContext* ctx)
+{
+    if (!ctx->deadline) {
+        return false;
+    }
+
+    int expired;
+#pragma omp atomic read
+    expired = ctx->expired;
+
+    if (!expired && omp_get_wtime() >= ctx->deadline) {
+#pragma omp atomic write
+        ctx->expired = 1;
+        expired = 1;
+    }
+
+    return expired;
+}
+
+/*
+ * Randomized schedule of the determinism checker: successors are spawned
+ * starting from a random one, and tasks start after a random spin, so that
+ * different interleavings are explored. The result must not change.
+ */
+static uint64_t schedule_random(AbstractContext* ctx, int node)
+{
+    unsigned long tick;
+#pragma omp atomic capture
+    tick = ctx->schedule_ticks++;
+
+    return hash_int(hash_int(hash_int(HASH_SEED, ctx->schedule_seed), node), tick);
+}
+
+static size_t schedule_offset(AbstractContext* ctx, int node, size_t count)
+{
+    if (!ctx->schedule_seed || count < 2) {
+        return 0;
+    }
+
+    return schedule_random(ctx, node) % count;
+}
+
+static void schedule_jitter(AbstractContext* ctx, int node)
+{
+    if (!ctx->schedule_seed) {
+        return;
+    }
+
+    volatile unsigned spin = 0;
+    unsigned rounds = schedule_random(ctx, node) % 4096;
+    while (spin < rounds) {
+        spin++;
+    }
+}
+
+static void lock_node(AbstractContext* ctx, omp_lock_t* locks, int node)
+{
+    (void)ctx; // only read by the counters
+    STATS_START(timer);
+    omp_set_lock(&locks[node]);
+    STATS_STOP(ctx->stats, TIME_LOCK_WAIT, timer);
+}
+
+static AbstractResult abstract_result_new(int num_locals)
+{
+    Vector** results = malloc(sizeof(Vector*) * num_locals);
+    for (int i = 0; i < num_locals; i++) {
+        results[i] = vector_new(sizeof(Interval));
+    }
+
+    return (AbstractResult) { .results = results, .num_locals = num_locals };
+}
+
+// X_in holds the final loop head states of the dense analysis, NULL otherwise
+static void cache_result(AbstractContext* ctx, const AbstractResult* result, IntervalState** X_in)
+{
+    // a later run with more time left can do better
+    if (!ctx->method_id || result->degraded) {
+        return;
+    }
+
+    Vector* heads = vector_new(sizeof(CachedHead));
+    if (!heads) {
+        return;
+    }
+
+    for (size_t i = 0; X_in && i < vector_length(ctx->wpo.heads); i++) {
+        int node = *(int*)vector_get(ctx->wpo.heads, i);
+        CachedHead head = { .node = node, .state = X_in[node] };
+        vector_push(heads, &head);
+    }
+
+    result_cache_store(ctx->method_id, ctx->hash, ctx->shape, result, heads);
+    vector_delete(heads);
+}
+
+/*** SEQUENTIAL ENGINES ***/
+
+/*
+ * Weak topological ordering rebuilt from the WPO components: every component
+ * is its head, then its elements, nodes and nested components, in reverse
+ * postorder of the flow graph, then its exit. A nested component is entered
+ * only through its head, so sorting the elements by the position of their
+ * first node keeps every flow edge going forward.
+ */
+typedef struct {
+    Vector** elements; // Vector<int> per component, the top level last: node, or -(component + 1)
+    int* order; // flattened ordering, nodes and exits
+    int* position; // per node, index in order
+    int count;
+} Wto;
+
+static void rpo_visit(AbstractContext* ctx, int node, bool* visited, int* postorder, int* count)
+{
+    visited[node] = true;
+
+    if (node < ctx->block_count) {
+        Node* flow_node = vector_get(ctx->flow->nodes, node);
+        for (size_t i = 0; i < vector_length(flow_node->successors); i++) {
+            int successor = *(int*)vector_get(flow_node->successors, i);
+            if (!visited[successor]) {
+                rpo_visit(ctx, successor, visited, postorder, count);
+            }
+        }
+    }
+
+    postorder[(*count)++] = node;
+}
+
+static int component_parent(AbstractContext* ctx, int component_id)
+{
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    int parent = -1;
+    size_t parent_size = 0;
+
+    for (size_t c = 0; c < vector_length(ctx->wpo.Cx); c++) {
+        size_t size = vector_length(((C*)vector_get(ctx->wpo.Cx, c))->components);
+
+        if ((int)c != component_id && is_component_node(ctx, c, head) && (parent == -1 || size < parent_size)) {
+            parent = c;
+            parent_size = size;
+        }
+    }
+
+    return parent;
+}
+
+static int element_first_node(AbstractContext* ctx, int element)
+{
+    return element >= 0 ? element : *(int*)vector_get(ctx->wpo.heads, -element - 1);
+}
+
+static void wto_flatten(AbstractContext* ctx, Wto* wto, int component_id)
+{
+    int num_components = vector_length(ctx->wpo.Cx);
+    int level = component_id == -1 ? num_components : component_id;
+
+    if (component_id != -1) {
+        wto->order[wto->count++] = *(int*)vector_get(ctx->wpo.heads, component_id);
+    }
+
+    for (size_t i = 0; i < vector_length(wto->elements[level]); i++) {
+        int element = *(int*)vector_get(wto->elements[level], i);
+        if (element >= 0) {
+            wto->order[wto->count++] = element;
+        } else {
+            wto_flatten(ctx, wto, -element - 1);
+        }
+    }
+
+    if (component_id != -1) {
+        wto->order[wto->count++] = *(int*)vector_get(ctx->wpo.exits, component_id);
+    }
+}
+
+static void wto_delete(AbstractContext* ctx, Wto* wto)
+{
+    int num_components = vector_length(ctx->wpo.Cx);
+
+    for (int i = 0; wto->elements && i <= num_components; i++) {
+        vector_delete(wto->elements[i]);
+    }
+    free(wto->elements);
+    free(wto->order);
+    free(wto->position);
+}
+
+static int wto_build(AbstractContext* ctx, Wto* wto)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    int num_components = vector_length(ctx->wpo.Cx);
+    int result = FAILURE;
+
+    bool* visited = calloc(nodes_num, sizeof(bool));
+    int* postorder = malloc(sizeof(int) * nodes_num);
+    int* rpo = malloc(sizeof(int) * nodes_num);
+
+    *wto = (Wto) { 0 };
+    wto->elements = calloc(num_components + 1, sizeof(Vector*));
+    wto->order = malloc(sizeof(int) * nodes_num);
+    wto->position = malloc(sizeof(int) * nodes_num);
+
+    if (!visited || !postorder || !rpo || !wto->elements || !wto->order || !wto->position) {
+        goto cleanup;
+    }
+
+    int count = 0;
+    rpo_visit(ctx, 0, visited, postorder, &count);
+
+    // nodes out of reach of the entry go last, in id order
+    for (int i = 0; i < nodes_num; i++) {
+        rpo[i] = nodes_num + i;
+    }
+    for (int i = 0; i < count; i++) {
+        rpo[postorder[count - 1 - i]] = i;
+    }
+
+    for (int c = 0; c <= num_components; c++) {
+        wto->elements[c] = vector_new(sizeof(int));
+        if (!wto->elements[c]) {
+            goto cleanup;
+        }
+    }
+
+    for (int node = 0; node < nodes_num; node++) {
+        int component_id = ctx->wpo.node_to_component[node];
+        if (component_id != -1
+            && (node == *(int*)vector_get(ctx->wpo.heads, component_id)
+                || node == *(int*)vector_get(ctx->wpo.exits, component_id))) {
+            continue;
+        }
+
+        vector_push(wto->elements[component_id == -1 ? num_components : component_id], &node);
+    }
+
+    for (int c = 0; c < num_components; c++) {
+        int parent = component_parent(ctx, c);
+        int element = -c - 1;
+        vector_push(wto->elements[parent == -1 ? num_components : parent], &element);
+    }
+
+    // few elements per level, insertion sort by position of the first node
+    for (int c = 0; c <= num_components; c++) {
+        int length = vector_length(wto->elements[c]);
+        int* elements = length ? vector_get(wto->elements[c], 0) : NULL;
+
+        for (int i = 1; i < length; i++) {
+            int element = elements[i];
+            int j = i - 1;
+
+            while (j >= 0 && rpo[element_first_node(ctx, elements[j])] > rpo[element_first_node(ctx, element)]) {
+                elements[j + 1] = elements[j];
+                j--;
+            }
+            elements[j + 1] = element;
+        }
+    }
+
+    wto_flatten(ctx, wto, -1);
+    for (int i = 0; i < wto->count; i++) {
+        wto->position[wto->order[i]] = i;
+    }
+
+    result = SUCCESS;
+
+cleanup:
+    if (result) {
+        wto_delete(ctx, wto);
+    }
+
+    free(visited);
+    free(postorder);
+    free(rpo);
+
+    return result;
+}
+
+/*
+ * Worklist taking the lowest node of the flattened ordering first. Every
+ * component is contiguous in it, so a component is done with before anything
+ * after it runs again, as in the other engines, and a head is never reached
+ * by a new entry state in the middle of its iterations.
+ */
+static void push_node(const Wto* wto, bool* queued, int* lowest, int node)
+{
+    int position = wto->position[node];
+
+    queued[position] = true;
+    *lowest = MIN(*lowest, position);
+}
+
+/*** DENSE ***/
+
+static const char* engine_name(Engine engine)
+{
+    switch (engine) {
+    case ENGINE_RECURSIVE:
+        return "recursive";
+    case ENGINE_WORKLIST:
+        return "worklist";
+    case ENGINE_COMPARE:
+        return "compare";
+    default:
+        return "wpo";
+    }
+}
+
+// every engine starts from the state setup left
+static void reset_run(AbstractContext* ctx)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    int num_components = vector_length(ctx->wpo.Cx);
+
+    for (int i = 0; i < num_components; i++) {
+        ctx->phase[i] = PHASE_START;
+        ctx->loop_iteration[i] = 0;
+        ctx->narrowing_left[i] = 0;
+        ctx->checked_version[i] = 0;
+    }
+
+    for (int i = 0; i < nodes_num; i++) {
+        ctx->applied[i] = UINT_MAX;
+
+        for (size_t j = 0; j < vector_length(ctx->predecessors[i]); j++) {
+            FlowEdge* edge = vector_get(ctx->predecessors[i], j);
+            edge->seen = UINT_MAX;
+        }
+    }
+}
+
+static void delete_record(Vector* record)
+{
+    for (size_t i = 0; record && i < vector_length(record); i++) {
+        free(*(char**)vector_get(record, i));
+    }
+    vector_delete(record);
+}
+
+/*** INTERVAL PASSES ***/
+
+/*
+ * What the dense engine runs on the interval domain only, behind the hooks of
+ * its instance: the cache seeds and the acceleration of the loop heads while
+ * the fixpoint ascends, then the zones and the partitions refining it and the
+ * invariants recorded from the refined states.
+ */
+
+static IntervalArena* interval_thread_arena(AbstractContext* ctx)
+{
+    return (IntervalArena*)thread_arena(ctx);
+}
+
+static void load_seeds(AbstractContext* ctx)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    int seeded = 0;
+
+    ctx->seeds = calloc(nodes_num, sizeof(AbstractState*));
+    if (!ctx->seeds) {
+        return;
+    }
+
+    for (size_t i = 0; i < vector_length(ctx->wpo.heads); i++) {
+        int head = *(int*)vector_get(ctx->wpo.heads, i);
+        IntervalState* seed = interval_new_bottom_state(ctx->max_locals, ctx->max_stack);
+
+        if (seed && result_cache_seed(ctx->method_id, ctx->shape, head, seed) == SUCCESS) {
+            ctx->seeds[head] = (AbstractState*)seed;
+            seeded++;
+        } else {
+            interval_state_delete(seed);
+        }
+    }
+
+    if (seeded) {
+        LOG_INFO("Seeding %d loop heads of %s from the cached result", seeded, ctx->method_id);
+    }
+}
+
+/*
+ * The first round of a head starts from the entry state joined with the head
+ * state of a previous analysis. Any starting point above the entry state ends
+ * the ascending phase on a post fixpoint, so the result stays sound, and the
+ * descending phase takes back what the seed made too large.
+ */
+static void seed_in(int head, AbstractContext* ctx, IntervalState** X_in)
+{
+    if (!ctx->seeds || !ctx->seeds[head]) {
+        return;
+    }
+
+    int dummy = 0;
+    if (!is_interval_state_bottom(X_in[head])) {
+        interval_join(X_in[head], (IntervalState*)ctx->seeds[head], &dummy);
+    }
+
+    interval_state_delete((IntervalState*)ctx->seeds[head]);
+    ctx->seeds[head] = NULL;
+}
+
+/*
+ * Loop acceleration: the head is run once with every induction variable free
+ * in its direction of growth, and the guard closing the head gives the last
+ * value g that enters the body. The head then never sees the variable past
+ * g + step, and its interval is extended there at once instead of growing
+ * one iteration at a time. The ascending phase still checks the result.
+ * The bounds are computed from the head state from and added to state.
+ */
+static void accelerate_head(int head, AbstractContext* ctx, const IntervalState* from, IntervalState* state)
+{
+    int component_id = ctx->wpo.node_to_component[head];
+    Vector* inductions = ctx->inductions[component_id];
+
+    if (!vector_length(inductions) || is_interval_state_bottom(from)) {
+        return;
+    }
+
+    // the edge staying in the loop, the other one leaves it
+    Node* node = vector_get(ctx->flow->nodes, head);
+    if (vector_length(node->successors) != 2) {
+        return;
+    }
+
+    int inside_true = is_component_node(ctx, component_id, *(int*)vector_get(node->successors, 0));
+    int inside_false = is_component_node(ctx, component_id, *(int*)vector_get(node->successors, 1));
+    if (inside_true == inside_false) {
+        return;
+    }
+
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, head);
+    Vector* ir_instructions = block->ir_function->ir_instructions;
+    IntervalArena* arena = interval_thread_arena(ctx);
+    IntervalState* target = interval_arena_state(arena);
+    interval_state_copy(target, state);
+    if (interval_state_own(target)) {
+        return;
+    }
+
+    for (size_t i = 0; i < vector_length(inductions); i++) {
+        Induction* induction = vector_get(inductions, i);
+        Interval current = from->slots[induction->local];
+
+        IntervalState* probe = interval_arena_state(arena);
+        IntervalState* out_false = interval_arena_state(arena);
+        interval_state_copy(probe, from);
+        if (interval_state_own(probe)) {
+            return;
+        }
+
+        probe->slots[induction->local] = induction->step > 0
+            ? (Interval) { current.lower, INT_MAX }
+            : (Interval) { INT_MIN, current.upper };
+        probe->congruence[induction->local] = CONGRUENCE_TOP;
+
+        for (int ip = block->ip_start; ip < block->ip_end; ip++) {
+            interval_transfer(probe, *(IrInstruction**)vector_get(ir_instructions, ip));
+        }
+
+        interval_state_copy(out_false, probe);
+        interval_transfer_conditional(probe, out_false, *(IrInstruction**)vector_get(ir_instructions, block->ip_end));
+
+        IntervalState* body = inside_true ? probe : out_false;
+        Interval entering = body->slots[induction->local];
+        if (is_interval_state_bottom(body) || is_interval_bottom(entering)) {
+            continue;
+        }
+
+        long last = induction->step > 0 ? (long)entering.upper + induction->step : (long)entering.lower + induction->step;
+        if (last > INT_MAX || last < INT_MIN
+            || (induction->step > 0 && entering.upper == INT_MAX)
+            || (induction->step < 0 && entering.lower == INT_MIN)) {
+            continue;
+        }
+
+        Interval* slot = &target->slots[induction->local];
+        Interval point = { (int)last, (int)last };
+
+        target->congruence[induction->local] = congruence_join(*slot, target->congruence[induction->local], point, CONGRUENCE_TOP);
+        *slot = interval_join_single(*slot, point);
+    }
+
+    int dummy = 0;
+    interval_join(state, target, &dummy);
+}
+
+/*** ZONES ***/
+
+/*
+ * Relational refinement of the loops. Once the intervals are stable, every
+ * outermost loop of a single function is run again with zones over the locals
+ * its code relates, in lockstep with the interval states: the intervals bound
+ * what the zones do not track, the zones give back the bounds of their locals
+ * and of the differences on the stack. A loop guard i < n then bounds n - i,
+ * which no interval of i or n does. X_in and X_out of the loop blocks keep
+ * the reduced states, the blocks after the loop keep theirs.
+ */
+
+#define ZONE_ROUNDS 64 // ascending rounds of a loop before its zones are given up
+#define ZONE_WIDENING_DELAY 2
+
+// ir takes state and zs past it, then each gives the other what it knows
+static void zone_step(ZoneState* zs, IntervalState* state, IrInstruction* ir, IntervalState* before, IntervalState* scratch)
+{
+    interval_state_copy(before, state);
+    interval_transfer(state, ir);
+    zone_state_transfer(zs, before, state, ir);
+    zone_state_reduce(zs, state, scratch);
+}
+
+/*
+ * Runs node from state and zs, its input, as apply_f does. zs_edge receives
+ * the zones on the edges out of node, edge the interval states when it is not
+ * NULL, and state is left as X_out.
+ */
+static void zone_replay(AbstractContext* ctx, int node, ZoneState* zs, IntervalState* state, ZoneState** zs_edge, IntervalState** edge)
+{
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+    Vector* ir_instructions = block->ir_function->ir_instructions;
+    IrInstruction* last = *(IrInstruction**)vector_get(ir_instructions, block->ip_end);
+
+    IntervalArena* arena = interval_thread_arena(ctx);
+    IntervalState* before = interval_arena_state(arena);
+    IntervalState* scratch = interval_arena_state(arena);
+
+    zone_state_reduce(zs, state, scratch);
+
+    for (int ip = block->ip_start; ip < block->ip_end; ip++) {
+        zone_step(zs, state, *(IrInstruction**)vector_get(ir_instructions, ip), before, scratch);
+    }
+
+    if (ir_instruction_is_conditional(last)) {
+        IntervalState* out_true = interval_arena_state(arena);
+        IntervalState* out_false = interval_arena_state(arena);
+
+        interval_state_copy(out_true, state);
+        interval_state_copy(out_false, state);
+        interval_transfer_conditional(out_true, out_false, last);
+
+        zone_state_copy(zs_edge[0], zs);
+        zone_state_copy(zs_edge[1], zs);
+        zone_state_branch(zs_edge[0], zs_edge[1], last);
+        zone_state_reduce(zs_edge[0], out_true, scratch);
+        zone_state_reduce(zs_edge[1], out_false, scratch);
+
+        if (edge) {
+            interval_state_copy(edge[0], out_true);
+            interval_state_copy(edge[1], out_false);
+        }
+        return;
+    }
+
+    if (last->opcode == OP_RETURN) {
+        interval_state_copy(before, state);
+        interval_transfer_return(state);
+        zone_state_transfer(zs, before, state, last);
+        zone_state_reduce(zs, state, scratch);
+    } else {
+        zone_step(zs, state, last, before, scratch);
+    }
+
+    zone_state_copy(zs_edge[0], zs);
+    zone_state_set_bottom(zs_edge[1]);
+
+    if (edge) {
+        interval_state_copy(edge[0], state);
+    }
+}
+
+/*
+ * Joins the zones entering node: from the loop blocks their zones, from the
+ * blocks before the loop their interval states. A head also takes the back
+ * edges, which enter the exit of its component.
+ */
+static void zone_pull(AbstractContext* ctx, int node, ZoneState* joined, ZoneState* scratch, ZoneState** Z_edge, IntervalState** X_in, IntervalState** X_edge)
+{
+    int targets[2] = { node, -1 };
+    int dummy = 0;
+
+    if (is_component_head(ctx, node)) {
+        targets[1] = *(int*)vector_get(ctx->wpo.exits, ctx->wpo.node_to_component[node]);
+    }
+
+    if (node == 0) {
+        zone_state_from_intervals(joined, X_in[0]);
+    } else {
+        zone_state_set_bottom(joined);
+    }
+
+    for (int t = 0; t < 2 && targets[t] != -1; t++) {
+        Vector* predecessors = ctx->predecessors[targets[t]];
+
+        for (size_t i = 0; i < vector_length(predecessors); i++) {
+            FlowEdge* edge = vector_get(predecessors, i);
+            ZoneState* from = Z_edge[2 * edge->source + edge->index];
+
+            if (!from) {
+                zone_state_from_intervals(scratch, X_edge[2 * edge->source + edge->index]);
+                from = scratch;
+            }
+
+            zone_state_join(joined, from, &dummy);
+        }
+    }
+
+    zone_state_meet_intervals(joined, X_in[node]);
+}
+
+/*
+ * Blocks of a loop in the weak topological order, NULL if the zones cannot
+ * follow it: its blocks must belong to one function and call none, since an
+ * inlined callee runs on a frame of its own.
+ */
+static Vector* zone_loop_blocks(AbstractContext* ctx, int component_id, const Wto* wto)
+{
+    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    BasicBlock* head_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, head);
+
+    Vector* blocks = vector_new(sizeof(int));
+    if (!blocks) {
+        return NULL;
+    }
+
+    for (int i = 0; i < wto->count; i++) {
+        int node = wto->order[i];
+        if (node >= ctx->block_count || !is_component_node(ctx, component_id, node)) {
+            continue;
+        }
+
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+        IrInstruction* last = *(IrInstruction**)vector_get(block->ir_function->ir_instructions, block->ip_end);
+
+        if (block->ir_function != head_block->ir_function || last->opcode == OP_INVOKE) {
+            vector_delete(blocks);
+            return NULL;
+        }
+
+        vector_push(blocks, &node);
+    }
+
+    return blocks;
+}
+
+static ZonePacking* zone_loop_packing(AbstractContext* ctx, Vector* blocks)
+{
+    BasicBlock* head_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, *(int*)vector_get(blocks, 0));
+
+    ZonePacking* packing = zone_packing_new(MAX(head_block->num_locals, head_block->ir_function->max_locals));
+    if (!packing) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < vector_length(blocks); i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, *(int*)vector_get(blocks, i));
+        zone_packing_scan(packing, block->ir_function, block->ip_start, block->ip_end);
+    }
+
+    if (!zone_packing_seal(packing)) {
+        zone_packing_delete(packing);
+        return NULL;
+    }
+
+    return packing;
+}
+
+/*
+ * One pass over the loop blocks: each takes the zones entering it, joined to
+ * the ones it had while ascending (widened at the heads after a few rounds),
+ * replacing them when descending. Returns whether an input zone changed.
+ */
+static int zone_pass(AbstractContext* ctx, Vector* blocks, int round, bool descending, ZoneState** work, ZoneState** Z_in, ZoneState** Z_edge, IntervalState** X_in, IntervalState** X_edge)
+{
+    IntervalArena* arena = interval_thread_arena(ctx);
+    int changed = 0;
+
+    for (size_t i = 0; i < vector_length(blocks); i++) {
+        int node = *(int*)vector_get(blocks, i);
+
+        zone_pull(ctx, node, work[0], work[1], Z_edge, X_in, X_edge);
+
+        if (descending) {
+            zone_state_copy(Z_in[node], work[0]);
+        } else if (is_component_head(ctx, node) && round >= ZONE_WIDENING_DELAY) {
+            zone_state_widen(Z_in[node], work[0], &changed);
+        } else {
+            zone_state_join(Z_in[node], work[0], &changed);
+        }
+
+        IntervalState* state = interval_arena_state(arena);
+        interval_state_copy(state, X_in[node]);
+        zone_state_copy(work[0], Z_in[node]);
+
+        zone_replay(ctx, node, work[0], state, &Z_edge[2 * node], NULL);
+        interval_arena_reset(arena);
+    }
+
+    return changed;
+}
+
+/*
+ * Refines the states of one outermost loop, Z_in keeps the zones before each
+ * of its blocks for record_invariants. Nothing changes when the zones do not
+ * stabilize within ZONE_ROUNDS.
+ */
+static void zone_refine_loop(AbstractContext* ctx, Vector* blocks, ZonePacking* packing, ZoneState** Z_in, IntervalState** X_in, IntervalState** X_out, IntervalState** X_edge)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    ZoneState** Z_edge = calloc(2 * nodes_num, sizeof(ZoneState*));
+    ZoneState* work[2] = { zone_state_new(packing, ctx->max_stack), zone_state_new(packing, ctx->max_stack) };
+    bool ready = Z_edge && work[0] && work[1];
+
+    for (size_t i = 0; ready && i < vector_length(blocks); i++) {
+        int node = *(int*)vector_get(blocks, i);
+
+        Z_in[node] = zone_state_new(packing, ctx->max_stack);
+        Z_edge[2 * node] = zone_state_new(packing, ctx->max_stack);
+        Z_edge[2 * node + 1] = zone_state_new(packing, ctx->max_stack);
+        ready = Z_in[node] && Z_edge[2 * node] && Z_edge[2 * node + 1];
+    }
+
+    int round = 0;
+    while (ready && round < ZONE_ROUNDS && zone_pass(ctx, blocks, round, false, work, Z_in, Z_edge, X_in, X_edge)) {
+        round++;
+    }
+
+    if (!ready || round == ZONE_ROUNDS) {
+        LOG_DEBUG("Zones of the loop at %d given up", *(int*)vector_get(blocks, 0));
+        for (size_t i = 0; i < vector_length(blocks); i++) {
+            int node = *(int*)vector_get(blocks, i);
+            zone_state_delete(Z_in[node]);
+            Z_in[node] = NULL;
+        }
+        goto cleanup;
+    }
+
+    zone_pass(ctx, blocks, round, true, work, Z_in, Z_edge, X_in, X_edge);
+
+    IntervalArena* arena = interval_thread_arena(ctx);
+    for (size_t i = 0; i < vector_length(blocks); i++) {
+        int node = *(int*)vector_get(blocks, i);
+        IntervalState* scratch = interval_arena_state(arena);
+
+        zone_state_copy(work[0], Z_in[node]);
+        zone_state_reduce(work[0], X_in[node], scratch);
+
+        IntervalState* state = interval_arena_state(arena);
+        interval_state_copy(state, X_in[node]);
+        zone_replay(ctx, node, work[0], state, &Z_edge[2 * node], &X_edge[2 * node]);
+        interval_state_copy(X_out[node], state);
+
+        interval_arena_reset(arena);
+    }
+
+cleanup:
+    for (int i = 0; Z_edge && i < 2 * nodes_num; i++) {
+        zone_state_delete(Z_edge[i]);
+    }
+    free(Z_edge);
+    zone_state_delete(work[0]);
+    zone_state_delete(work[1]);
+}
+
+/*
+ * Runs the zones on every outermost loop, packings receives the ones Z_in
+ * refers to.
+ */
+static void zone_refine(AbstractContext* ctx, ZoneState** Z_in, Vector* packings, IntervalState** X_in, IntervalState** X_out, IntervalState** X_edge)
+{
+    Wto wto = { 0 };
+    if (wto_build(ctx, &wto) != SUCCESS) {
+        LOG_ERROR("While building the weak topological ordering of the zones");
+        return;
+    }
+
+    for (size_t c = 0; c < vector_length(ctx->wpo.Cx); c++) {
+        if (component_parent(ctx, c) != -1) {
+            continue;
+        }
+
+        Vector* blocks = zone_loop_blocks(ctx, c, &wto);
+        ZonePacking* packing = blocks ? zone_loop_packing(ctx, blocks) : NULL;
+
+        if (packing) {
+            vector_push(packings, &packing);
+            zone_refine_loop(ctx, blocks, packing, Z_in, X_in, X_out, X_edge);
+        }
+
+        vector_delete(blocks);
+    }
+
+    wto_delete(ctx, &wto);
+}
+
+/*** PARTITIONS ***/
+
+/*
+ * Trace partitioning. Once the intervals are stable, the blocks are run again
+ * in the weak topological order with up to ctx->partitions states each, told
+ * apart by the outcomes of the last ctx->partition_depth branches taken to
+ * reach them. A join at a merge point then no longer mixes the paths through
+ * if (flag) x = 1 and the one around it, and a later branch on flag drops the
+ * partition that cannot take it. Every partition is met with X_in of its
+ * block, and X_in, X_out and the edge states receive the join of the
+ * partitions, so the result is never less precise than the fixpoint. Heads
+ * restart from their single fixpoint state, which keeps back edges out of the
+ * pass. When a block gets more partitions than allowed, the ones that only
+ * differ in their oldest outcomes are merged first.
+ */
+
+typedef struct {
+    unsigned history; // outcome of the last branches, the latest in bit 0, 1 when the target was taken
+    IntervalState* state;
+} Partition;
+
+static void partitions_delete(Vector* partitions)
+{
+    for (size_t i = 0; partitions && i < vector_length(partitions); i++) {
+        interval_state_delete(((Partition*)vector_get(partitions, i))->state);
+    }
+    vector_delete(partitions);
+}
+
+// state is joined to the partition of the same history, or starts a new one
+static int partition_add(Vector* partitions, unsigned history, const IntervalState* state)
+{
+    int dummy = 0;
+
+    if (is_interval_state_bottom(state)) {
+        return SUCCESS;
+    }
+
+    for (size_t i = 0; i < vector_length(partitions); i++) {
+        Partition* partition = vector_get(partitions, i);
+        if (partition->history == history) {
+            return interval_join(partition->state, state, &dummy);
+        }
+    }
+
+    Partition partition = { history, interval_new_bottom_state(state->max_locals, state->max_stack) };
+    if (!partition.state) {
+        return FAILURE;
+    }
+
+    if (interval_state_copy(partition.state, state) || vector_push(partitions, &partition)) {
+        interval_state_delete(partition.state);
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+// forgets the oldest outcomes until at most limit partitions are left
+static int partition_bound(Vector** partitions, int limit, int depth)
+{
+    while ((int)vector_length(*partitions) > limit && depth > 0) {
+        depth--;
+
+        Vector* merged = vector_new(sizeof(Partition));
+        if (!merged) {
+            return FAILURE;
+        }
+
+        for (size_t i = 0; i < vector_length(*partitions); i++) {
+            Partition* partition = vector_get(*partitions, i);
+            if (partition_add(merged, partition->history & ((1u << depth) - 1), partition->state)) {
+                partitions_delete(merged);
+                return FAILURE;
+            }
+        }
+
+        partitions_delete(*partitions);
+        *partitions = merged;
+    }
+
+    return SUCCESS;
+}
+
+/*
+ * Runs node from state as apply_f does: edge receives the states on the edges
+ * out of node and state is left as X_out.
+ */
+static void partition_replay(AbstractContext* ctx, int node, IntervalState* state, IntervalState** edge)
+{
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+    Vector* ir_instructions = block->ir_function->ir_instructions;
+    IrInstruction* last = *(IrInstruction**)vector_get(ir_instructions, block->ip_end);
+
+    for (int ip = block->ip_start; ip < block->ip_end; ip++) {
+        interval_transfer(state, *(IrInstruction**)vector_get(ir_instructions, ip));
+    }
+
+    interval_state_set_bottom(edge[1]);
+
+    if (ir_instruction_is_conditional(last)) {
+        interval_state_copy(edge[0], state);
+        interval_state_copy(edge[1], state);
+        interval_transfer_conditional(edge[0], edge[1], last);
+        return;
+    }
+
+    if (last->opcode == OP_INVOKE) {
+        Node* flow_node = vector_get(ctx->flow->nodes, node);
+        interval_transfer_invoke(edge[0], state, block_num_locals(ctx, *(int*)vector_get(flow_node->successors, 0)));
+        return;
+    }
+
+    if (last->opcode == OP_RETURN) {
+        interval_transfer_return(state);
+    } else {
+        interval_transfer(state, last);
+    }
+
+    interval_state_copy(edge[0], state);
+}
+
+/*
+ * Partitions of node from the ones on its incoming edges, each run through the
+ * block onto its outgoing edges. P_in[node] keeps them for record_invariants.
+ */
+static int partition_node(AbstractContext* ctx, int node, Vector** P_in, Vector** P_edge, IntervalState** X_in, IntervalState** X_out, IntervalState** X_edge)
+{
+    IntervalArena* arena = interval_thread_arena(ctx);
+    IntervalState* state = interval_arena_state(arena);
+    IntervalState* edge[2] = { interval_arena_state(arena), interval_arena_state(arena) };
+    IntervalState* joined[4] = { NULL };
+    unsigned mask = (1u << ctx->partition_depth) - 1;
+    int dummy = 0;
+
+    Vector* predecessors = ctx->predecessors[node];
+    bool restart = node == 0 || is_component_head(ctx, node);
+
+    if (restart && partition_add(P_in[node], 0, X_in[node])) {
+        return FAILURE;
+    }
+
+    for (size_t i = 0; i < vector_length(predecessors) && !restart; i++) {
+        FlowEdge* flow_edge = vector_get(predecessors, i);
+        Vector* from = P_edge[2 * flow_edge->source + flow_edge->index];
+
+        for (size_t j = 0; from && j < vector_length(from); j++) {
+            Partition* partition = vector_get(from, j);
+
+            interval_state_copy(state, partition->state);
+            interval_intersection(state, X_in[node], &dummy);
+            if (partition_add(P_in[node], partition->history, state)) {
+                return FAILURE;
+            }
+        }
+    }
+
+    if (partition_bound(&P_in[node], ctx->partitions, ctx->partition_depth)) {
+        return FAILURE;
+    }
+
+    // X_in, X_out and both edges, joined over the partitions
+    for (int i = 0; i < 4; i++) {
+        joined[i] = interval_arena_state(arena);
+        interval_state_set_bottom(joined[i]);
+    }
+
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+    IrInstruction* last = *(IrInstruction**)vector_get(block->ir_function->ir_instructions, block->ip_end);
+    bool conditional = ir_instruction_is_conditional(last);
+
+    for (size_t i = 0; i < vector_length(P_in[node]); i++) {
+        Partition* partition = vector_get(P_in[node], i);
+
+        interval_state_copy(state, partition->state);
+        interval_join(joined[0], state, &dummy);
+        partition_replay(ctx, node, state, edge);
+        interval_join(joined[1], state, &dummy);
+
+        for (int e = 0; e < 2; e++) {
+            unsigned history = conditional ? ((partition->history << 1) | (e == 0)) & mask : partition->history;
+
+            interval_join(joined[2 + e], edge[e], &dummy);
+            if (partition_add(P_edge[2 * node + e], history, edge[e])) {
+                return FAILURE;
+            }
+        }
+    }
+
+    interval_state_copy(X_in[node], joined[0]);
+    interval_state_copy(X_out[node], joined[1]);
+    interval_state_copy(X_edge[2 * node], joined[2]);
+    interval_state_copy(X_edge[2 * node + 1], joined[3]);
+
+    return SUCCESS;
+}
+
+/*
+ * Runs the partitioned pass over every block, P_in receives the partitions
+ * before each of them. When it fails P_in is left empty, the blocks already
+ * run keep their refined states.
+ */
+static int partition_refine(AbstractContext* ctx, Vector** P_in, IntervalState** X_in, IntervalState** X_out, IntervalState** X_edge)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+    int status = FAILURE;
+    Wto wto = { 0 };
+
+    Vector** P_edge = calloc(2 * nodes_num, sizeof(Vector*));
+    if (!P_edge || wto_build(ctx, &wto) != SUCCESS) {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < ctx->block_count; i++) {
+        P_in[i] = vector_new(sizeof(Partition));
+        P_edge[2 * i] = vector_new(sizeof(Partition));
+        P_edge[2 * i + 1] = vector_new(sizeof(Partition));
+
+        if (!P_in[i] || !P_edge[2 * i] || !P_edge[2 * i + 1]) {
+            goto cleanup;
+        }
+    }
+
+    // a block comes after every block with an edge into it, back edges aside
+    for (int i = 0; i < wto.count; i++) {
+        int node = wto.order[i];
+        if (node >= ctx->block_count) {
+            continue;
+        }
+
+        int failed = partition_node(ctx, node, P_in, P_edge, X_in, X_out, X_edge);
+        interval_arena_reset(interval_thread_arena(ctx));
 
-#define MAXIMUM_LOOP_ITERATION 50
+        if (failed) {
+            goto cleanup;
+        }
+    }
 
-struct AbstractContext {
-    Cfg* cfg;
-    WPO wpo;
-    int block_count;
-    int exit_count;
-    int* loop_iteration;
-};
+    status = SUCCESS;
 
-AbstractContext* interpreter_abstract_setup(const Method* m, const Options* opts, const Config* cfg)
-{
-    if (!m || !opts || !cfg) {
-        goto cleanup;
+cleanup:
+    if (status != SUCCESS) {
+        LOG_ERROR("While partitioning the states");
+
+        for (int i = 0; i < ctx->block_count; i++) {
+            partitions_delete(P_in[i]);
+            P_in[i] = NULL;
+        }
     }
 
-    IrFunction* ir_function = ir_program_get_function_ir(m, cfg);
-    if (!ir_function) {
-        goto cleanup;
+    for (int i = 0; P_edge && i < 2 * nodes_num; i++) {
+        partitions_delete(P_edge[i]);
     }
+    free(P_edge);
+    wto_delete(ctx, &wto);
 
-    Cfg* control_flow_graph = ir_program_get_cfg(m, cfg);
+    return status;
+}
 
-#ifdef DEBUG
-    LOG_DEBUG("BEFORE");
-    cfg_print(control_flow_graph);
-#endif
+/*** INVARIANTS ***/
 
-    cfg_inline(control_flow_graph, (Config*)cfg, (Method*)m);
+/*
+ * Replays node from start and keeps the state before each instruction, with
+ * the zones of node when the zones refined it.
+ */
+static int record_block(AbstractContext* ctx, InvariantStore* store, int node, const IntervalState* start, ZoneState** Z_in)
+{
+    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, node);
+    Vector* ir_instructions = block->ir_function->ir_instructions;
 
-#ifdef DEBUG
-    LOG_DEBUG("AFTER");
-    cfg_print(control_flow_graph);
-#endif
+    IntervalArena* arena = interval_thread_arena(ctx);
+    IntervalState* state = interval_arena_state(arena);
+    IntervalState* before = interval_arena_state(arena);
+    IntervalState* scratch = interval_arena_state(arena);
+    int status = SUCCESS;
 
-#ifdef DEBUG
-    cfg_print(control_flow_graph);
-#endif
-    if (!control_flow_graph) {
-        goto cleanup;
-    }
+    interval_state_copy(state, start);
 
-    Graph* graph = graph_from_cfg(control_flow_graph);
-    if (!graph) {
-        goto cleanup;
+    ZoneState* zs = Z_in && Z_in[node] ? zone_state_clone(Z_in[node]) : NULL;
+    if (zs) {
+        zone_state_reduce(zs, state, scratch);
     }
 
-    WPO wpo;
-    // Graph* test = graph_create_test_8_nodes();
-    // if (wpo_construct_aux(test, &wpo)) {
-    if (wpo_construct_aux(graph, &wpo)) {
-        goto cleanup;
+    for (int ip = block->ip_start; ip <= block->ip_end; ip++) {
+        status = invariant_store_add(store, block->ir_function, ip, block->num_locals, state);
+        if (status || ip == block->ip_end) {
+            break;
+        }
+
+        IrInstruction* ir = *(IrInstruction**)vector_get(ir_instructions, ip);
+        if (zs) {
+            zone_step(zs, state, ir, before, scratch);
+        } else {
+            interval_transfer(state, ir);
+        }
     }
 
-    AbstractContext* ctx = malloc(sizeof(AbstractContext));
-    if (!ctx) {
-        goto cleanup;
+    zone_state_delete(zs);
+    interval_arena_reset(arena);
+
+    return status;
+}
+
+/*
+ * Replays every block from its final input state, or from each of its
+ * partitions when the states were partitioned, and keeps the state before
+ * each instruction, under the function the block belongs to. Z_in is NULL
+ * when the zones refined no block, P_in when the states were not partitioned.
+ */
+static InvariantStore* record_invariants(AbstractContext* ctx, IntervalState** X_in, ZoneState** Z_in, Vector** P_in)
+{
+    InvariantStore* store = invariant_store_new();
+    if (!store) {
+        return NULL;
     }
 
-    ctx->block_count = vector_length(control_flow_graph->blocks);
-    ctx->exit_count = vector_length(wpo.wpo->nodes) - ctx->block_count;
-    ctx->wpo = wpo;
-    ctx->cfg = control_flow_graph;
-    ctx->loop_iteration = calloc(vector_length(ctx->wpo.Cx), sizeof(int));
+    for (int node = 0; node < ctx->block_count; node++) {
+        Vector* partitions = P_in ? P_in[node] : NULL;
 
-#ifdef DEBUG
-    graph_print(wpo.wpo);
+        if (!partitions) {
+            if (record_block(ctx, store, node, X_in[node], Z_in)) {
+                goto error;
+            }
+            continue;
+        }
 
-    for (size_t i = 0; i < vector_length(ctx->wpo.Cx); i++) {
-        LOG_DEBUG("COMPONENT %d, WITH HEAD: %d", i, *(int*)vector_get(ctx->wpo.heads, i));
-        C* component = vector_get(ctx->wpo.Cx, i);
-        for (size_t j = 0; j < vector_length(component->components); j++) {
-            LOG_DEBUG("%d", *(int*)vector_get(component->components, j));
+        for (size_t i = 0; i < vector_length(partitions); i++) {
+            if (record_block(ctx, store, node, ((Partition*)vector_get(partitions, i))->state, Z_in)) {
+                goto error;
+            }
         }
     }
+
+    if (invariant_store_seal(store)) {
+        goto error;
+    }
+
+#ifdef DEBUG
+    invariant_store_print(store);
 #endif
 
-cleanup:
-    graph_delete(graph);
-    // LOG_ERROR("TODO cleanup in interpreter abstract setup");
-    return ctx;
+    return store;
+
+error:
+    LOG_ERROR("While recording the invariants");
+    invariant_store_delete(store);
+    return NULL;
 }
 
-static void set_n_for_component(int* N, int exit_node, AbstractContext* ctx, Vector* worklist)
+/*** INSTANCES ***/
+
+/*
+ * What the passes keep of one run of the dense engine, until the result is
+ * built from it.
+ */
+typedef struct {
+    ZoneState** Z_in; // per node, set in the loops the zones refined
+    Vector** P_in; // Vector<Partition> per block, set when partitioning
+    Vector* packings; // Vector<ZonePacking*>, the ones Z_in refers to
+} IntervalPasses;
+
+static int interval_passes_new(AbstractContext* ctx, IntervalPasses* passes)
 {
-    int component_id = ctx->wpo.node_to_component[exit_node];
-    C* component = vector_get(ctx->wpo.Cx, component_id);
-    Vector* component_nodes = component->components;
+    int nodes_num = ctx->block_count + ctx->exit_count;
 
-    for (size_t i = 0; i < vector_length(component_nodes); i++) {
-        int node = *(int*)vector_get(component_nodes, i);
-        N[node] = ctx->wpo.num_outer_sched_pred[component_id][node];
+    passes->Z_in = calloc(nodes_num, sizeof(ZoneState*));
+    passes->P_in = calloc(nodes_num, sizeof(Vector*));
+    passes->packings = vector_new(sizeof(ZonePacking*));
 
-        if (ctx->wpo.num_sched_pred[node] == N[node]) {
-            vector_push(worklist, &node);
-        }
+    if (!passes->Z_in || !passes->P_in || !passes->packings) {
+        return FAILURE;
     }
+
+    return SUCCESS;
 }
 
-void apply_last(IrInstruction* last,
-    BasicBlock* block,
-    IntervalState** X_in,
-    IntervalState** X_out,
-    IntervalState* out,
-    int current_node,
-    int component,
-    AbstractContext* ctx,
-    int head,
-    omp_lock_t* locks)
+// runs on the stable states, X_in, X_out and the edge states receive the refined ones
+static void interval_passes_refine(AbstractContext* ctx, IntervalPasses* passes, IntervalState** X_in, IntervalState** X_out, IntervalState** X_edge)
 {
-    int dummy = 0;
+    if (ctx->zones) {
+        zone_refine(ctx, passes->Z_in, passes->packings, X_in, X_out, X_edge);
+    }
 
-    if (ir_instruction_is_conditional(last)) {
-        IntervalState* out_true = interval_new_top_state(block->num_locals);
-        IntervalState* out_false = interval_new_top_state(block->num_locals);
+    if (ctx->partitions > 1) {
+        partition_refine(ctx, passes->P_in, X_in, X_out, X_edge);
+    }
+}
 
-        interval_state_copy(out_true, out);
-        interval_state_copy(out_false, out);
+static InvariantStore* interval_passes_record(AbstractContext* ctx, IntervalPasses* passes, IntervalState** X_in)
+{
+    return record_invariants(ctx, X_in, passes->Z_in, passes->P_in);
+}
 
-        interval_transfer_conditional(out_true, out_false, last);
+static void interval_passes_delete(AbstractContext* ctx, IntervalPasses* passes)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
+
+    for (int i = 0; passes->Z_in && i < nodes_num; i++) {
+        zone_state_delete(passes->Z_in[i]);
+    }
+    free(passes->Z_in);
 
-        Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
+    for (int i = 0; passes->P_in && i < nodes_num; i++) {
+        partitions_delete(passes->P_in[i]);
+    }
+    free(passes->P_in);
 
-        int* successor_true;
-        int* successor_false;
+    for (size_t i = 0; passes->packings && i < vector_length(passes->packings); i++) {
+        zone_packing_delete(*(ZonePacking**)vector_get(passes->packings, i));
+    }
+    vector_delete(passes->packings);
+}
 
-        if (head) {
-            int* exit_id = vector_get(ctx->wpo.exits, component);
-            Node* exit_node = vector_get(ctx->wpo.wpo->nodes, *exit_id);
+// hooks of the interval instance, see engine_dense.h
+#define DOMAIN_interval_passes 1
+#define DOMAIN_interval_load_seeds load_seeds
+#define DOMAIN_interval_seed seed_in
+#define DOMAIN_interval_accelerate accelerate_head
+#define DOMAIN_interval_cache cache_result
+#define DOMAIN_interval_Passes IntervalPasses
+#define DOMAIN_interval_passes_new interval_passes_new
+#define DOMAIN_interval_passes_refine interval_passes_refine
+#define DOMAIN_interval_passes_record interval_passes_record
+#define DOMAIN_interval_passes_delete interval_passes_delete
+
+#define ENGINE_DOMAIN interval
+#include "engine_dense.h"
+#undef ENGINE_DOMAIN
+
+#define ENGINE_DOMAIN constant
+#include "engine_dense.h"
+#undef ENGINE_DOMAIN
+
+/*** SPARSE ***/
+
+// phi evaluations after which a phi outside the loop heads is widened as well
+#define SPARSE_WIDENING_LIMIT 64
+
+/*
+ * Sparse conditional analysis over the SSA form: every value keeps a single
+ * interval and congruence, reduced with each other like the slots of the
+ * dense states, and is recomputed only when a value it reads changes. Blocks
+ * and branch edges become executable as the intervals of the branches allow,
+ * values of blocks never reached stay bottom.
+ */
+typedef struct {
+    AbstractContext* ctx;
+    SsaForm* ssa;
+    Interval* value; // per ssa value
+    Congruence* congruence; // per ssa value
+    int* evaluations; // per ssa value, updates of a phi
+    bool* executable; // per block
+    bool* feasible; // per block, one flag per outgoing edge
+    bool* queued; // per ssa value
+    Vector* worklist; // Vector<int>, first in first out
+    size_t next;
+} SparseSolver;
+
+static void sparse_push(SparseSolver* solver, int value)
+{
+    if (!solver->queued[value]) {
+        solver->queued[value] = true;
+        vector_push(solver->worklist, &value);
+    }
+}
 
-            successor_true = vector_get(exit_node->successors, 0);
-            successor_false = vector_get(node->successors, 0);
-        } else {
-            successor_true = vector_get(node->successors, 0);
-            successor_false = vector_get(node->successors, 1);
-        }
+static int sparse_pop(SparseSolver* solver, int* value)
+{
+    if (solver->next == vector_length(solver->worklist)) {
+        vector_clear(solver->worklist);
+        solver->next = 0;
+        return FAILURE;
+    }
+
+    *value = *(int*)vector_get(solver->worklist, solver->next++);
+    solver->queued[*value] = false;
+
+    return SUCCESS;
+}
 
-        if (successor_true) {
-            omp_set_lock(&locks[*successor_true]);
-            interval_join(X_in[*successor_true], out_true, &dummy);
-            omp_unset_lock(&locks[*successor_true]);
+static Interval sparse_eval(SparseSolver* solver, int expr, Congruence* c)
+{
+    SsaExpr* e = ssa_expr(solver->ssa, expr);
+
+    *c = CONGRUENCE_TOP;
+
+    switch (e->kind) {
+    case EXPR_RANGE:
+        return (Interval) { .lower = e->lower, .upper = e->upper };
+    case EXPR_VALUE:
+        *c = solver->congruence[e->value];
+        return solver->value[e->value];
+    case EXPR_BINARY: {
+        Congruence cl, cr;
+        Interval left = sparse_eval(solver, e->left, &cl);
+        Interval right = sparse_eval(solver, e->right, &cr);
+        Interval result;
+
+        if (is_interval_bottom(left) || is_interval_bottom(right)) {
+            return interval_bottom();
         }
 
-        if (successor_false) {
-            omp_set_lock(&locks[*successor_false]);
-            interval_join(X_in[*successor_false], out_false, &dummy);
-            omp_unset_lock(&locks[*successor_false]);
+        if (interval_binary(e->op, left, right, &result)) {
+            return interval_top();
         }
 
-        interval_state_delete(out_true);
-        interval_state_delete(out_false);
-    } else if (last->opcode == OP_INVOKE) {
-        IntervalState* state = interval_new_top_state(0);
-        Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
-        int invoke_head = *(int*)vector_get(node->successors, 0);
+        *c = congruence_binary(e->op, left, cl, right, cr);
+        return congruence_reduce(result, *c);
+    }
+    case EXPR_NEGATE: {
+        Congruence operand_c;
+        Interval operand = sparse_eval(solver, e->left, &operand_c);
+
+        if (is_interval_bottom(operand)) {
+            return operand;
+        }
 
-        BasicBlock* successor = *(BasicBlock**)vector_get(ctx->cfg->blocks, invoke_head);
+        *c = congruence_negate(operand, operand_c);
+        return congruence_reduce(interval_negate(operand), *c);
+    }
+    }
 
-        interval_transfer_invoke(state, X_out[current_node], successor->num_locals);
+    return interval_top();
+}
 
-        omp_set_lock(&locks[invoke_head]);
-        interval_join(X_in[invoke_head], state, &dummy);
-        omp_unset_lock(&locks[invoke_head]);
+/*
+ * Intervals of the compared value on the taken and on the fall through edge,
+ * rounded to its congruence c, so an edge no value of it can take is empty.
+ */
+static void sparse_branch(SparseSolver* solver, SsaValue* branch, Interval* taken, Interval* not_taken, Congruence* c)
+{
+    Congruence right_c;
+    Interval left = sparse_eval(solver, branch->left, c);
+    Interval right = sparse_eval(solver, branch->right, &right_c);
 
-        interval_state_delete(state);
-    } else if (last->opcode == OP_RETURN) {
-        if (vector_length(X_out[current_node]->stack)) {
-            int iv_id;
-            vector_pop(X_out[current_node]->stack, &iv_id);
-            Interval* iv = vector_get(X_out[current_node]->env, iv_id);
-        }
-    } else {
-        interval_transfer(out, last);
+    if (is_interval_bottom(left) || is_interval_bottom(right)) {
+        *taken = interval_bottom();
+        *not_taken = interval_bottom();
+        return;
     }
+
+    interval_branch(branch->condition, &left, &right, taken, not_taken);
+    *taken = congruence_reduce(*taken, *c);
+    *not_taken = congruence_reduce(*not_taken, *c);
 }
 
-int apply_f(int current_node, AbstractContext* ctx, IntervalState** X_in, IntervalState** X_out, omp_lock_t* locks)
+static Interval sparse_evaluate(SparseSolver* solver, SsaValue* value, Congruence* c)
 {
-    int dummy;
-    int component = ctx->wpo.node_to_component[current_node];
-    int head = component == -1 ? -1 : *(int*)vector_get(ctx->wpo.heads, component);
-
-    IntervalState* in = X_in[current_node];
-    IntervalState* out = X_out[current_node];
+    // setup builds the ssa form for the interval domain only
+    const IntervalState* entry = (const IntervalState*)solver->ctx->entry;
 
-    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, current_node);
-    IrInstruction* last = *(IrInstruction**)vector_get(block->ir_function->ir_instructions,
-        block->ip_end);
+    *c = CONGRUENCE_TOP;
 
-    if (head == current_node) {
-        if (is_interval_state_bottom(out) && ctx->loop_iteration[component] < MAXIMUM_LOOP_ITERATION) {
-            ctx->loop_iteration[component]++;
-            interval_state_copy(out, in);
-        } else if (ctx->loop_iteration[component] >= MAXIMUM_LOOP_ITERATION) {
-            interval_widening(out, in, &dummy);
-        } else {
-            ctx->loop_iteration[component]++;
+    switch (value->kind) {
+    case SSA_ENTRY:
+        // the arguments are within the range of their types
+        if (entry && value->var < entry->max_locals) {
+            *c = entry->congruence[value->var];
+            return entry->slots[value->var];
         }
+        return interval_top();
+    case SSA_EXPR:
+        return sparse_eval(solver, value->expr, c);
+    case SSA_SIGMA: {
+        // the sigma copies the left operand of the branch
+        Interval taken, not_taken;
+        sparse_branch(solver, ssa_value(solver->ssa, value->branch), &taken, &not_taken, c);
+        return value->taken ? taken : not_taken;
+    }
+    case SSA_PHI: {
+        Vector* predecessors = solver->ssa->blocks[value->block].predecessors;
+        Interval joined = interval_bottom();
 
-        for (int ip = block->ip_start; ip < block->ip_end; ip++) {
-            IrInstruction* ir = *(IrInstruction**)
-                                    vector_get(block->ir_function->ir_instructions, ip);
-            interval_transfer(out, ir);
+        for (size_t i = 0; i < vector_length(predecessors); i++) {
+            SsaEdge* edge = vector_get(predecessors, i);
+            int operand = *(int*)vector_get(value->operands, i);
+
+            if (operand != -1 && solver->feasible[2 * edge->source + MIN(edge->index, 1)]) {
+                *c = congruence_join(joined, *c, solver->value[operand], solver->congruence[operand]);
+                joined = interval_join_single(joined, solver->value[operand]);
+            }
         }
 
-        apply_last(last, block, X_in, X_out, out, current_node, component, ctx, 1, locks);
+        return joined;
+    }
+    default:
+        return interval_top();
+    }
+}
 
-    } else {
-        interval_state_copy(out, in);
+static void sparse_enable_edge(SparseSolver* solver, int block, int index);
 
-        for (int ip = block->ip_start; ip < block->ip_end; ip++) {
-            IrInstruction* ir = *(IrInstruction**)
-                                    vector_get(block->ir_function->ir_instructions, ip);
-            interval_transfer(out, ir);
-        }
-        apply_last(last, block, X_in, X_out, out, current_node, component, ctx, 0, locks);
+static void sparse_activate(SparseSolver* solver, int block)
+{
+    SsaBlock* ssa_block = &solver->ssa->blocks[block];
 
-        interval_join(in, out, &dummy);
+    solver->executable[block] = true;
+    for (size_t i = 0; i < vector_length(ssa_block->values); i++) {
+        sparse_push(solver, *(int*)vector_get(ssa_block->values, i));
     }
 
-    interval_state_copy(X_in[current_node], X_out[current_node]);
-    return ir_instruction_is_conditional(last) || last->opcode == OP_INVOKE;
+    if (ssa_block->branch == -1) {
+        for (size_t i = 0; i < vector_length(ssa_block->successors); i++) {
+            sparse_enable_edge(solver, block, i);
+        }
+    }
 }
 
-int is_component_stabilized(int current_node, AbstractContext* ctx, IntervalState** X_in, IntervalState** X_out, omp_lock_t* locks)
+static void sparse_enable_edge(SparseSolver* solver, int block, int index)
 {
-    int component_id = ctx->wpo.node_to_component[current_node];
-
-    int head = *(int*)vector_get(ctx->wpo.heads, component_id);
+    bool* feasible = &solver->feasible[2 * block + MIN(index, 1)];
+    if (*feasible) {
+        return;
+    }
+    *feasible = true;
 
-    BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, head);
+    int target = *(int*)vector_get(solver->ssa->blocks[block].successors, index);
 
-    omp_set_lock(&locks[head]);
+    if (!solver->executable[target]) {
+        sparse_activate(solver, target);
+        return;
+    }
 
-    IntervalState* test_in = interval_new_top_state(block->num_locals);
-    IntervalState* test_out = interval_new_top_state(block->num_locals);
+    // the phis of the target gain an operand
+    Vector* values = solver->ssa->blocks[target].values;
+    for (size_t i = 0; i < vector_length(values); i++) {
+        int phi = *(int*)vector_get(values, i);
+        if (ssa_value(solver->ssa, phi)->kind != SSA_PHI) {
+            break;
+        }
+        sparse_push(solver, phi);
+    }
+}
 
-    interval_state_copy(test_in, X_in[current_node]);
-    interval_state_copy(test_out, X_in[head]);
+static void sparse_update_branch(SparseSolver* solver, SsaValue* branch)
+{
+    Interval taken, not_taken;
+    Congruence c;
+    int count = vector_length(solver->ssa->blocks[branch->block].successors);
 
-    omp_unset_lock(&locks[head]);
+    sparse_branch(solver, branch, &taken, &not_taken, &c);
 
-    if (vector_length(test_in->locals) != vector_length(test_out->locals)) {
-        interval_state_delete(test_in);
-        interval_state_delete(test_out);
-        return 0;
+    // cfg_build pushes the branch target first and the fall through second
+    if (count > 0 && !is_interval_bottom(taken)) {
+        sparse_enable_edge(solver, branch->block, 0);
     }
+    if (count > 1 && !is_interval_bottom(not_taken)) {
+        sparse_enable_edge(solver, branch->block, 1);
+    }
+}
 
-    for (size_t i = 0; i < vector_length(test_in->locals); i++) {
-        int in_id = *(int*)vector_get(test_in->locals, i);
-        int out_id = *(int*)vector_get(test_out->locals, i);
+/*
+ * Phis of the loop heads are widened with the thresholds of their loop once
+ * they changed widening_delay times, like the head states of the dense
+ * analysis. Any other phi only gets widened if it keeps changing.
+ */
+static Interval sparse_widen(SparseSolver* solver, int id, SsaValue* value, Interval old, Interval joined)
+{
+    AbstractContext* ctx = solver->ctx;
+    int evaluations = solver->evaluations[id]++;
 
-        Interval* in = vector_get(test_in->env, in_id);
-        Interval* out = vector_get(test_out->env, out_id);
+    if (deadline_expired(ctx)) {
+        return interval_widen_single(old, joined, NULL, 0);
+    }
 
-        if (out->lower == in->lower && out->upper == in->upper && (in->lower == INT_MIN || in->upper == INT_MAX)) {
-            continue;
-        }
+    if (is_component_head(ctx, value->block)) {
+        int component_id = ctx->wpo.node_to_component[value->block];
+        Vector* thresholds = ctx->thresholds[component_id];
 
-        if ((out->lower > in->lower) || (out->upper < in->upper)) {
-            interval_state_delete(test_in);
-            interval_state_delete(test_out);
-            return 0;
+        if (evaluations >= ctx->widening_delay[component_id]) {
+            return interval_widen_single(old, joined, vector_get(thresholds, 0), vector_length(thresholds));
         }
+    } else if (evaluations >= SPARSE_WIDENING_LIMIT) {
+        return interval_widen_single(old, joined, NULL, 0);
     }
 
-    interval_state_delete(test_in);
-    interval_state_delete(test_out);
-
-    return 1;
+    return joined;
 }
 
-void process_node_task(int current_node, AbstractContext* ctx,
-    int* N, IntervalState** X_in, IntervalState** X_out,
-    omp_lock_t* locks)
+static void sparse_ascend(SparseSolver* solver)
 {
-    if (N[current_node] == ctx->wpo.num_sched_pred[current_node]) {
-        /*** NonExit ***/
-        if (current_node < ctx->block_count) {
-            int is_conditional = apply_f(current_node, ctx, X_in, X_out, locks);
+    int id;
 
-            omp_set_lock(&locks[current_node]);
-            N[current_node] = 0;
-            omp_unset_lock(&locks[current_node]);
+    sparse_activate(solver, 0);
 
-            /*** update scheduling successors ***/
-            Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
-            for (size_t i = 0; i < vector_length(node->successors); i++) {
-                int successor = *(int*)vector_get(node->successors, i);
+    while (sparse_pop(solver, &id) == SUCCESS) {
+        SsaValue* value = ssa_value(solver->ssa, id);
 
-                /*** CRITICAL SECTION ***/
-                omp_set_lock(&locks[successor]);
+        if (!solver->executable[value->block]) {
+            continue;
+        }
 
-                if (!(is_conditional && (i == 0 || i == 1))) {
-                    int dummy;
-                    interval_join(X_in[successor], X_out[current_node], &dummy);
-                }
+        if (value->kind == SSA_BRANCH) {
+            sparse_update_branch(solver, value);
+            continue;
+        }
 
-                N[successor]++;
-                int ready = (N[successor] == ctx->wpo.num_sched_pred[successor]);
+        Interval old = solver->value[id];
+        Congruence old_c = solver->congruence[id];
+        Congruence c;
+        Interval evaluated = sparse_evaluate(solver, value, &c);
 
-                omp_unset_lock(&locks[successor]);
-                /*** END CRITICAL SECTION ***/
+        // nothing to join, whatever the congruence of an empty value says
+        if (is_interval_bottom(evaluated)) {
+            continue;
+        }
 
-                if (ready) {
-#pragma omp task
-                    process_node_task(successor, ctx, N, X_in, X_out, locks);
-                }
-            }
+        c = congruence_join(old, old_c, evaluated, c);
+        Interval next = interval_join_single(old, evaluated);
+
+        if (next.lower == old.lower && next.upper == old.upper && c == old_c) {
+            continue;
         }
-        /*** Exit ***/
-        else {
-            interval_state_copy(X_out[current_node], X_in[current_node]);
 
-            omp_set_lock(&locks[current_node]);
-            N[current_node] = 0;
-            omp_unset_lock(&locks[current_node]);
+        if (value->kind == SSA_PHI) {
+            next = sparse_widen(solver, id, value, old, next);
+        }
 
-            if (is_component_stabilized(current_node, ctx, X_in, X_out, locks)) {
-                Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
-                int exit_component = ctx->wpo.node_to_component[current_node];
-                int head = *(int*)vector_get(ctx->wpo.heads, exit_component);
+        solver->value[id] = congruence_reduce(next, c);
+        solver->congruence[id] = c;
+        for (size_t i = 0; i < vector_length(value->users); i++) {
+            sparse_push(solver, *(int*)vector_get(value->users, i));
+        }
+    }
+}
 
-                for (size_t i = 0; i < vector_length(node->successors); i++) {
-                    int successor = *(int*)vector_get(node->successors, i);
-                    if (successor != head) {
+// decreasing sweeps over the values in dominator order, the edges are kept
+static void sparse_descend(SparseSolver* solver)
+{
+    int count = vector_length(solver->ssa->values);
 
-                        /*** CRITICAL SECTION ***/
-                        omp_set_lock(&locks[successor]);
+    for (int round = 0; round < solver->ctx->narrowing_iterations && !deadline_expired(solver->ctx); round++) {
+        int changed = 0;
 
-                        int dummy = 0;
-                        interval_join(X_in[successor], X_out[current_node], &dummy);
-                        N[successor]++;
-                        int ready = (N[successor] == ctx->wpo.num_sched_pred[successor]);
+        for (int id = 0; id < count; id++) {
+            SsaValue* value = ssa_value(solver->ssa, id);
+            if (!solver->executable[value->block] || value->kind == SSA_BRANCH || value->kind == SSA_ENTRY) {
+                continue;
+            }
 
-                        omp_unset_lock(&locks[successor]);
-                        /*** END CRITICAL SECTION ***/
+            // the congruences of the ascending phase still hold for the narrower values
+            Congruence c;
+            Interval old = solver->value[id];
+            Interval next = interval_narrow_single(old, sparse_evaluate(solver, value, &c));
 
-                        if (ready) {
-#pragma omp task
-                            process_node_task(successor, ctx, N, X_in, X_out, locks);
-                        }
-                    }
-                }
-            } else {
-                // update cycle successor
-                Node* node = vector_get(ctx->wpo.wpo->nodes, current_node);
-                int loop_head = *(int*)vector_get(node->successors, vector_length(node->successors) - 1);
-
-                omp_set_lock(&locks[loop_head]);
-                int dummy = 0;
-                interval_join(X_in[loop_head], X_out[current_node], &dummy);
-                omp_unset_lock(&locks[loop_head]);
-
-                // set n for component
-                int component_id = ctx->wpo.node_to_component[current_node];
-                C* component = vector_get(ctx->wpo.Cx, component_id);
-                Vector* component_nodes = component->components;
-
-                for (size_t i = 0; i < vector_length(component_nodes); i++) {
-                    int node = *(int*)vector_get(component_nodes, i);
-                    omp_set_lock(&locks[node]);
-                    N[node] = ctx->wpo.num_outer_sched_pred[component_id][node];
-
-                    int ready = (N[node] == ctx->wpo.num_sched_pred[node]);
-                    omp_unset_lock(&locks[node]);
-
-                    if (ready) {
-#pragma omp task
-                        process_node_task(node, ctx, N, X_in, X_out, locks);
-                    }
-                }
+            next = congruence_reduce(next, solver->congruence[id]);
+            if (next.lower != old.lower || next.upper != old.upper) {
+                solver->value[id] = next;
+                changed = 1;
             }
         }
-    }
 
-    // #ifdef DEBUG
-    //     LOG_DEBUG("NODE %d STATE AFTER:", current_node);
-    //     interval_state_print(X_out[current_node]);
-    // #endif
+        if (!changed) {
+            break;
+        }
+    }
 }
 
-AbstractResult interpreter_abstract_run(AbstractContext* ctx)
+static AbstractResult run_sparse(AbstractContext* ctx)
 {
-    int nodes_num = ctx->block_count + ctx->exit_count;
-    if (!ctx) {
+    AbstractResult result = { 0 };
+    SsaForm* ssa = ctx->ssa;
+    int count = vector_length(ssa->values);
+
+    SparseSolver solver = {
+        .ctx = ctx,
+        .ssa = ssa,
+        .value = malloc(sizeof(Interval) * (count + 1)),
+        .congruence = malloc(sizeof(Congruence) * (count + 1)),
+        .evaluations = calloc(count + 1, sizeof(int)),
+        .executable = calloc(ssa->block_count + 1, sizeof(bool)),
+        .feasible = calloc(2 * ssa->block_count + 1, sizeof(bool)),
+        .queued = calloc(count + 1, sizeof(bool)),
+        .worklist = vector_new(sizeof(int)),
+        .next = 0,
+    };
+
+    if (!solver.value || !solver.congruence || !solver.evaluations || !solver.executable || !solver.feasible || !solver.queued || !solver.worklist) {
         goto cleanup;
     }
 
-    if (!ctx->cfg) {
-        goto cleanup;
+    for (int id = 0; id < count; id++) {
+        SsaValue* value = ssa_value(ssa, id);
+        solver.congruence[id] = CONGRUENCE_TOP;
+        solver.value[id] = value->kind == SSA_ENTRY ? sparse_evaluate(&solver, value, &solver.congruence[id]) : interval_bottom();
     }
 
-    int* N = calloc(nodes_num, sizeof(int));
-    IntervalState** X_in = calloc(nodes_num, sizeof(IntervalState));
-    IntervalState** X_out = calloc(nodes_num, sizeof(IntervalState));
+    sparse_ascend(&solver);
+    sparse_descend(&solver);
 
-    omp_lock_t* node_locks = malloc(sizeof(omp_lock_t) * nodes_num);
-    for (int i = 0; i < nodes_num; i++) {
-        omp_init_lock(&node_locks[i]);
-    }
+    BasicBlock* entry_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, 0);
+    int num_locals = entry_block->num_locals;
+    Interval bottom = interval_bottom();
+    Interval top = interval_top();
 
-    if (!N || !X_in || !X_out || !node_locks) {
-        goto cleanup;
-    }
+    result = abstract_result_new(num_locals);
 
-#ifdef DEBUG
-    for (int i = 0; i < nodes_num; i++) {
-        LOG_DEBUG("NODE %d, COMPONENT %d", i, ctx->wpo.node_to_component[i]);
+    for (int i = 0; i < ctx->block_count; i++) {
+        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
+        if (entry_block->ir_function != block->ir_function) {
+            continue;
+        }
+
+        for (int j = 0; j < num_locals; j++) {
+            if (!solver.executable[i]) {
+                vector_push(result.results[j], &bottom);
+            } else if (j < ssa->observed_locals) {
+                vector_push(result.results[j], &solver.value[ssa->blocks[i].exit_values[j]]);
+            } else {
+                vector_push(result.results[j], &top);
+            }
+        }
     }
-#endif
 
-    /*** INIT ***/
-    int current_node = 0;
-    BasicBlock* entry_block = *(BasicBlock**)vector_get(ctx->cfg->blocks, 0);
+    result.degraded = ctx->expired;
+    cache_result(ctx, &result, NULL);
 
-    X_in[current_node] = interval_new_top_state(entry_block->num_locals);
-    X_out[current_node] = interval_new_bottom_state(entry_block->num_locals);
+cleanup:
+    free(solver.value);
+    free(solver.congruence);
+    free(solver.evaluations);
+    free(solver.executable);
+    free(solver.feasible);
+    free(solver.queued);
+    vector_delete(solver.worklist);
 
-    for (int i = current_node + 1; i < nodes_num; i++) {
-        BasicBlock* block;
-        LOG_DEBUG("NODE: %d", i);
+    return result;
+}
 
-        // node is an exit
-        if (i < ctx->block_count) {
-            block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
-        } else {
-            int exit_component = ctx->wpo.node_to_component[i];
-            int head = *(int*)vector_get(ctx->wpo.heads, exit_component);
-            block = *(BasicBlock**)vector_get(ctx->cfg->blocks, head);
-        }
+static void abstract_context_delete(AbstractContext* ctx)
+{
+    int nodes_num = ctx->block_count + ctx->exit_count;
 
-        X_in[i] = interval_new_bottom_state(block->num_locals);
-        X_out[i] = interval_new_bottom_state(block->num_locals);
+    for (size_t i = 0; ctx->thresholds && i < vector_length(ctx->wpo.Cx); i++) {
+        vector_delete(ctx->thresholds[i]);
     }
+    free(ctx->thresholds);
 
-#pragma omp parallel
-    {
-#pragma omp single
-        {
-#pragma omp task
-            {
-                process_node_task(0, ctx, N, X_in, X_out, node_locks);
-            }
-        }
+    for (size_t i = 0; ctx->inductions && i < vector_length(ctx->wpo.Cx); i++) {
+        vector_delete(ctx->inductions[i]);
     }
+    free(ctx->inductions);
+    free(ctx->widening_delay);
+    free(ctx->loop_iteration);
+    free(ctx->phase);
+    free(ctx->narrowing_left);
+    free(ctx->checked_version);
+    free(ctx->applied);
+
+    for (int i = 0; i < ctx->arena_count; i++) {
+        ctx->domain->arena_delete(ctx->arenas[i]);
+    }
+    free(ctx->arenas);
 
-#ifdef DEBUG
-    LOG_INFO("RESULTS:");
-    for (int i = 0; i < nodes_num; i++) {
-        LOG_INFO("NODE %d", i);
-        interval_state_print(X_out[i]);
+    for (int i = 0; ctx->predecessors && i < nodes_num; i++) {
+        vector_delete(ctx->predecessors[i]);
     }
-#endif
+    free(ctx->predecessors);
 
-    int num_locals = entry_block->num_locals;
-    Vector** results = malloc(sizeof(Vector*) * num_locals);
-    for (int i = 0; i < num_locals; i++) {
-        results[i] = vector_new(sizeof(Interval));
+    for (int i = 0; ctx->seeds && i < nodes_num; i++) {
+        ctx->domain->delete(ctx->seeds[i]);
     }
+    free(ctx->seeds);
+    ctx->domain->delete(ctx->entry);
+    free(ctx->method_id);
 
-    for (int i = 0; i < ctx->block_count; i++) {
-        BasicBlock* block = *(BasicBlock**)vector_get(ctx->cfg->blocks, i);
+#ifdef STATS
+    stats_delete(ctx->stats);
+    free(ctx->stats_path);
+#endif
 
-        if (entry_block->ir_function == block->ir_function) {
-            for (int j = 0; j < num_locals; j++) {
-                int interval_id = *(int*)vector_get(X_out[i]->locals, j);
-                Interval* iv = vector_get(X_out[i]->env, interval_id);
+    ssa_delete(ctx->ssa);
+    wpo_delete(ctx->wpo);
+    graph_delete(ctx->flow);
+    cfg_delete(ctx->cfg);
 
-                vector_push(results[j], iv);
-            }
+    free(ctx);
+}
+
+/*
+ * Runs the fixpoint on a team of threads threads (0 for the OpenMP default),
+ * spawning tasks in a randomized order when seed is not 0.
+ */
+void interpreter_abstract_set_schedule(AbstractContext* ctx, int threads, unsigned seed)
+{
+    if (!ctx || threads < 0) {
+        return;
+    }
+
+    // one arena per thread of the team
+    if (threads > ctx->arena_count) {
+        AbstractArena** arenas = realloc(ctx->arenas, sizeof(AbstractArena*) * threads);
+        if (!arenas) {
+            return;
+        }
+
+        ctx->arenas = arenas;
+        for (int i = ctx->arena_count; i < threads; i++) {
+            ctx->arenas[i] = ctx->domain->arena_new(ctx->max_locals, ctx->max_stack);
         }
+        ctx->arena_count = threads;
     }
 
-    AbstractResult result = { .results = results, .num_locals = num_locals };
+    ctx->threads = threads;
+    ctx->schedule_seed = seed;
+}
 
-cleanup:
-    for (int i = 0; i < nodes_num; i++) {
-        omp_destroy_lock(&node_locks[i]);
+// states receives a canonical string of X_out of every node, owned by the caller
+void interpreter_abstract_record_states(AbstractContext* ctx, Vector* states)
+{
+    if (ctx) {
+        ctx->record = states;
     }
-    free(node_locks);
+}
 
-    free(N);
+AbstractResult interpreter_abstract_run(AbstractContext* ctx)
+{
+    AbstractResult result = { 0 };
 
-    if (X_in) {
-        for (int i = 0; i < nodes_num; i++) {
-            interval_state_delete(X_in[i]);
-        }
-        free(X_in);
+    if (!ctx) {
+        return result;
     }
 
-    if (X_out) {
-        for (int i = 0; i < nodes_num; i++) {
-            interval_state_delete(X_out[i]);
+    if (ctx->cache_hit) {
+        result = ctx->cached;
+    } else if (ctx->cfg) {
+        if (ctx->ssa) {
+            result = run_sparse(ctx);
+        } else {
+            result = ctx->domain->run(ctx);
         }
-        free(X_out);
-    }
 
-    wpo_delete(ctx->wpo);
+        if (result.degraded) {
+            LOG_INFO("Deadline reached, loops were widened at once and the result is less precise");
+        }
+    }
 
-    free(ctx);
+    abstract_context_delete(ctx);
     return result;
 }
 
@@ -546,3 +2325,21 @@ void abstract_result_print(const AbstractResult* result)
 
     LOG_INFO("=========================");
 }
+
+void abstract_result_delete(AbstractResult* result)
+{
+    if (!result || !result->results) {
+        return;
+    }
+
+    for (int i = 0; i < result->num_locals; i++) {
+        vector_delete(result->results[i]);
+    }
+
+    free(result->results);
+    result->results = NULL;
+    result->num_locals = 0;
+
+    invariant_store_delete(result->invariants);
+    result->invariants = NULL;
+}
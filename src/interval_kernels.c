@@ -0,0 +1,511 @@
+#include "interval_kernels.h"
+
+#include "log.h"
+
+#include <limits.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(INTERVAL_SCALAR)
+#define INTERVAL_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+/*** SCALAR ***/
+
+static int write_slot(Interval* acc, unsigned* stamp, unsigned version, int i, Interval iv)
+{
+    if (acc[i].lower == iv.lower && acc[i].upper == iv.upper) {
+        return 0;
+    }
+
+    acc[i] = iv;
+    stamp[i] = version;
+
+    return 1;
+}
+
+static Interval meet_single(Interval a, Interval b)
+{
+    return (Interval) {
+        .lower = (a.lower > b.lower) ? a.lower : b.lower,
+        .upper = (a.upper < b.upper) ? a.upper : b.upper
+    };
+}
+
+static int join_scalar(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        any |= write_slot(acc, stamp, version, i, interval_join_single(acc[i], src[i]));
+    }
+
+    return any;
+}
+
+static int meet_scalar(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    for (int i = 0; i < len; i++) {
+        Interval r = meet_single(acc[i], src[i]);
+        if (r.lower > r.upper) {
+            return -1;
+        }
+    }
+
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        any |= write_slot(acc, stamp, version, i, meet_single(acc[i], src[i]));
+    }
+
+    return any;
+}
+
+static int widen_scalar(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len,
+    const int* thresholds, int thresholds_count)
+{
+    int any = 0;
+
+    for (int i = 0; i < len; i++) {
+        any |= write_slot(acc, stamp, version, i, interval_widen_single(acc[i], src[i], thresholds, thresholds_count));
+    }
+
+    return any;
+}
+
+static bool leq_scalar(const Interval* a, const Interval* b, const unsigned* stamp, unsigned since, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (since && stamp[i] <= since) {
+            continue;
+        }
+
+        if (a[i].lower < b[i].lower || a[i].upper > b[i].upper) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool equal_scalar(const Interval* a, const Interval* b, int len)
+{
+    for (int i = 0; i < len; i++) {
+        if (a[i].lower != b[i].lower || a[i].upper != b[i].upper) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static const IntervalKernels scalar_kernels = {
+    .name = "scalar",
+    .join = join_scalar,
+    .meet = meet_scalar,
+    .widen = widen_scalar,
+    .leq = leq_scalar,
+    .equal = equal_scalar,
+};
+
+#ifdef INTERVAL_KERNELS_X86
+
+/*
+ * Both vector sets follow the scalar code lane by lane: a bottom slot is the
+ * exact pair { 1, -1 }, and a changed slot is written through write_slot so
+ * that its stamp moves. Widening computes the unbounded result and, when
+ * there are thresholds, recomputes the few slots that grew.
+ */
+
+// differ has a bit per lane, a slot is written when either of its lanes moved
+static int store_lanes(Interval* acc, const Interval* result, unsigned* stamp, unsigned version, int base, int count, int differ)
+{
+    int any = 0;
+
+    for (int k = 0; k < count; k++) {
+        if (differ & (3 << (2 * k))) {
+            any |= write_slot(acc, stamp, version, base + k, result[k]);
+        }
+    }
+
+    return any;
+}
+
+static int widen_lanes(Interval* acc, const Interval* src, const Interval* result, unsigned* stamp, unsigned version,
+    int base, int count, int differ, const int* thresholds, int thresholds_count)
+{
+    if (!thresholds_count) {
+        return store_lanes(acc, result, stamp, version, base, count, differ);
+    }
+
+    int any = 0;
+
+    for (int k = 0; k < count; k++) {
+        if (differ & (3 << (2 * k))) {
+            int i = base + k;
+            any |= write_slot(acc, stamp, version, i, interval_widen_single(acc[i], src[i], thresholds, thresholds_count));
+        }
+    }
+
+    return any;
+}
+
+/*** AVX2 ***/
+
+__attribute__((target("avx2"))) static inline __m256i bottom_avx2(__m256i v)
+{
+    __m256i eq = _mm256_cmpeq_epi32(v, _mm256_setr_epi32(1, -1, 1, -1, 1, -1, 1, -1));
+    return _mm256_and_si256(eq, _mm256_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("avx2"))) static inline int differ_avx2(__m256i a, __m256i b)
+{
+    return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))) & 0xFF;
+}
+
+__attribute__((target("avx2"))) static int join_avx2(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    int any = 0;
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+
+        __m256i r = _mm256_blend_epi32(_mm256_min_epi32(a, b), _mm256_max_epi32(a, b), 0xAA);
+        r = _mm256_blendv_epi8(r, a, bottom_avx2(b));
+        r = _mm256_blendv_epi8(r, b, bottom_avx2(a));
+
+        int differ = differ_avx2(r, a);
+        if (differ) {
+            Interval result[4];
+            _mm256_storeu_si256((__m256i*)result, r);
+            any |= store_lanes(acc, result, stamp, version, i, 4, differ);
+        }
+    }
+
+    return any | join_scalar(acc + i, src + i, stamp + i, version, len - i);
+}
+
+__attribute__((target("avx2"))) static int meet_avx2(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+
+        __m256i r = _mm256_blend_epi32(_mm256_max_epi32(a, b), _mm256_min_epi32(a, b), 0xAA);
+        __m256i swapped = _mm256_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1));
+
+        // lower > upper, read on the even lanes
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(r, swapped))) & 0x55) {
+            return -1;
+        }
+    }
+
+    for (int j = i; j < len; j++) {
+        Interval r = meet_single(acc[j], src[j]);
+        if (r.lower > r.upper) {
+            return -1;
+        }
+    }
+
+    int any = 0;
+
+    for (i = 0; i + 4 <= len; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i r = _mm256_blend_epi32(_mm256_max_epi32(a, b), _mm256_min_epi32(a, b), 0xAA);
+
+        int differ = differ_avx2(r, a);
+        if (differ) {
+            Interval result[4];
+            _mm256_storeu_si256((__m256i*)result, r);
+            any |= store_lanes(acc, result, stamp, version, i, 4, differ);
+        }
+    }
+
+    return any | meet_scalar(acc + i, src + i, stamp + i, version, len - i);
+}
+
+__attribute__((target("avx2"))) static int widen_avx2(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len,
+    const int* thresholds, int thresholds_count)
+{
+    __m256i extreme = _mm256_setr_epi32(INT_MIN, INT_MAX, INT_MIN, INT_MAX, INT_MIN, INT_MAX, INT_MIN, INT_MAX);
+    int any = 0;
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+
+        // the lower bound went down or the upper bound went up
+        __m256i grew = _mm256_blend_epi32(_mm256_cmpgt_epi32(a, b), _mm256_cmpgt_epi32(b, a), 0xAA);
+        __m256i r = _mm256_blendv_epi8(a, extreme, grew);
+        r = _mm256_blendv_epi8(r, a, bottom_avx2(b));
+        r = _mm256_blendv_epi8(r, b, bottom_avx2(a));
+
+        int differ = differ_avx2(r, a);
+        if (differ) {
+            Interval result[4];
+            _mm256_storeu_si256((__m256i*)result, r);
+            any |= widen_lanes(acc, src, result, stamp, version, i, 4, differ, thresholds, thresholds_count);
+        }
+    }
+
+    return any | widen_scalar(acc + i, src + i, stamp + i, version, len - i, thresholds, thresholds_count);
+}
+
+__attribute__((target("avx2"))) static bool leq_avx2(const Interval* a, const Interval* b, const unsigned* stamp, unsigned since, int len)
+{
+    __m128i offset = _mm_set1_epi32(INT_MIN);
+    __m128i limit = _mm_xor_si128(_mm_set1_epi32((int)since), offset);
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+
+        __m256i above = _mm256_blend_epi32(_mm256_cmpgt_epi32(y, x), _mm256_cmpgt_epi32(x, y), 0xAA);
+
+        if (since) {
+            // unsigned stamp > since, one mask per slot widened to its two lanes
+            __m128i stamps = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(stamp + i)), offset);
+            above = _mm256_and_si256(above, _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(stamps, limit)));
+        }
+
+        if (!_mm256_testz_si256(above, above)) {
+            return false;
+        }
+    }
+
+    return leq_scalar(a + i, b + i, stamp + i, since, len - i);
+}
+
+__attribute__((target("avx2"))) static bool equal_avx2(const Interval* a, const Interval* b, int len)
+{
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+
+        if (differ_avx2(x, y)) {
+            return false;
+        }
+    }
+
+    return equal_scalar(a + i, b + i, len - i);
+}
+
+static const IntervalKernels avx2_kernels = {
+    .name = "avx2",
+    .join = join_avx2,
+    .meet = meet_avx2,
+    .widen = widen_avx2,
+    .leq = leq_avx2,
+    .equal = equal_avx2,
+};
+
+/*** SSE4.1 ***/
+
+__attribute__((target("sse4.1"))) static inline __m128i bottom_sse41(__m128i v)
+{
+    __m128i eq = _mm_cmpeq_epi32(v, _mm_setr_epi32(1, -1, 1, -1));
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse4.1"))) static inline int differ_sse41(__m128i a, __m128i b)
+{
+    return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0xF;
+}
+
+// even lanes from a, odd lanes from b
+__attribute__((target("sse4.1"))) static inline __m128i pair_sse41(__m128i a, __m128i b)
+{
+    return _mm_blend_epi16(a, b, 0xCC);
+}
+
+__attribute__((target("sse4.1"))) static int join_sse41(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    int any = 0;
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+
+        __m128i r = pair_sse41(_mm_min_epi32(a, b), _mm_max_epi32(a, b));
+        r = _mm_blendv_epi8(r, a, bottom_sse41(b));
+        r = _mm_blendv_epi8(r, b, bottom_sse41(a));
+
+        int differ = differ_sse41(r, a);
+        if (differ) {
+            Interval result[2];
+            _mm_storeu_si128((__m128i*)result, r);
+            any |= store_lanes(acc, result, stamp, version, i, 2, differ);
+        }
+    }
+
+    return any | join_scalar(acc + i, src + i, stamp + i, version, len - i);
+}
+
+__attribute__((target("sse4.1"))) static int meet_sse41(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len)
+{
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+
+        __m128i r = pair_sse41(_mm_max_epi32(a, b), _mm_min_epi32(a, b));
+        __m128i swapped = _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1));
+
+        if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(r, swapped))) & 0x5) {
+            return -1;
+        }
+    }
+
+    for (int j = i; j < len; j++) {
+        Interval r = meet_single(acc[j], src[j]);
+        if (r.lower > r.upper) {
+            return -1;
+        }
+    }
+
+    int any = 0;
+
+    for (i = 0; i + 2 <= len; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i r = pair_sse41(_mm_max_epi32(a, b), _mm_min_epi32(a, b));
+
+        int differ = differ_sse41(r, a);
+        if (differ) {
+            Interval result[2];
+            _mm_storeu_si128((__m128i*)result, r);
+            any |= store_lanes(acc, result, stamp, version, i, 2, differ);
+        }
+    }
+
+    return any | meet_scalar(acc + i, src + i, stamp + i, version, len - i);
+}
+
+__attribute__((target("sse4.1"))) static int widen_sse41(Interval* acc, const Interval* src, unsigned* stamp, unsigned version, int len,
+    const int* thresholds, int thresholds_count)
+{
+    __m128i extreme = _mm_setr_epi32(INT_MIN, INT_MAX, INT_MIN, INT_MAX);
+    int any = 0;
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+
+        __m128i grew = pair_sse41(_mm_cmpgt_epi32(a, b), _mm_cmpgt_epi32(b, a));
+        __m128i r = _mm_blendv_epi8(a, extreme, grew);
+        r = _mm_blendv_epi8(r, a, bottom_sse41(b));
+        r = _mm_blendv_epi8(r, b, bottom_sse41(a));
+
+        int differ = differ_sse41(r, a);
+        if (differ) {
+            Interval result[2];
+            _mm_storeu_si128((__m128i*)result, r);
+            any |= widen_lanes(acc, src, result, stamp, version, i, 2, differ, thresholds, thresholds_count);
+        }
+    }
+
+    return any | widen_scalar(acc + i, src + i, stamp + i, version, len - i, thresholds, thresholds_count);
+}
+
+__attribute__((target("sse4.1"))) static bool leq_sse41(const Interval* a, const Interval* b, const unsigned* stamp, unsigned since, int len)
+{
+    __m128i offset = _mm_set1_epi32(INT_MIN);
+    __m128i limit = _mm_xor_si128(_mm_set1_epi32((int)since), offset);
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+
+        __m128i above = pair_sse41(_mm_cmpgt_epi32(y, x), _mm_cmpgt_epi32(x, y));
+
+        if (since) {
+            __m128i stamps = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)(stamp + i)), offset);
+            above = _mm_and_si128(above, _mm_cvtepi32_epi64(_mm_cmpgt_epi32(stamps, limit)));
+        }
+
+        if (!_mm_testz_si128(above, above)) {
+            return false;
+        }
+    }
+
+    return leq_scalar(a + i, b + i, stamp + i, since, len - i);
+}
+
+__attribute__((target("sse4.1"))) static bool equal_sse41(const Interval* a, const Interval* b, int len)
+{
+    int i = 0;
+
+    for (; i + 2 <= len; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+
+        if (differ_sse41(x, y)) {
+            return false;
+        }
+    }
+
+    return equal_scalar(a + i, b + i, len - i);
+}
+
+static const IntervalKernels sse41_kernels = {
+    .name = "sse4.1",
+    .join = join_sse41,
+    .meet = meet_sse41,
+    .widen = widen_sse41,
+    .leq = leq_sse41,
+    .equal = equal_sse41,
+};
+
+#endif
+
+/*** DISPATCH ***/
+
+static const IntervalKernels* select_kernels(void)
+{
+#ifdef INTERVAL_KERNELS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return &avx2_kernels;
+    }
+
+    if (__builtin_cpu_supports("sse4.1")) {
+        return &sse41_kernels;
+    }
+#endif
+
+    return &scalar_kernels;
+}
+
+const IntervalKernels* interval_kernels(void)
+{
+    static const IntervalKernels* selected = NULL;
+    const IntervalKernels* kernels;
+
+    // every thread selects the same set, the first one to finish publishes it
+#pragma omp atomic read
+    kernels = selected;
+
+    if (!kernels) {
+        kernels = select_kernels();
+        LOG_DEBUG("Interval kernels: %s", kernels->name);
+
+#pragma omp atomic write
+        selected = kernels;
+    }
+
+    return kernels;
+}
@@ -5,6 +5,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#define EXACT_VALUES 16 // intervals up to this many values are seeded with all of them
+#define SEED_BUDGET 256 // seeds of one product of representatives
+
 static int is_top_interval(Interval* iv) {
     return iv->lower == INT_MIN && iv->upper == INT_MAX;
 }
@@ -31,6 +34,16 @@ static Vector* interval_to_values(Interval* iv) {
 
     int L = iv->lower;
     int U = iv->upper;
+
+    // a boolean, or any small range, is covered value by value
+    if ((long long)U - L < EXACT_VALUES) {
+        for (long long v = L; v <= U; v++) {
+            int value = (int)v;
+            vector_push(reps, &value);
+        }
+        return reps;
+    }
+
     vector_push(reps, &L);
 
     if (L < 0 && U > 0) {
@@ -123,6 +136,85 @@ static TestCase* build_testcase_from_values(Fuzzer* f,
     return tc;
 }
 
+// the seed made of the idx[a]-th representative of every argument a
+static void seed_push(Fuzzer* f,
+                      Vector* arg_types,
+                      Vector** arg_representatives,
+                      const size_t* idx,
+                      Vector* seeds)
+{
+    size_t arg_count = vector_length(arg_types);
+    Vector* tuple = vector_new(sizeof(int));
+    if (!tuple) return;
+
+    for (size_t a = 0; a < arg_count; a++) {
+        int v = *(int*)vector_get(arg_representatives[a], idx[a]);
+        vector_push(tuple, &v);
+    }
+
+    TestCase* tc = build_testcase_from_values(f, arg_types, tuple);
+    // the fuzzer adds the seeds to its corpus when it runs them
+    if (tc) {
+        vector_push(seeds, &tc);
+    }
+
+    vector_delete(tuple);
+}
+
+/*
+ * One seed per combination of the representatives of each argument while
+ * there are at most SEED_BUDGET of them. Beyond that each argument goes
+ * through its representatives alone, the others kept at their first one, up
+ * to SEED_BUDGET seeds as well: the fuzzer runs every seed before it starts.
+ */
+static void seed_product(Fuzzer* f,
+                         Vector* arg_types,
+                         Vector** arg_representatives,
+                         Vector* seeds)
+{
+    size_t arg_count = vector_length(arg_types);
+    size_t* idx = calloc(arg_count, sizeof(size_t));
+    if (!idx) return;
+
+    size_t combinations = 1;
+    for (size_t a = 0; a < arg_count && combinations <= SEED_BUDGET; a++) {
+        combinations *= vector_length(arg_representatives[a]);
+    }
+
+    if (combinations > SEED_BUDGET) {
+        size_t count = 1;
+        seed_push(f, arg_types, arg_representatives, idx, seeds);
+
+        for (size_t a = 0; a < arg_count; a++) {
+            for (size_t k = 1; k < vector_length(arg_representatives[a]) && count < SEED_BUDGET; k++, count++) {
+                idx[a] = k;
+                seed_push(f, arg_types, arg_representatives, idx, seeds);
+            }
+            idx[a] = 0;
+        }
+
+        free(idx);
+        return;
+    }
+
+    while (1) {
+        seed_push(f, arg_types, arg_representatives, idx, seeds);
+
+        size_t pos = arg_count - 1;
+        while (1) {
+            idx[pos]++;
+            if (idx[pos] < vector_length(arg_representatives[pos]))
+                break;
+            idx[pos] = 0;
+            if (pos == 0) goto done;
+            pos--;
+        }
+    }
+
+done:
+    free(idx);
+}
+
 Vector* generate_interval_seeds(Fuzzer* f,
                                 AbstractResult* abs,
                                 Vector* arg_types)
@@ -160,40 +252,46 @@ Vector* generate_interval_seeds(Fuzzer* f,
         }
     }
 
-    size_t* idx = calloc(arg_count, sizeof(size_t));
+    seed_product(f, arg_types, arg_representatives, all_seeds);
 
-    while (1) {
-        Vector* tuple = vector_new(sizeof(int));
-        for (size_t a = 0; a < arg_count; a++) {
-            int v = *(int*)vector_get(arg_representatives[a], idx[a]);
-            vector_push(tuple, &v);
-        }
+    for (size_t a = 0; a < arg_count; a++) {
+        vector_delete(arg_representatives[a]);
+    }
 
-        TestCase* tc = build_testcase_from_values(f, arg_types, tuple);
-        if (tc) {
-            corpus_add(f->corpus, tc);
-            vector_push(all_seeds, &tc);
-        }
+    free(arg_representatives);
+    return all_seeds;
+}
 
-        vector_delete(tuple);
+void generate_precondition_seeds(Fuzzer* f,
+                                 const Preconditions* preconditions,
+                                 Vector* arg_types,
+                                 Vector* seeds)
+{
+    size_t arg_count = vector_length(arg_types);
+    if (arg_count == 0 || !preconditions->conditions) return;
+    if ((size_t)preconditions->num_arguments != arg_count) return;
 
-        size_t pos = arg_count - 1;
-        while (1) {
-            idx[pos]++;
-            if (idx[pos] < vector_length(arg_representatives[pos]))
-                break;
-            idx[pos] = 0;
-            if (pos == 0) goto done;
-            pos--;
+    Vector** arg_representatives = calloc(arg_count, sizeof(Vector*));
+    if (!arg_representatives) return;
+
+    for (size_t i = 0; i < vector_length(preconditions->conditions); i++) {
+        Precondition* precondition = vector_get(preconditions->conditions, i);
+
+        for (size_t a = 0; a < arg_count; a++) {
+            arg_representatives[a] = interval_to_values(&precondition->arguments[a]);
+
+            if (vector_length(arg_representatives[a]) == 0) {
+                int zero = 0;
+                vector_push(arg_representatives[a], &zero);
+            }
         }
-    }
 
-    free(idx);
+        seed_product(f, arg_types, arg_representatives, seeds);
 
-    for (size_t a = 0; a < arg_count; a++) {
-        vector_delete(arg_representatives[a]);
+        for (size_t a = 0; a < arg_count; a++) {
+            vector_delete(arg_representatives[a]);
+        }
     }
 
     free(arg_representatives);
-    return all_seeds;
 }
@@ -0,0 +1,370 @@
+#include "invariants.h"
+
+#include "common.h"
+#include "log.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A state is stored as a header interval { num_locals, stack_len } followed
+ * by its slots, back to back in pool. Every (function, pc) entry holds the
+ * offset of its state in pool, -1 if the instruction is unreachable.
+ */
+typedef struct {
+    const IrFunction* function;
+    int base; // index of pc 0 in entries
+    int count;
+} InvariantFunction;
+
+struct InvariantStore {
+    Vector* functions; // Vector<InvariantFunction>
+    int* entries;
+    int entries_count;
+    Vector* pool; // Vector<Interval>
+    size_t distinct;
+    // until sealed, states joined per entry
+    IntervalState** pending;
+    int* pending_locals;
+    bool sealed;
+};
+
+InvariantStore* invariant_store_new(void)
+{
+    InvariantStore* store = calloc(1, sizeof(InvariantStore));
+    if (!store) {
+        return NULL;
+    }
+
+    store->functions = vector_new(sizeof(InvariantFunction));
+    store->pool = vector_new(sizeof(Interval));
+
+    if (!store->functions || !store->pool) {
+        invariant_store_delete(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+int invariant_store_function(const InvariantStore* store, const IrFunction* function)
+{
+    if (!store) {
+        return -1;
+    }
+
+    // a method and the few it calls
+    for (size_t i = 0; i < vector_length(store->functions); i++) {
+        InvariantFunction* it = vector_get(store->functions, i);
+        if (it->function == function) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int invariant_store_functions(const InvariantStore* store)
+{
+    return store ? vector_length(store->functions) : 0;
+}
+
+const IrFunction* invariant_store_function_ir(const InvariantStore* store, int function)
+{
+    if (!store || function < 0 || function >= (int)vector_length(store->functions)) {
+        return NULL;
+    }
+
+    return ((InvariantFunction*)vector_get(store->functions, function))->function;
+}
+
+static int add_function(InvariantStore* store, const IrFunction* function)
+{
+    int count = vector_length(function->ir_instructions);
+    int total = store->entries_count + count;
+
+    int* entries = realloc(store->entries, sizeof(int) * total);
+    if (!entries) {
+        return -1;
+    }
+    store->entries = entries;
+
+    IntervalState** pending = realloc(store->pending, sizeof(IntervalState*) * total);
+    if (!pending) {
+        return -1;
+    }
+    store->pending = pending;
+
+    int* pending_locals = realloc(store->pending_locals, sizeof(int) * total);
+    if (!pending_locals) {
+        return -1;
+    }
+    store->pending_locals = pending_locals;
+
+    for (int i = store->entries_count; i < total; i++) {
+        store->entries[i] = -1;
+        store->pending[i] = NULL;
+        store->pending_locals[i] = 0;
+    }
+
+    InvariantFunction entry = { .function = function, .base = store->entries_count, .count = count };
+    if (vector_push(store->functions, &entry)) {
+        return -1;
+    }
+
+    store->entries_count = total;
+    return vector_length(store->functions) - 1;
+}
+
+int invariant_store_add(InvariantStore* store, const IrFunction* function, int pc, int num_locals, const IntervalState* state)
+{
+    if (!store || store->sealed || !function || !state) {
+        return FAILURE;
+    }
+
+    if (is_interval_state_bottom(state)) {
+        return SUCCESS;
+    }
+
+    int index = invariant_store_function(store, function);
+    if (index == -1) {
+        index = add_function(store, function);
+        if (index == -1) {
+            return FAILURE;
+        }
+    }
+
+    InvariantFunction* it = vector_get(store->functions, index);
+    if (pc < 0 || pc >= it->count) {
+        return FAILURE;
+    }
+
+    int entry = it->base + pc;
+    if (!store->pending[entry]) {
+        store->pending[entry] = interval_new_bottom_state(state->max_locals, state->max_stack);
+        if (!store->pending[entry]) {
+            return FAILURE;
+        }
+    }
+
+    int dummy = 0;
+    store->pending_locals[entry] = MAX(store->pending_locals[entry], num_locals);
+    return interval_join(store->pending[entry], state, &dummy);
+}
+
+static int encoded_length(const Interval* encoded)
+{
+    return 1 + encoded->lower + encoded->upper;
+}
+
+static void encode(const IntervalState* state, int num_locals, Interval* encoded)
+{
+    encoded[0] = (Interval) { num_locals, state->stack_len };
+
+    for (int i = 0; i < num_locals; i++) {
+        encoded[1 + i] = state->slots[i];
+    }
+
+    for (int i = 0; i < state->stack_len; i++) {
+        encoded[1 + num_locals + i] = state->slots[state->max_locals + i];
+    }
+}
+
+static uint64_t encoded_hash(const Interval* encoded)
+{
+    return hash_bytes(HASH_SEED, encoded, sizeof(Interval) * encoded_length(encoded));
+}
+
+/*
+ * Moves the joined states into the pool. Equal states are found through an
+ * open addressing table of pool offsets and stored once.
+ */
+int invariant_store_seal(InvariantStore* store)
+{
+    if (!store || store->sealed) {
+        return FAILURE;
+    }
+
+    int result = FAILURE;
+    int capacity = 16;
+    while (capacity < 2 * store->entries_count) {
+        capacity *= 2;
+    }
+
+    int* table = malloc(sizeof(int) * capacity);
+    Interval* encoded = NULL;
+    int encoded_capacity = 0;
+
+    if (!table) {
+        goto cleanup;
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        table[i] = -1;
+    }
+
+    for (int entry = 0; entry < store->entries_count; entry++) {
+        IntervalState* state = store->pending[entry];
+        if (!state) {
+            continue;
+        }
+
+        int num_locals = MIN(store->pending_locals[entry], state->max_locals);
+        int length = 1 + num_locals + state->stack_len;
+
+        if (length > encoded_capacity) {
+            Interval* grown = realloc(encoded, sizeof(Interval) * length);
+            if (!grown) {
+                goto cleanup;
+            }
+            encoded = grown;
+            encoded_capacity = length;
+        }
+
+        encode(state, num_locals, encoded);
+
+        size_t bucket = encoded_hash(encoded) & (capacity - 1);
+        int offset = -1;
+
+        while (table[bucket] != -1) {
+            Interval* stored = vector_get(store->pool, table[bucket]);
+            if (encoded_length(stored) == length && memcmp(stored, encoded, sizeof(Interval) * length) == 0) {
+                offset = table[bucket];
+                break;
+            }
+            bucket = (bucket + 1) & (capacity - 1);
+        }
+
+        if (offset == -1) {
+            offset = vector_length(store->pool);
+            for (int i = 0; i < length; i++) {
+                if (vector_push(store->pool, &encoded[i])) {
+                    goto cleanup;
+                }
+            }
+
+            table[bucket] = offset;
+            store->distinct++;
+        }
+
+        store->entries[entry] = offset;
+    }
+
+    result = SUCCESS;
+
+cleanup:
+    for (int entry = 0; entry < store->entries_count; entry++) {
+        interval_state_delete(store->pending[entry]);
+    }
+    free(store->pending);
+    free(store->pending_locals);
+    store->pending = NULL;
+    store->pending_locals = NULL;
+    store->sealed = true;
+
+    free(table);
+    free(encoded);
+
+    return result;
+}
+
+// header of the state before pc, NULL if it is unreachable or out of range
+static const Interval* state_at(const InvariantStore* store, int function, int pc)
+{
+    if (!store || !store->sealed || function < 0 || function >= (int)vector_length(store->functions)) {
+        return NULL;
+    }
+
+    InvariantFunction* it = vector_get(store->functions, function);
+    if (pc < 0 || pc >= it->count) {
+        return NULL;
+    }
+
+    int offset = store->entries[it->base + pc];
+    return offset == -1 ? NULL : vector_get(store->pool, offset);
+}
+
+// -1 if pc is never reached
+int invariant_store_slots(const InvariantStore* store, int function, int pc)
+{
+    const Interval* header = state_at(store, function, pc);
+    return header ? header->lower + header->upper : -1;
+}
+
+int invariant_store_locals(const InvariantStore* store, int function, int pc)
+{
+    const Interval* header = state_at(store, function, pc);
+    return header ? header->lower : -1;
+}
+
+// bottom, and FAILURE, when pc is never reached or slot does not exist there
+int invariant_store_get(const InvariantStore* store, int function, int pc, int slot, Interval* interval)
+{
+    const Interval* header = state_at(store, function, pc);
+
+    if (!header || slot < 0 || slot >= header->lower + header->upper) {
+        *interval = interval_bottom();
+        return FAILURE;
+    }
+
+    *interval = header[1 + slot];
+    return SUCCESS;
+}
+
+size_t invariant_store_distinct(const InvariantStore* store)
+{
+    return store ? store->distinct : 0;
+}
+
+void invariant_store_print(const InvariantStore* store)
+{
+    if (!store || !store->sealed) {
+        return;
+    }
+
+    LOG_INFO("=== INVARIANTS: %zu distinct states ===", store->distinct);
+
+    for (size_t f = 0; f < vector_length(store->functions); f++) {
+        InvariantFunction* it = vector_get(store->functions, f);
+        LOG_INFO("Function %zu:", f);
+
+        for (int pc = 0; pc < it->count; pc++) {
+            const Interval* header = state_at(store, f, pc);
+            if (!header) {
+                continue;
+            }
+
+            char line[512];
+            int used = snprintf(line, sizeof(line), "  pc %d:", pc);
+
+            for (int slot = 0; slot < header->lower + header->upper && used < (int)sizeof(line); slot++) {
+                Interval iv = header[1 + slot];
+                used += snprintf(line + used, sizeof(line) - used, "%s[%d, %d]",
+                    slot == header->lower ? " | " : " ", iv.lower, iv.upper);
+            }
+
+            LOG_INFO("%s", line);
+        }
+    }
+}
+
+void invariant_store_delete(InvariantStore* store)
+{
+    if (!store) {
+        return;
+    }
+
+    for (int entry = 0; store->pending && entry < store->entries_count; entry++) {
+        interval_state_delete(store->pending[entry]);
+    }
+    free(store->pending);
+    free(store->pending_locals);
+
+    vector_delete(store->functions);
+    vector_delete(store->pool);
+    free(store->entries);
+    free(store);
+}
@@ -4,10 +4,42 @@
 #include "ir_function.h"
 
 #include "cJSON/cJSON.h"
+#include "common.h"
 #include "ir_instruction.h"
 #include "log.h"
 #include "method.h"
 
+/*
+ * Frame size of a method whose code lacks max_locals / max_stack: every local
+ * index used, and one stack slot per instruction, which no verified method
+ * exceeds.
+ */
+static void frame_size_from_bytecode(IrFunction* ir_function)
+{
+    int max_locals = 0;
+    int count = vector_length(ir_function->ir_instructions);
+
+    for (int i = 0; i < count; i++) {
+        IrInstruction* ir = *(IrInstruction**)vector_get(ir_function->ir_instructions, i);
+
+        if (ir->opcode == OP_LOAD) {
+            max_locals = MAX(max_locals, ir->data.load.index + 1);
+        } else if (ir->opcode == OP_STORE) {
+            max_locals = MAX(max_locals, ir->data.store.index + 1);
+        } else if (ir->opcode == OP_INCR) {
+            max_locals = MAX(max_locals, ir->data.incr.index + 1);
+        }
+    }
+
+    if (ir_function->max_locals < 0) {
+        ir_function->max_locals = max_locals;
+    }
+
+    if (ir_function->max_stack < 0) {
+        ir_function->max_stack = count;
+    }
+}
+
 static IrFunction*
 parse_bytecode(cJSON* method)
 {
@@ -31,6 +63,12 @@ parse_bytecode(cJSON* method)
         goto cleanup;
     }
 
+    cJSON* max_locals = cJSON_GetObjectItem(code, "max_locals");
+    cJSON* max_stack = cJSON_GetObjectItem(code, "max_stack");
+
+    ir_function->max_locals = cJSON_IsNumber(max_locals) ? (int)cJSON_GetNumberValue(max_locals) : -1;
+    ir_function->max_stack = cJSON_IsNumber(max_stack) ? (int)cJSON_GetNumberValue(max_stack) : -1;
+
     cJSON* buffer;
     int i = 0;
 
@@ -48,6 +86,8 @@ parse_bytecode(cJSON* method)
         i++;
     }
 
+    frame_size_from_bytecode(ir_function);
+
     return ir_function;
 
 cleanup:
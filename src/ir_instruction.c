@@ -2,6 +2,7 @@
 #include <string.h>
 #include "ir_instruction.h"
 #include "cJSON/cJSON.h"
+#include "common.h"
 #include "log.h"
 
 #include <stdlib.h>
@@ -652,6 +653,73 @@ int ir_instruction_is_conditional(IrInstruction* ir_instruction)
     return ir_instruction->opcode == OP_IF || ir_instruction->opcode == OP_IF_ZERO;
 }
 
+static uint64_t type_hash(uint64_t hash, const Type* type)
+{
+    for (; type; type = type->kind == TK_ARRAY ? type->array.element_type : NULL) {
+        hash = hash_int(hash, type->kind);
+    }
+
+    return hash_int(hash, -1);
+}
+
+/*
+ * Content of the instruction, its position (seq) excluded: jump targets are
+ * hashed, so moving code that is jumped over still changes the hash.
+ */
+uint64_t ir_instruction_hash(uint64_t hash, const IrInstruction* ir)
+{
+    hash = hash_int(hash, ir->opcode);
+
+    switch (ir->opcode) {
+    case OP_LOAD:
+        hash = hash_int(hash, ir->data.load.index);
+        return type_hash(hash, ir->data.load.type);
+    case OP_PUSH:
+        hash = type_hash(hash, ir->data.push.value.type);
+        return hash_int(hash, ir->data.push.value.data.int_value);
+    case OP_BINARY:
+        hash = hash_int(hash, ir->data.binary.op);
+        return type_hash(hash, ir->data.binary.type);
+    case OP_RETURN:
+        return type_hash(hash, ir->data.ret.type);
+    case OP_IF_ZERO:
+    case OP_IF:
+        hash = hash_int(hash, ir->data.ift.condition);
+        return hash_int(hash, ir->data.ift.target);
+    case OP_INVOKE:
+        hash = hash_string(hash, ir->data.invoke.ref_name);
+        hash = hash_string(hash, ir->data.invoke.method_name);
+        for (int i = 0; i < ir->data.invoke.args_len; i++) {
+            hash = type_hash(hash, ir->data.invoke.args[i]);
+        }
+        return type_hash(hash, ir->data.invoke.return_type);
+    case OP_STORE:
+        hash = hash_int(hash, ir->data.store.index);
+        return type_hash(hash, ir->data.store.type);
+    case OP_GOTO:
+        return hash_int(hash, ir->data.go2.target);
+    case OP_CAST:
+        hash = type_hash(hash, ir->data.cast.from);
+        return type_hash(hash, ir->data.cast.to);
+    case OP_DUP:
+        return hash_int(hash, ir->data.dup.words);
+    case OP_NEW_ARRAY:
+        hash = hash_int(hash, ir->data.new_array.dim);
+        return type_hash(hash, ir->data.new_array.type);
+    case OP_ARRAY_LOAD:
+        return type_hash(hash, ir->data.array_load.type);
+    case OP_ARRAY_STORE:
+        return type_hash(hash, ir->data.array_store.type);
+    case OP_INCR:
+        hash = hash_int(hash, ir->data.incr.index);
+        return hash_int(hash, ir->data.incr.amount);
+    case OP_NEGATE:
+        return type_hash(hash, ir->data.negate.type);
+    default:
+        return hash;
+    }
+}
+
 void ir_instruction_delete(IrInstruction* instr)
 {
     if (!instr)
@@ -2,7 +2,10 @@
 #include <string.h>
 
 #include "ir_program.h"
+#include "common.h"
+#include "ir_instruction.h"
 #include "log.h"
+#include "utils.h"
 
 #include <pthread.h>
 #include <stdlib.h>
@@ -14,6 +17,7 @@ struct IRItem {
     IrFunction* ir_function;
     Cfg* cfg;
     int num_locals;
+    uint64_t hash; // ir of the method and of its callees, 0 until computed
     IRItem* next;
 };
 
@@ -53,6 +57,7 @@ static IRItem* build_item(const Method* m, const Config* cfg)
     it->ir_function = ir_function_build(m, cfg);
     it->num_locals = vector_length(method_get_arguments_as_types(m));
     it->cfg = cfg_build(it->ir_function, it->num_locals);
+    it->hash = 0;
 
     it->next = it_map;
 
@@ -123,11 +128,6 @@ int ir_program_get_num_locals(const Method* m, const Config* cfg)
 {
     const char* id = method_get_id(m);
 
-    IRItem* item = find_item(id);
-    if (item) {
-        return item->num_locals;
-    }
-
     int result = -1;
 
 #pragma omp critical(ir_program_map)
@@ -148,6 +148,122 @@ int ir_program_get_num_locals(const Method* m, const Config* cfg)
     return result;
 }
 
+/*
+ * Hash of the ir of m mixed with the hashes of the jpamb methods it calls,
+ * the ones cfg_inline can inline. A call back into a method being hashed only
+ * mixes how far up the stack it goes; hashes depending on such a call are not
+ * memoized unless the target is the method itself, since they would differ if
+ * the cycle were entered elsewhere. Returns the lowest stack depth the hash
+ * depends on.
+ */
+static int compute_hash(const Method* m, const Config* cfg, Vector* stack, uint64_t* hash)
+{
+    const char* id = method_get_id(m);
+    int depth = vector_length(stack);
+    int lowest = depth;
+
+    for (int i = 0; i < depth; i++) {
+        if (strcmp(*(char**)vector_get(stack, i), id) == 0) {
+            *hash = hash_int(HASH_SEED, depth - i);
+            return i;
+        }
+    }
+
+    uint64_t memo = 0;
+#pragma omp critical(ir_program_map)
+    {
+        IRItem* item = find_item(id);
+        if (item) {
+            memo = item->hash;
+        }
+    }
+
+    if (memo) {
+        *hash = memo;
+        return depth;
+    }
+
+    IrFunction* ir_function = ir_program_get_function_ir(m, cfg);
+    if (!ir_function) {
+        *hash = hash_string(HASH_SEED, id);
+        return depth;
+    }
+
+    uint64_t h = hash_string(HASH_SEED, id);
+    vector_push(stack, &id);
+
+    for (size_t i = 0; i < vector_length(ir_function->ir_instructions); i++) {
+        IrInstruction* ir = *(IrInstruction**)vector_get(ir_function->ir_instructions, i);
+        h = ir_instruction_hash(h, ir);
+
+        if (ir->opcode != OP_INVOKE) {
+            continue;
+        }
+
+        char* callee_id = get_method_signature(&ir->data.invoke);
+        if (callee_id && strncmp(callee_id, "jpamb.", strlen("jpamb.")) == 0) {
+            Method* callee = method_create(callee_id);
+            if (callee) {
+                uint64_t callee_hash = 0;
+                lowest = MIN(lowest, compute_hash(callee, cfg, stack, &callee_hash));
+                h = hash_bytes(h, &callee_hash, sizeof(callee_hash));
+                method_delete(callee);
+            }
+        }
+        free(callee_id);
+    }
+
+    vector_pop(stack, NULL);
+
+    // 0 marks a hash not computed yet
+    h = h ? h : 1;
+    *hash = h;
+
+    if (lowest >= depth) {
+#pragma omp critical(ir_program_map)
+        {
+            IRItem* item = find_item(id);
+            if (item) {
+                item->hash = h;
+            }
+        }
+    }
+
+    return lowest;
+}
+
+uint64_t ir_program_get_hash(const Method* m, const Config* cfg)
+{
+    uint64_t hash = 0;
+    Vector* stack = vector_new(sizeof(char*));
+    if (!stack) {
+        return 0;
+    }
+
+    compute_hash(m, cfg, stack, &hash);
+    vector_delete(stack);
+
+    return hash;
+}
+
+// id of the method ir_function was built for, NULL if it is not part of the program
+const char* ir_program_get_function_id(const IrFunction* ir_function)
+{
+    const char* result = NULL;
+
+#pragma omp critical(ir_program_map)
+    {
+        for (IRItem* it = it_map; it != NULL; it = it->next) {
+            if (it->ir_function == ir_function) {
+                result = it->method_id;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
 void ir_program_delete()
 {
     IRItem* current = it_map;
@@ -1,6 +1,8 @@
+#include "batch.h"
 #include "cli.h"
 #include "config.h"
 #include "coverage.h"
+#include "determinism.h"
 #include "domain_interval.h"
 #include "fuzzer.h"
 #include "info.h"
@@ -10,7 +12,10 @@
 #include "log.h"
 #include "method.h"
 #include "outcome.h"
+#include "precondition.h"
+#include "result_cache.h"
 #include "vector.h"
+#include "verdict.h"
 
 #include "tree_sitter/api.h"
 #include "utils.h"
@@ -61,6 +66,18 @@ int main(int argc, char** argv)
         goto cleanup;
     }
 
+    if (cfg->cache) {
+        result_cache_load(cfg->cache);
+    }
+
+    /*** BATCH ***/
+    if (opts.batch) {
+        if (batch_run(opts.method_id, &opts, cfg)) {
+            result = 3;
+        }
+        goto cleanup;
+    }
+
     /*** METHOD ***/
     m = method_create(opts.method_id);
     if (!m) {
@@ -87,6 +104,10 @@ int main(int argc, char** argv)
     /*** MODES ***/
     if (opts.interpreter_only) {
         run_interpreter(m, opts, cfg);
+    } else if (opts.determinism) {
+        if (determinism_check(m, &opts, cfg)) {
+            result = 6;
+        }
     } else if (opts.abstract_only) {
         AbstractContext* abstract_context = interpreter_abstract_setup(m, &opts, cfg);
 
@@ -123,6 +144,10 @@ int main(int argc, char** argv)
     }
 
 cleanup:
+    if (cfg && cfg->cache) {
+        result_cache_save(cfg->cache);
+    }
+    result_cache_delete();
     ir_program_delete();
     // ts_tree_delete(tree);
     method_delete(m);
@@ -189,12 +214,44 @@ void run_fuzzer(const Method* m, Options opts, const Config* cfg)
         return;
     }
 
-    AbstractContext* abs_ctx = interpreter_abstract_setup(m, &opts, cfg);
+    // the verdicts read the state before every instruction
+    Config abs_cfg = *cfg;
+    abs_cfg.invariants = true;
+
+    AbstractContext* abs_ctx = interpreter_abstract_setup(m, &opts, &abs_cfg);
     AbstractResult abs_result = interpreter_abstract_run(abs_ctx);
 
+    Verdicts verdicts = { 0 };
+    verdict_compute(m, cfg, &abs_result, &verdicts);
+    verdict_print(&verdicts);
+
+    // every outcome is proven, nothing left to fuzz
+    if (verdict_decided(&verdicts)) {
+        print_outcome(verdict_outcome(&verdicts));
+        verdict_delete(&verdicts);
+        abstract_result_delete(&abs_result);
+        vector_delete(arg_types);
+        coverage_reset_all();
+        return;
+    }
+
+    uint8_t* goal = calloc(instruction_count, sizeof(uint8_t));
+    if (goal && verdict_fuzz_goal(&verdicts, goal, instruction_count)) {
+        coverage_set_goal(goal);
+    }
+    free(goal);
+
+    // the arguments that can still reach the sites left unknown
+    Preconditions preconditions = { 0 };
+    precondition_compute(m, cfg, &abs_result, &verdicts, &preconditions);
+    precondition_print(&preconditions);
+    verdict_delete(&verdicts);
+
     Fuzzer* f = fuzzer_init(instruction_count, arg_types);
     if (!f) {
         LOG_ERROR("Fuzzer init failed.");
+        precondition_delete(&preconditions);
+        abstract_result_delete(&abs_result);
         vector_delete(arg_types);
         coverage_reset_all();
         return;
@@ -207,6 +264,8 @@ void run_fuzzer(const Method* m, Options opts, const Config* cfg)
 #endif
 
     Vector* interval_seeds = generate_interval_seeds(f, &abs_result, arg_types);
+    generate_precondition_seeds(f, &preconditions, arg_types, interval_seeds);
+    precondition_delete(&preconditions);
 
     printf("arg_types count = %zu\n", vector_length(arg_types));
     for (size_t i = 0; i < vector_length(arg_types); i++) {
@@ -221,6 +280,7 @@ void run_fuzzer(const Method* m, Options opts, const Config* cfg)
     printf("Instructions covered: %zu / %zu\n", covered, instruction_count);
 
     fuzzer_free(f);
+    abstract_result_delete(&abs_result);
     vector_delete(arg_types);
     vector_delete(results);
 
@@ -0,0 +1,629 @@
+#include "precondition.h"
+
+#include "common.h"
+#include "invariants.h"
+#include "ir_instruction.h"
+#include "ir_program.h"
+#include "log.h"
+#include "opcode.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRECONDITION_VISITS 8 // joins at a pc before its state is left to the invariant
+
+/*
+ * need[pc] holds the states before pc from which the failure can be reached,
+ * as slots laid out like the invariants (locals, then the stack bottom first),
+ * NULL while none is known.
+ */
+typedef struct {
+    const InvariantStore* store;
+    const IrFunction* function;
+    int index; // of function in the store
+    int length;
+    Vector** predecessors; // Vector<int> per pc
+    Interval** need;
+    int* visits;
+    int* worklist;
+    bool* queued;
+    int pending;
+} Backward;
+
+static IrInstruction* instruction_at(const IrFunction* function, int pc)
+{
+    return *(IrInstruction**)vector_get(function->ir_instructions, pc);
+}
+
+static Interval meet(Interval a, Interval b)
+{
+    Interval r = { MAX(a.lower, b.lower), MIN(a.upper, b.upper) };
+    return r.lower > r.upper ? interval_bottom() : r;
+}
+
+// [lower, upper] as an int interval, false when it holds no int
+static bool make_interval(long lower, long upper, Interval* iv)
+{
+    lower = MAX(lower, INT_MIN);
+    upper = MIN(upper, INT_MAX);
+
+    if (lower > upper) {
+        return false;
+    }
+
+    *iv = (Interval) { (int)lower, (int)upper };
+    return true;
+}
+
+static int slots_at(const Backward* b, int pc)
+{
+    return invariant_store_slots(b->store, b->index, pc);
+}
+
+static int locals_at(const Backward* b, int pc)
+{
+    return invariant_store_locals(b->store, b->index, pc);
+}
+
+// the forward state before pc, false if the analysis never reaches it
+static bool load_invariant(const Backward* b, int pc, Interval* state)
+{
+    int slots = slots_at(b, pc);
+    if (slots == -1) {
+        return false;
+    }
+
+    for (int i = 0; i < slots; i++) {
+        if (invariant_store_get(b->store, b->index, pc, i, &state[i]) || is_interval_bottom(state[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*** TRANSFER ***/
+
+static IfCondition mirror_condition(IfCondition condition)
+{
+    switch (condition) {
+    case IF_GT:
+        return IF_LT;
+    case IF_LT:
+        return IF_GT;
+    case IF_GE:
+        return IF_LE;
+    case IF_LE:
+        return IF_GE;
+    default:
+        return condition;
+    }
+}
+
+static bool push_constant(const IrInstruction* ir, int* value)
+{
+    const Value* pushed = &ir->data.push.value;
+
+    if (pushed->type == TYPE_INT) {
+        *value = pushed->data.int_value;
+    } else if (pushed->type == TYPE_BOOLEAN) {
+        *value = pushed->data.bool_value;
+    } else if (pushed->type == TYPE_CHAR) {
+        *value = pushed->data.char_value;
+    } else if (pushed->type == TYPE_REFERENCE) {
+        *value = ARRAY_NULL;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Operands a and b of a binary operation whose result must be in r. Only
+ * additions and subtractions that cannot wrap around are inverted, the
+ * other operations keep their operands.
+ */
+static bool invert_binary(BinaryOperator op, Interval* a, Interval* b, Interval r)
+{
+    Interval ra, rb;
+
+    switch (op) {
+    case BO_ADD:
+        if ((long)a->lower + b->lower < INT_MIN || (long)a->upper + b->upper > INT_MAX) {
+            return true;
+        }
+        if (!make_interval((long)r.lower - b->upper, (long)r.upper - b->lower, &ra)
+            || !make_interval((long)r.lower - a->upper, (long)r.upper - a->lower, &rb)) {
+            return false;
+        }
+        break;
+    case BO_SUB:
+        if ((long)a->lower - b->upper < INT_MIN || (long)a->upper - b->lower > INT_MAX) {
+            return true;
+        }
+        if (!make_interval((long)r.lower + b->lower, (long)r.upper + b->upper, &ra)
+            || !make_interval((long)a->lower - r.upper, (long)a->upper - r.lower, &rb)) {
+            return false;
+        }
+        break;
+    default:
+        return true;
+    }
+
+    *a = meet(*a, ra);
+    *b = meet(*b, rb);
+
+    return !is_interval_bottom(*a) && !is_interval_bottom(*b);
+}
+
+/*
+ * State before pc from the one needed before next, its successor, met with
+ * the invariant already in pre. The first kept stack slots of both states are
+ * the ones the instruction does not touch. Returns false when no state before
+ * pc leads to the needed one.
+ */
+static bool step_back(const Backward* b, int pc, int next, Interval* pre)
+{
+    IrInstruction* ir = instruction_at(b->function, pc);
+    const Interval* post = b->need[next];
+
+    int pre_locals = locals_at(b, pc);
+    int post_locals = locals_at(b, next);
+    int locals = MIN(pre_locals, post_locals);
+    int pre_top = slots_at(b, pc) - 1;
+    int post_top = slots_at(b, next) - 1;
+    int written = -1; // local the instruction writes
+    int popped = 0, pushed = 0;
+
+    switch (ir->opcode) {
+    case OP_LOAD:
+        pushed = 1;
+        if (ir->data.load.index < locals) {
+            pre[ir->data.load.index] = meet(pre[ir->data.load.index], post[post_top]);
+        }
+        break;
+    case OP_PUSH: {
+        int value;
+        pushed = 1;
+        if (push_constant(ir, &value) && (value < post[post_top].lower || value > post[post_top].upper)) {
+            return false;
+        }
+        break;
+    }
+    case OP_STORE:
+        popped = 1;
+        written = ir->data.store.index;
+        if (written < locals) {
+            pre[pre_top] = meet(pre[pre_top], post[written]);
+        }
+        break;
+    case OP_INCR: {
+        written = ir->data.incr.index;
+        long amount = ir->data.incr.amount;
+        Interval before;
+
+        // an increment that may wrap around says nothing of the value before
+        if (written < locals && pre[written].lower + amount >= INT_MIN && pre[written].upper + amount <= INT_MAX) {
+            if (!make_interval(post[written].lower - amount, post[written].upper - amount, &before)) {
+                return false;
+            }
+            pre[written] = meet(pre[written], before);
+        }
+        break;
+    }
+    case OP_DUP:
+        if (ir->data.dup.words != 1) {
+            break;
+        }
+        pushed = 1;
+        pre[pre_top] = meet(pre[pre_top], meet(post[post_top], post[post_top - 1]));
+        break;
+    case OP_NEGATE: {
+        popped = pushed = 1;
+        Interval r = post[post_top];
+        if (r.lower != INT_MIN) {
+            pre[pre_top] = meet(pre[pre_top], (Interval) { -r.upper, -r.lower });
+        }
+        break;
+    }
+    case OP_BINARY:
+        popped = 2;
+        pushed = 1;
+        if (!invert_binary(ir->data.binary.op, &pre[pre_top - 1], &pre[pre_top], post[post_top])) {
+            return false;
+        }
+        break;
+    case OP_IF:
+    case OP_IF_ZERO: {
+        IfOP* ift = &ir->data.ift;
+        popped = ir->opcode == OP_IF ? 2 : 1;
+
+        Interval zero = { 0, 0 };
+        Interval* x = &pre[pre_top - popped + 1];
+        Interval* y = ir->opcode == OP_IF ? &pre[pre_top] : &zero;
+
+        // a branch to the next pc says nothing of its operands
+        if (ift->target != pc + 1) {
+            bool taken = next == ift->target;
+            Interval tx, fx, ty, fy;
+
+            interval_branch(ift->condition, x, y, &tx, &fx);
+            interval_branch(mirror_condition(ift->condition), y, x, &ty, &fy);
+
+            *x = taken ? tx : fx;
+            *y = taken ? ty : fy;
+            if (is_interval_bottom(*x) || is_interval_bottom(*y)) {
+                return false;
+            }
+        }
+        break;
+    }
+    case OP_GOTO:
+        break;
+    default:
+        // the locals are left alone, the stack is the invariant one
+        for (int i = 0; i < locals; i++) {
+            pre[i] = meet(pre[i], post[i]);
+            if (is_interval_bottom(pre[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    for (int i = 0; i < locals; i++) {
+        if (i != written) {
+            pre[i] = meet(pre[i], post[i]);
+        }
+    }
+
+    // the stack below the operands, when both states agree on its depth
+    int kept = pre_top + 1 - pre_locals - popped;
+    if (kept >= 0 && kept == post_top + 1 - post_locals - pushed) {
+        for (int i = 0; i < kept; i++) {
+            pre[pre_locals + i] = meet(pre[pre_locals + i], post[post_locals + i]);
+        }
+    }
+
+    for (int i = 0; i <= pre_top; i++) {
+        if (is_interval_bottom(pre[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*** BACKWARD ***/
+
+static void backward_push(Backward* b, int pc)
+{
+    if (!b->queued[pc]) {
+        b->queued[pc] = true;
+        b->worklist[b->pending++] = pc;
+    }
+}
+
+static void add_predecessor(Backward* b, int pc, int next)
+{
+    if (next >= 0 && next < b->length) {
+        vector_push(b->predecessors[next], &pc);
+    }
+}
+
+static int backward_init(Backward* b, const InvariantStore* store, const IrFunction* function)
+{
+    memset(b, 0, sizeof(*b));
+    b->store = store;
+    b->function = function;
+    b->index = invariant_store_function(store, function);
+    b->length = vector_length(function->ir_instructions);
+
+    b->predecessors = calloc(b->length, sizeof(Vector*));
+    b->need = calloc(b->length, sizeof(Interval*));
+    b->visits = calloc(b->length, sizeof(int));
+    b->worklist = malloc(sizeof(int) * b->length);
+    b->queued = calloc(b->length, sizeof(bool));
+
+    if (!b->predecessors || !b->need || !b->visits || !b->worklist || !b->queued) {
+        return FAILURE;
+    }
+
+    for (int pc = 0; pc < b->length; pc++) {
+        b->predecessors[pc] = vector_new(sizeof(int));
+        if (!b->predecessors[pc]) {
+            return FAILURE;
+        }
+    }
+
+    for (int pc = 0; pc < b->length; pc++) {
+        IrInstruction* ir = instruction_at(function, pc);
+
+        if (ir->opcode == OP_GOTO) {
+            add_predecessor(b, pc, ir->data.go2.target);
+            continue;
+        }
+
+        if (ir->opcode == OP_RETURN || ir->opcode == OP_THROW) {
+            continue;
+        }
+
+        if (ir->opcode == OP_IF || ir->opcode == OP_IF_ZERO) {
+            add_predecessor(b, pc, ir->data.ift.target);
+        }
+
+        // a branch to the next pc has a single edge
+        if ((ir->opcode != OP_IF && ir->opcode != OP_IF_ZERO) || ir->data.ift.target != pc + 1) {
+            add_predecessor(b, pc, pc + 1);
+        }
+    }
+
+    return SUCCESS;
+}
+
+static void backward_reset(Backward* b)
+{
+    for (int pc = 0; pc < b->length; pc++) {
+        free(b->need[pc]);
+        b->need[pc] = NULL;
+        b->visits[pc] = 0;
+        b->queued[pc] = false;
+    }
+
+    b->pending = 0;
+}
+
+static void backward_delete(Backward* b)
+{
+    for (int pc = 0; b->predecessors && pc < b->length; pc++) {
+        vector_delete(b->predecessors[pc]);
+    }
+
+    if (b->need) {
+        backward_reset(b);
+    }
+
+    free(b->predecessors);
+    free(b->need);
+    free(b->visits);
+    free(b->worklist);
+    free(b->queued);
+}
+
+// joins state into need[pc], which falls back to the invariant after a few joins
+static int backward_join(Backward* b, int pc, Interval* state)
+{
+    int slots = slots_at(b, pc);
+
+    if (!b->need[pc]) {
+        b->need[pc] = malloc(sizeof(Interval) * MAX(slots, 1));
+        if (!b->need[pc]) {
+            return FAILURE;
+        }
+
+        memcpy(b->need[pc], state, sizeof(Interval) * slots);
+        backward_push(b, pc);
+        return SUCCESS;
+    }
+
+    bool changed = false;
+    for (int i = 0; i < slots; i++) {
+        Interval joined = interval_join_single(b->need[pc][i], state[i]);
+        changed |= joined.lower != b->need[pc][i].lower || joined.upper != b->need[pc][i].upper;
+        b->need[pc][i] = joined;
+    }
+
+    if (changed && ++b->visits[pc] > PRECONDITION_VISITS) {
+        load_invariant(b, pc, b->need[pc]);
+    }
+
+    if (changed) {
+        backward_push(b, pc);
+    }
+
+    return SUCCESS;
+}
+
+/*
+ * The failure condition of a site on the state before it, false when the
+ * state cannot fail there. An index fails below 0 or from the shortest length
+ * on, the interval keeps both sides, and bounds the length when it cannot be
+ * negative.
+ */
+static bool fail_at(const IrInstruction* ir, outcome kind, Interval* state, int top)
+{
+    int array = top, index = top;
+
+    switch (ir->opcode) {
+    case OP_BINARY:
+        state[top] = meet(state[top], (Interval) { 0, 0 });
+        return !is_interval_bottom(state[top]);
+    case OP_ARRAY_LOAD:
+        array = top - 1;
+        index = top;
+        break;
+    case OP_ARRAY_STORE:
+        array = top - 2;
+        index = top - 1;
+        break;
+    case OP_ARRAY_LENGTH:
+        array = top;
+        break;
+    default:
+        return true;
+    }
+
+    if (kind == OC_NULL_POINTER) {
+        state[array] = meet(state[array], (Interval) { ARRAY_NULL, ARRAY_NULL });
+        return !is_interval_bottom(state[array]);
+    }
+
+    state[array] = meet(state[array], (Interval) { 0, INT_MAX });
+    if (is_interval_bottom(state[array])) {
+        return false;
+    }
+
+    Interval low = meet(state[index], (Interval) { INT_MIN, -1 });
+    Interval high = meet(state[index], (Interval) { state[array].lower, INT_MAX });
+
+    state[index] = interval_join_single(low, high);
+    if (is_interval_bottom(state[index])) {
+        return false;
+    }
+
+    // a non negative index fails only on arrays no longer than it
+    if (is_interval_bottom(low)) {
+        state[array] = meet(state[array], (Interval) { 0, state[index].upper });
+    }
+
+    return true;
+}
+
+/*
+ * Runs the backward analysis from the site to the entry, arguments receives
+ * the state of the arguments there. Returns false if the entry cannot reach
+ * the failure.
+ */
+static bool backward_run(Backward* b, const VerdictSite* site, Interval* arguments, int num_arguments, Interval* scratch)
+{
+    backward_reset(b);
+
+    if (!load_invariant(b, site->pc, scratch)
+        || !fail_at(instruction_at(b->function, site->pc), site->kind, scratch, slots_at(b, site->pc) - 1)) {
+        return false;
+    }
+
+    if (backward_join(b, site->pc, scratch)) {
+        return false;
+    }
+
+    while (b->pending) {
+        int pc = b->worklist[--b->pending];
+        b->queued[pc] = false;
+
+        Vector* predecessors = b->predecessors[pc];
+        for (size_t i = 0; i < vector_length(predecessors); i++) {
+            int previous = *(int*)vector_get(predecessors, i);
+
+            if (!load_invariant(b, previous, scratch) || !step_back(b, previous, pc, scratch)) {
+                continue;
+            }
+
+            if (backward_join(b, previous, scratch)) {
+                return false;
+            }
+        }
+    }
+
+    if (!b->need[0]) {
+        return false;
+    }
+
+    for (int i = 0; i < num_arguments; i++) {
+        arguments[i] = i < locals_at(b, 0) ? b->need[0][i] : interval_top();
+    }
+
+    return true;
+}
+
+/*** PRECONDITIONS ***/
+
+int precondition_compute(const Method* m, const Config* cfg, const AbstractResult* result, const Verdicts* verdicts, Preconditions* preconditions)
+{
+    int status = FAILURE;
+    Backward b = { 0 };
+    Interval* scratch = NULL;
+
+    memset(preconditions, 0, sizeof(*preconditions));
+
+    Vector* arg_types = method_get_arguments_as_types(m);
+    preconditions->conditions = vector_new(sizeof(Precondition));
+    if (!arg_types || !preconditions->conditions) {
+        goto cleanup;
+    }
+    preconditions->num_arguments = vector_length(arg_types);
+
+    const InvariantStore* store = result ? result->invariants : NULL;
+    const IrFunction* entry = ir_program_get_function_ir(m, cfg);
+    if (!store || !entry || invariant_store_function(store, entry) == -1 || !verdicts->sites) {
+        status = SUCCESS;
+        goto cleanup;
+    }
+
+    if (backward_init(&b, store, entry)) {
+        goto cleanup;
+    }
+
+    int max_slots = 1;
+    for (int pc = 0; pc < b.length; pc++) {
+        max_slots = MAX(max_slots, slots_at(&b, pc));
+    }
+
+    scratch = malloc(sizeof(Interval) * max_slots);
+    if (!scratch) {
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < vector_length(verdicts->sites); i++) {
+        const VerdictSite* site = vector_get(verdicts->sites, i);
+        if (site->verdict != VERDICT_UNKNOWN || site->function != entry) {
+            continue;
+        }
+
+        Precondition precondition = {
+            .pc = site->pc,
+            .kind = site->kind,
+            .arguments = malloc(sizeof(Interval) * MAX(preconditions->num_arguments, 1)),
+        };
+
+        if (!precondition.arguments) {
+            goto cleanup;
+        }
+
+        if (!backward_run(&b, site, precondition.arguments, preconditions->num_arguments, scratch)
+            || vector_push(preconditions->conditions, &precondition)) {
+            free(precondition.arguments);
+        }
+    }
+
+    status = SUCCESS;
+
+cleanup:
+    if (status != SUCCESS) {
+        LOG_ERROR("While computing the preconditions");
+    }
+
+    backward_delete(&b);
+    free(scratch);
+    vector_delete(arg_types);
+
+    return status;
+}
+
+void precondition_print(const Preconditions* preconditions)
+{
+    for (size_t i = 0; preconditions->conditions && i < vector_length(preconditions->conditions); i++) {
+        Precondition* precondition = vector_get(preconditions->conditions, i);
+        LOG_INFO("Precondition of pc %d, outcome %d:", precondition->pc, precondition->kind);
+
+        for (int a = 0; a < preconditions->num_arguments; a++) {
+            LOG_INFO("  argument %d in [%d, %d]", a, precondition->arguments[a].lower, precondition->arguments[a].upper);
+        }
+    }
+}
+
+void precondition_delete(Preconditions* preconditions)
+{
+    if (!preconditions) {
+        return;
+    }
+
+    for (size_t i = 0; preconditions->conditions && i < vector_length(preconditions->conditions); i++) {
+        free(((Precondition*)vector_get(preconditions->conditions, i))->arguments);
+    }
+
+    vector_delete(preconditions->conditions);
+    preconditions->conditions = NULL;
+}
@@ -0,0 +1,655 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+
+#include "result_cache.h"
+
+#include "common.h"
+#include "invariants.h"
+#include "ir_program.h"
+#include "log.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+// state before a reachable instruction, slots as in InvariantStore
+typedef struct {
+    int pc;
+    int num_locals;
+    int stack_len;
+    Interval* slots;
+} CachedInvariant;
+
+// ir functions are rebuilt from their method id by each run
+typedef struct {
+    char* method_id;
+    Vector* invariants; // Vector<CachedInvariant>
+} CachedFunction;
+
+typedef struct CacheItem CacheItem;
+struct CacheItem {
+    char* method_id;
+    uint64_t hash;
+    uint64_t shape; // inlined cfg layout and frame size, heads are only valid on the same one
+    AbstractResult result;
+    int max_locals;
+    int max_stack;
+    Vector* heads; // Vector<CachedHead>, loop head states at the end of the analysis
+    Vector* functions; // Vector<CachedFunction>, NULL when the invariants were not recorded
+    CacheItem* next;
+};
+
+static CacheItem* cache = NULL;
+static bool dirty = false;
+
+static CacheItem* find_item(const char* id)
+{
+    for (CacheItem* it = cache; it != NULL; it = it->next) {
+        if (strcmp(id, it->method_id) == 0) {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+static void functions_delete(Vector* functions)
+{
+    for (size_t i = 0; functions && i < vector_length(functions); i++) {
+        CachedFunction* function = vector_get(functions, i);
+
+        for (size_t j = 0; function->invariants && j < vector_length(function->invariants); j++) {
+            free(((CachedInvariant*)vector_get(function->invariants, j))->slots);
+        }
+        vector_delete(function->invariants);
+        free(function->method_id);
+    }
+
+    vector_delete(functions);
+}
+
+static void item_clear(CacheItem* item)
+{
+    abstract_result_delete(&item->result);
+    functions_delete(item->functions);
+    item->functions = NULL;
+
+    for (size_t i = 0; item->heads && i < vector_length(item->heads); i++) {
+        CachedHead* head = vector_get(item->heads, i);
+        interval_state_delete(head->state);
+    }
+    vector_delete(item->heads);
+    item->heads = NULL;
+}
+
+static void item_delete(CacheItem* item)
+{
+    if (item) {
+        item_clear(item);
+        free(item->method_id);
+        free(item);
+    }
+}
+
+static int result_copy(AbstractResult* dst, const AbstractResult* src)
+{
+    dst->num_locals = src->num_locals;
+    dst->degraded = false; // degraded results are never stored
+    dst->invariants = NULL; // kept apart, by method id
+    dst->results = calloc(src->num_locals, sizeof(Vector*));
+    if (!dst->results && src->num_locals) {
+        return FAILURE;
+    }
+
+    for (int i = 0; i < src->num_locals; i++) {
+        dst->results[i] = vector_new(sizeof(Interval));
+        if (!dst->results[i] || vector_copy(dst->results[i], src->results[i])) {
+            abstract_result_delete(dst);
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+static Vector* functions_export(const InvariantStore* store)
+{
+    Vector* functions = vector_new(sizeof(CachedFunction));
+    if (!functions) {
+        return NULL;
+    }
+
+    for (int f = 0; f < invariant_store_functions(store); f++) {
+        const IrFunction* ir_function = invariant_store_function_ir(store, f);
+        const char* method_id = ir_program_get_function_id(ir_function);
+        if (!method_id) {
+            goto error;
+        }
+
+        CachedFunction function = { .method_id = strdup(method_id), .invariants = vector_new(sizeof(CachedInvariant)) };
+        if (vector_push(functions, &function) || !function.method_id || !function.invariants) {
+            goto error;
+        }
+
+        for (int pc = 0; pc < (int)vector_length(ir_function->ir_instructions); pc++) {
+            int slots = invariant_store_slots(store, f, pc);
+            if (slots == -1) {
+                continue;
+            }
+
+            int num_locals = invariant_store_locals(store, f, pc);
+            CachedInvariant invariant = {
+                .pc = pc,
+                .num_locals = num_locals,
+                .stack_len = slots - num_locals,
+                .slots = malloc(sizeof(Interval) * MAX(slots, 1)),
+            };
+
+            if (!invariant.slots || vector_push(function.invariants, &invariant)) {
+                free(invariant.slots);
+                goto error;
+            }
+
+            for (int i = 0; i < slots; i++) {
+                invariant_store_get(store, f, pc, i, &invariant.slots[i]);
+            }
+        }
+    }
+
+    return functions;
+
+error:
+    functions_delete(functions);
+    return NULL;
+}
+
+// the hash of the entry covers the ir of every function, their pcs still exist
+static InvariantStore* functions_import(const Vector* functions, const Config* cfg)
+{
+    InvariantStore* store = invariant_store_new();
+    if (!store) {
+        return NULL;
+    }
+
+    for (size_t f = 0; f < vector_length(functions); f++) {
+        CachedFunction* function = vector_get(functions, f);
+
+        Method* m = method_create(function->method_id);
+        const IrFunction* ir_function = m ? ir_program_get_function_ir(m, cfg) : NULL;
+        method_delete(m);
+
+        if (!ir_function) {
+            goto error;
+        }
+
+        for (size_t i = 0; i < vector_length(function->invariants); i++) {
+            CachedInvariant* invariant = vector_get(function->invariants, i);
+
+            IntervalState* state = interval_new_bottom_state(invariant->num_locals, invariant->stack_len);
+            if (!state) {
+                goto error;
+            }
+
+            for (int slot = 0; slot < invariant->num_locals + invariant->stack_len; slot++) {
+                state->slots[slot] = invariant->slots[slot];
+            }
+            state->stack_len = invariant->stack_len;
+            state->bottom = false;
+
+            int status = invariant_store_add(store, ir_function, invariant->pc, invariant->num_locals, state);
+            interval_state_delete(state);
+
+            if (status) {
+                goto error;
+            }
+        }
+    }
+
+    if (invariant_store_seal(store)) {
+        goto error;
+    }
+
+    return store;
+
+error:
+    invariant_store_delete(store);
+    return NULL;
+}
+
+/*** FILE ***/
+
+/*
+ * One entry per method:
+ *   method <id> <hash> <shape> <num_locals> <max_locals> <max_stack> <heads> <functions>
+ *   local <count> <lower> <upper> ...        num_locals lines
+ *   head <node> <bottom> <stack_len> <lower> <upper> ...        one per head
+ *   function <id> <count>        one per function, -1 of them without invariants
+ *   pc <pc> <num_locals> <stack_len> <lower> <upper> ...        count lines
+ * Entries written before the invariants were cached have no <functions>.
+ */
+
+static bool next_long(char** cursor, long* value)
+{
+    char* end = NULL;
+    *value = strtol(*cursor, &end, 10);
+    if (end == *cursor) {
+        return false;
+    }
+
+    *cursor = end;
+    return true;
+}
+
+static bool next_interval(char** cursor, Interval* iv)
+{
+    long lower, upper;
+    if (!next_long(cursor, &lower) || !next_long(cursor, &upper)) {
+        return false;
+    }
+
+    iv->lower = (int)lower;
+    iv->upper = (int)upper;
+    return true;
+}
+
+static bool parse_local(char* line, Vector* intervals)
+{
+    char* cursor = line + strlen("local");
+    long count;
+
+    if (strncmp(line, "local ", strlen("local ")) || !next_long(&cursor, &count)) {
+        return false;
+    }
+
+    for (long i = 0; i < count; i++) {
+        Interval iv;
+        if (!next_interval(&cursor, &iv)) {
+            return false;
+        }
+        vector_push(intervals, &iv);
+    }
+
+    return true;
+}
+
+static bool parse_head(char* line, CacheItem* item)
+{
+    char* cursor = line + strlen("head");
+    long node, bottom, stack_len;
+
+    if (strncmp(line, "head ", strlen("head "))
+        || !next_long(&cursor, &node)
+        || !next_long(&cursor, &bottom)
+        || !next_long(&cursor, &stack_len)
+        || stack_len < 0 || stack_len > item->max_stack) {
+        return false;
+    }
+
+    CachedHead head = { .node = (int)node };
+    head.state = interval_new_bottom_state(item->max_locals, item->max_stack);
+    if (!head.state) {
+        return false;
+    }
+
+    for (int i = 0; i < item->max_locals + stack_len; i++) {
+        if (!next_interval(&cursor, &head.state->slots[i])) {
+            interval_state_delete(head.state);
+            return false;
+        }
+    }
+
+    head.state->stack_len = (int)stack_len;
+    head.state->bottom = bottom != 0;
+    vector_push(item->heads, &head);
+
+    return true;
+}
+
+static bool parse_invariant(char* line, Vector* invariants)
+{
+    char* cursor = line + strlen("pc");
+    long pc, num_locals, stack_len;
+
+    if (strncmp(line, "pc ", strlen("pc "))
+        || !next_long(&cursor, &pc)
+        || !next_long(&cursor, &num_locals)
+        || !next_long(&cursor, &stack_len)
+        || num_locals < 0 || stack_len < 0) {
+        return false;
+    }
+
+    CachedInvariant invariant = {
+        .pc = (int)pc,
+        .num_locals = (int)num_locals,
+        .stack_len = (int)stack_len,
+        .slots = malloc(sizeof(Interval) * MAX(num_locals + stack_len, 1)),
+    };
+
+    if (!invariant.slots) {
+        return false;
+    }
+
+    for (int i = 0; i < invariant.num_locals + invariant.stack_len; i++) {
+        if (!next_interval(&cursor, &invariant.slots[i])) {
+            free(invariant.slots);
+            return false;
+        }
+    }
+
+    if (vector_push(invariants, &invariant)) {
+        free(invariant.slots);
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_function(char* header, FILE* file, char** line, size_t* capacity, Vector* functions)
+{
+    char id[512];
+    int count;
+
+    if (sscanf(header, "function %511s %d", id, &count) != 2) {
+        return false;
+    }
+
+    CachedFunction function = { .method_id = strdup(id), .invariants = vector_new(sizeof(CachedInvariant)) };
+    if (vector_push(functions, &function) || !function.method_id || !function.invariants) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (getline(line, capacity, file) == -1 || !parse_invariant(*line, function.invariants)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static CacheItem* parse_item(char* header, FILE* file, char** line, size_t* capacity)
+{
+    char id[512];
+    uint64_t hash, shape;
+    int num_locals, max_locals, max_stack, heads, functions = -1;
+
+    int fields = sscanf(header, "method %511s %" SCNx64 " %" SCNx64 " %d %d %d %d %d",
+        id, &hash, &shape, &num_locals, &max_locals, &max_stack, &heads, &functions);
+    if (fields != 7 && fields != 8) {
+        return NULL;
+    }
+
+    CacheItem* item = calloc(1, sizeof(CacheItem));
+    if (!item) {
+        return NULL;
+    }
+
+    item->method_id = strdup(id);
+    item->hash = hash;
+    item->shape = shape;
+    item->max_locals = max_locals;
+    item->max_stack = max_stack;
+    item->heads = vector_new(sizeof(CachedHead));
+    item->result.num_locals = num_locals;
+    item->result.results = calloc(num_locals, sizeof(Vector*));
+
+    for (int i = 0; i < num_locals; i++) {
+        item->result.results[i] = vector_new(sizeof(Interval));
+        if (getline(line, capacity, file) == -1 || !parse_local(*line, item->result.results[i])) {
+            goto error;
+        }
+    }
+
+    for (int i = 0; i < heads; i++) {
+        if (getline(line, capacity, file) == -1 || !parse_head(*line, item)) {
+            goto error;
+        }
+    }
+
+    if (functions >= 0) {
+        item->functions = vector_new(sizeof(CachedFunction));
+        if (!item->functions) {
+            goto error;
+        }
+    }
+
+    for (int i = 0; i < functions; i++) {
+        if (getline(line, capacity, file) == -1 || !parse_function(*line, file, line, capacity, item->functions)) {
+            goto error;
+        }
+    }
+
+    return item;
+
+error:
+    item_delete(item);
+    return NULL;
+}
+
+int result_cache_load(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        // first run, the file is written at the end
+        return SUCCESS;
+    }
+
+    char* line = NULL;
+    size_t capacity = 0;
+    int result = SUCCESS;
+
+    while (getline(&line, &capacity, file) != -1) {
+        CacheItem* item = parse_item(line, file, &line, &capacity);
+        if (!item) {
+            LOG_ERROR("Malformed result cache %s, ignoring the rest of it", path);
+            result = FAILURE;
+            break;
+        }
+
+        item->next = cache;
+        cache = item;
+    }
+
+    free(line);
+    fclose(file);
+
+    return result;
+}
+
+static void write_item(FILE* file, const CacheItem* item)
+{
+    fprintf(file, "method %s %016" PRIx64 " %016" PRIx64 " %d %d %d %zu %ld\n",
+        item->method_id, item->hash, item->shape, item->result.num_locals,
+        item->max_locals, item->max_stack, vector_length(item->heads),
+        item->functions ? (long)vector_length(item->functions) : -1L);
+
+    for (int i = 0; i < item->result.num_locals; i++) {
+        Vector* intervals = item->result.results[i];
+        fprintf(file, "local %zu", vector_length(intervals));
+
+        for (size_t j = 0; j < vector_length(intervals); j++) {
+            Interval* iv = vector_get(intervals, j);
+            fprintf(file, " %d %d", iv->lower, iv->upper);
+        }
+        fprintf(file, "\n");
+    }
+
+    for (size_t i = 0; i < vector_length(item->heads); i++) {
+        CachedHead* head = vector_get(item->heads, i);
+        IntervalState* st = head->state;
+        fprintf(file, "head %d %d %d", head->node, st->bottom, st->stack_len);
+
+        for (int j = 0; j < st->max_locals + st->stack_len; j++) {
+            fprintf(file, " %d %d", st->slots[j].lower, st->slots[j].upper);
+        }
+        fprintf(file, "\n");
+    }
+
+    for (size_t i = 0; item->functions && i < vector_length(item->functions); i++) {
+        CachedFunction* function = vector_get(item->functions, i);
+        fprintf(file, "function %s %zu\n", function->method_id, vector_length(function->invariants));
+
+        for (size_t j = 0; j < vector_length(function->invariants); j++) {
+            CachedInvariant* invariant = vector_get(function->invariants, j);
+            fprintf(file, "pc %d %d %d", invariant->pc, invariant->num_locals, invariant->stack_len);
+
+            for (int k = 0; k < invariant->num_locals + invariant->stack_len; k++) {
+                fprintf(file, " %d %d", invariant->slots[k].lower, invariant->slots[k].upper);
+            }
+            fprintf(file, "\n");
+        }
+    }
+}
+
+// written aside and renamed, an interrupted run keeps the previous cache
+int result_cache_save(const char* path)
+{
+    if (!dirty) {
+        return SUCCESS;
+    }
+
+    char* tmp_path = NULL;
+    if (asprintf(&tmp_path, "%s.tmp", path) < 0) {
+        return FAILURE;
+    }
+
+    int result = FAILURE;
+    FILE* file = fopen(tmp_path, "w");
+    if (!file) {
+        LOG_ERROR("Unable to write the result cache %s", tmp_path);
+        goto cleanup;
+    }
+
+    for (CacheItem* it = cache; it != NULL; it = it->next) {
+        write_item(file, it);
+    }
+
+    if (fclose(file) || rename(tmp_path, path)) {
+        LOG_ERROR("Unable to write the result cache %s", path);
+        goto cleanup;
+    }
+
+    dirty = false;
+    result = SUCCESS;
+
+cleanup:
+    free(tmp_path);
+    return result;
+}
+
+/*** ENTRIES ***/
+
+// an entry without invariants does not answer an analysis that records them
+int result_cache_lookup(const char* method_id, uint64_t hash, const Config* cfg, AbstractResult* result)
+{
+    int found = FAILURE;
+
+#pragma omp critical(result_cache)
+    {
+        CacheItem* item = find_item(method_id);
+        if (item && item->hash == hash && (!cfg->invariants || item->functions)
+            && result_copy(result, &item->result) == SUCCESS) {
+            found = SUCCESS;
+
+            if (cfg->invariants) {
+                result->invariants = functions_import(item->functions, cfg);
+                if (!result->invariants) {
+                    abstract_result_delete(result);
+                    found = FAILURE;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+int result_cache_seed(const char* method_id, uint64_t shape, int node, IntervalState* seed)
+{
+    int found = FAILURE;
+
+#pragma omp critical(result_cache)
+    {
+        CacheItem* item = find_item(method_id);
+        for (size_t i = 0; item && item->shape == shape && i < vector_length(item->heads); i++) {
+            CachedHead* head = vector_get(item->heads, i);
+            if (head->node == node) {
+                found = interval_state_copy(seed, head->state);
+                break;
+            }
+        }
+    }
+
+    return found;
+}
+
+void result_cache_store(const char* method_id, uint64_t hash, uint64_t shape, const AbstractResult* result, const Vector* heads)
+{
+    CacheItem* item = calloc(1, sizeof(CacheItem));
+    if (!item) {
+        return;
+    }
+
+    item->hash = hash;
+    item->shape = shape;
+    item->heads = vector_new(sizeof(CachedHead));
+    if (!item->heads || result_copy(&item->result, result)) {
+        item_delete(item);
+        return;
+    }
+
+    if (result->invariants) {
+        item->functions = functions_export(result->invariants);
+        if (!item->functions) {
+            item_delete(item);
+            return;
+        }
+    }
+
+    for (size_t i = 0; heads && i < vector_length(heads); i++) {
+        CachedHead* head = vector_get(heads, i);
+        CachedHead copy = { .node = head->node };
+
+        item->max_locals = head->state->max_locals;
+        item->max_stack = head->state->max_stack;
+        copy.state = interval_new_bottom_state(item->max_locals, item->max_stack);
+        interval_state_copy(copy.state, head->state);
+        vector_push(item->heads, &copy);
+    }
+
+#pragma omp critical(result_cache)
+    {
+        CacheItem* old = find_item(method_id);
+        if (old) {
+            // the newest result replaces the previous one in place
+            item_clear(old);
+            old->hash = item->hash;
+            old->shape = item->shape;
+            old->result = item->result;
+            old->max_locals = item->max_locals;
+            old->max_stack = item->max_stack;
+            old->heads = item->heads;
+            old->functions = item->functions;
+            free(item);
+        } else {
+            item->method_id = strdup(method_id);
+            item->next = cache;
+            cache = item;
+        }
+
+        dirty = true;
+    }
+}
+
+void result_cache_delete()
+{
+    CacheItem* current = cache;
+    while (current != NULL) {
+        CacheItem* next = current->next;
+        item_delete(current);
+        current = next;
+    }
+
+    cache = NULL;
+    dirty = false;
+}
@@ -0,0 +1,1113 @@
+#include "ssa.h"
+#include "common.h"
+#include "ir_instruction.h"
+#include "log.h"
+#include "type.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    int var;
+    int branch_block;
+    int taken;
+} SigmaSite;
+
+typedef struct {
+    SsaForm* ssa;
+    Cfg* cfg;
+    int var_count;
+    int* rpo;
+    int rpo_len;
+    int* rpo_index; // -1 for blocks not reachable from the entry
+    int* idom;
+    Vector** children; // Vector<int>, dominator tree
+    Vector** frontier; // Vector<int>
+    int* entry_depth;
+    int* branch_origin; // local compared by the conditional closing the block, -1 if none
+    Vector** def_blocks; // Vector<int> per variable
+    bool* global; // read in some block before being defined there
+    int* defined_in; // per variable, last block that defined it while collecting
+    Vector** sigmas; // Vector<SigmaSite> per block
+    Vector** rename; // Vector<int> per variable, stack of reaching values
+} SsaBuilder;
+
+// the stack walk shared by both passes, pops never go below zero
+typedef struct {
+    int depth;
+    int min_depth; // stack slots below it still hold the values the block was entered with
+} StackWalk;
+
+SsaValue* ssa_value(const SsaForm* ssa, int value)
+{
+    return vector_get(ssa->values, value);
+}
+
+SsaExpr* ssa_expr(const SsaForm* ssa, int expr)
+{
+    return vector_get(ssa->exprs, expr);
+}
+
+static IrInstruction* block_instruction(SsaBuilder* builder, int block, int ip)
+{
+    BasicBlock* basic_block = *(BasicBlock**)vector_get(builder->cfg->blocks, block);
+    return *(IrInstruction**)vector_get(basic_block->ir_function->ir_instructions, ip);
+}
+
+static BasicBlock* cfg_block(SsaBuilder* builder, int block)
+{
+    return *(BasicBlock**)vector_get(builder->cfg->blocks, block);
+}
+
+static Vector* successors(SsaBuilder* builder, int block)
+{
+    return builder->ssa->blocks[block].successors;
+}
+
+static int successor(SsaBuilder* builder, int block, int index)
+{
+    return *(int*)vector_get(successors(builder, block), index);
+}
+
+// arguments passed to the function inlined after an invoke block
+static int invoke_arguments(SsaBuilder* builder, int block)
+{
+    if (!vector_length(successors(builder, block))) {
+        return 0;
+    }
+
+    return MIN(cfg_block(builder, successor(builder, block, 0))->num_locals, builder->ssa->max_locals);
+}
+
+/*** DOMINANCE ***/
+
+static void compute_rpo(SsaBuilder* builder)
+{
+    int n = builder->ssa->block_count;
+    int* visited = calloc(n, sizeof(int));
+    int* next_child = calloc(n, sizeof(int));
+    int* stack = malloc(sizeof(int) * n);
+    int* postorder = malloc(sizeof(int) * n);
+    int top = 0;
+    int count = 0;
+
+    stack[top++] = 0;
+    visited[0] = 1;
+
+    while (top) {
+        int block = stack[top - 1];
+        Vector* next = successors(builder, block);
+
+        if (next_child[block] < (int)vector_length(next)) {
+            int s = *(int*)vector_get(next, next_child[block]++);
+            if (s < n && !visited[s]) {
+                visited[s] = 1;
+                stack[top++] = s;
+            }
+        } else {
+            postorder[count++] = block;
+            top--;
+        }
+    }
+
+    builder->rpo_len = count;
+    for (int i = 0; i < count; i++) {
+        builder->rpo[i] = postorder[count - 1 - i];
+        builder->rpo_index[builder->rpo[i]] = i;
+    }
+
+    free(visited);
+    free(next_child);
+    free(stack);
+    free(postorder);
+}
+
+static void build_predecessors(SsaBuilder* builder)
+{
+    SsaForm* ssa = builder->ssa;
+
+    for (int i = 0; i < builder->rpo_len; i++) {
+        int block = builder->rpo[i];
+        Vector* next = successors(builder, block);
+
+        ssa->blocks[block].reachable = true;
+
+        for (size_t j = 0; j < vector_length(next); j++) {
+            SsaEdge edge = { .source = block, .index = j };
+            vector_push(ssa->blocks[*(int*)vector_get(next, j)].predecessors, &edge);
+        }
+    }
+}
+
+static int intersect(SsaBuilder* builder, int a, int b)
+{
+    while (a != b) {
+        while (builder->rpo_index[a] > builder->rpo_index[b]) {
+            a = builder->idom[a];
+        }
+        while (builder->rpo_index[b] > builder->rpo_index[a]) {
+            b = builder->idom[b];
+        }
+    }
+
+    return a;
+}
+
+// Cooper, Harvey and Kennedy, iterated over the reverse postorder
+static void compute_dominators(SsaBuilder* builder)
+{
+    SsaForm* ssa = builder->ssa;
+    int changed = 1;
+
+    builder->idom[0] = 0;
+
+    while (changed) {
+        changed = 0;
+
+        for (int i = 1; i < builder->rpo_len; i++) {
+            int block = builder->rpo[i];
+            Vector* predecessors = ssa->blocks[block].predecessors;
+            int new_idom = -1;
+
+            for (size_t j = 0; j < vector_length(predecessors); j++) {
+                SsaEdge* edge = vector_get(predecessors, j);
+                if (builder->idom[edge->source] == -1) {
+                    continue;
+                }
+
+                new_idom = new_idom == -1 ? edge->source : intersect(builder, edge->source, new_idom);
+            }
+
+            if (new_idom != builder->idom[block]) {
+                builder->idom[block] = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    for (int i = 1; i < builder->rpo_len; i++) {
+        int block = builder->rpo[i];
+        vector_push(builder->children[builder->idom[block]], &block);
+    }
+}
+
+static void push_unique(Vector* v, int value)
+{
+    int* last = vector_get(v, vector_length(v) - 1);
+    if (!last || *last != value) {
+        vector_push(v, &value);
+    }
+}
+
+static void compute_frontiers(SsaBuilder* builder)
+{
+    SsaForm* ssa = builder->ssa;
+
+    for (int i = 0; i < builder->rpo_len; i++) {
+        int block = builder->rpo[i];
+        Vector* predecessors = ssa->blocks[block].predecessors;
+
+        if (vector_length(predecessors) < 2) {
+            continue;
+        }
+
+        for (size_t j = 0; j < vector_length(predecessors); j++) {
+            int runner = ((SsaEdge*)vector_get(predecessors, j))->source;
+
+            while (runner != builder->idom[block]) {
+                push_unique(builder->frontier[runner], block);
+                if (runner == 0) {
+                    break;
+                }
+                runner = builder->idom[runner];
+            }
+        }
+    }
+}
+
+/*** COLLECT ***/
+
+static void collect_define(SsaBuilder* builder, int block, int var)
+{
+    if (var < 0 || var >= builder->var_count) {
+        return;
+    }
+
+    push_unique(builder->def_blocks[var], block);
+    builder->defined_in[var] = block;
+}
+
+static void collect_read(SsaBuilder* builder, int block, int var)
+{
+    if (var >= 0 && var < builder->var_count && builder->defined_in[var] != block) {
+        builder->global[var] = true;
+    }
+}
+
+static void collect_push(Vector* origins, StackWalk* walk, int origin)
+{
+    vector_push(origins, &origin);
+    walk->depth++;
+}
+
+static int collect_pop(SsaBuilder* builder, int block, Vector* origins, StackWalk* walk)
+{
+    int origin = -1;
+
+    if (!walk->depth) {
+        return origin;
+    }
+
+    walk->depth--;
+    vector_pop(origins, &origin);
+
+    if (walk->depth < walk->min_depth) {
+        walk->min_depth = walk->depth;
+        collect_read(builder, block, builder->ssa->max_locals + walk->depth);
+    }
+
+    return origin;
+}
+
+// the stack no longer holds copies of a local that has been written
+static void collect_forget(Vector* origins, int local)
+{
+    for (size_t i = 0; i < vector_length(origins); i++) {
+        int* origin = vector_get(origins, i);
+        if (*origin == local) {
+            *origin = -1;
+        }
+    }
+}
+
+/*
+ * Finds the variables defined by a block, those it reads before defining them
+ * and the stack depth its successors are entered with.
+ */
+static void collect_block(SsaBuilder* builder, int block, Vector* origins)
+{
+    SsaForm* ssa = builder->ssa;
+    BasicBlock* basic_block = cfg_block(builder, block);
+    StackWalk walk = { .depth = 0, .min_depth = builder->entry_depth[block] };
+    int exit_depth = -1;
+
+    vector_clear(origins);
+    for (int k = 0; k < builder->entry_depth[block]; k++) {
+        collect_push(origins, &walk, -1);
+    }
+
+    for (int ip = basic_block->ip_start; ip <= basic_block->ip_end; ip++) {
+        IrInstruction* ir = block_instruction(builder, block, ip);
+
+        switch (ir->opcode) {
+        case OP_LOAD:
+            collect_read(builder, block, ir->data.load.index);
+            collect_push(origins, &walk, ir->data.load.index < ssa->max_locals ? ir->data.load.index : -1);
+            break;
+        case OP_PUSH:
+        case OP_GET:
+        case OP_NEW:
+            collect_push(origins, &walk, -1);
+            break;
+        case OP_STORE:
+            collect_pop(builder, block, origins, &walk);
+            collect_define(builder, block, ir->data.store.index < ssa->max_locals ? ir->data.store.index : -1);
+            collect_forget(origins, ir->data.store.index);
+            break;
+        case OP_INCR:
+            collect_read(builder, block, ir->data.incr.index);
+            collect_define(builder, block, ir->data.incr.index < ssa->max_locals ? ir->data.incr.index : -1);
+            collect_forget(origins, ir->data.incr.index);
+            break;
+        case OP_DUP: {
+            int origin = collect_pop(builder, block, origins, &walk);
+            collect_push(origins, &walk, origin);
+            collect_push(origins, &walk, origin);
+            break;
+        }
+        case OP_BINARY:
+        case OP_ARRAY_LOAD:
+            collect_pop(builder, block, origins, &walk);
+            collect_pop(builder, block, origins, &walk);
+            collect_push(origins, &walk, -1);
+            break;
+        case OP_NEGATE:
+        case OP_ARRAY_LENGTH:
+            collect_pop(builder, block, origins, &walk);
+            collect_push(origins, &walk, -1);
+            break;
+        case OP_NEW_ARRAY:
+            for (int i = 0; i < ir->data.new_array.dim; i++) {
+                collect_pop(builder, block, origins, &walk);
+            }
+            collect_push(origins, &walk, -1);
+            break;
+        case OP_ARRAY_STORE:
+            for (int i = 0; i < 3; i++) {
+                collect_pop(builder, block, origins, &walk);
+            }
+            break;
+        case OP_RETURN:
+            collect_pop(builder, block, origins, &walk);
+            break;
+        case OP_IF:
+            collect_pop(builder, block, origins, &walk);
+            builder->branch_origin[block] = collect_pop(builder, block, origins, &walk);
+            break;
+        case OP_IF_ZERO:
+            builder->branch_origin[block] = collect_pop(builder, block, origins, &walk);
+            break;
+        case OP_INVOKE:
+            if (ip == basic_block->ip_end && vector_length(successors(builder, block))) {
+                for (int i = 0; i < invoke_arguments(builder, block); i++) {
+                    collect_pop(builder, block, origins, &walk);
+                }
+
+                // the callee frame replaces the caller one
+                for (int local = 0; local < ssa->max_locals; local++) {
+                    collect_define(builder, block, local);
+                }
+                exit_depth = 0;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (exit_depth == -1) {
+        exit_depth = walk.depth;
+        for (int k = walk.min_depth; k < walk.depth; k++) {
+            collect_define(builder, block, ssa->max_locals + k);
+        }
+    }
+
+    Vector* next = successors(builder, block);
+    for (size_t i = 0; i < vector_length(next); i++) {
+        int s = *(int*)vector_get(next, i);
+        if (builder->entry_depth[s] == -1) {
+            builder->entry_depth[s] = MIN(exit_depth, ssa->max_stack);
+        }
+    }
+}
+
+/*
+ * A branch on a local restricts it on both edges, a sigma value is placed at
+ * the start of each successor the branch is the only way into.
+ */
+static void place_sigmas(SsaBuilder* builder, int block)
+{
+    SsaForm* ssa = builder->ssa;
+    int local = builder->branch_origin[block];
+
+    if (local < 0) {
+        return;
+    }
+
+    Vector* next = successors(builder, block);
+    for (size_t i = 0; i < vector_length(next) && i < 2; i++) {
+        int s = *(int*)vector_get(next, i);
+        if (s == 0 || vector_length(ssa->blocks[s].predecessors) != 1) {
+            continue;
+        }
+
+        // cfg_build pushes the branch target first and the fall through second
+        SigmaSite site = { .var = local, .branch_block = block, .taken = i == 0 };
+        vector_push(builder->sigmas[s], &site);
+        push_unique(builder->def_blocks[local], s);
+    }
+}
+
+/*** PHI ***/
+
+static int new_value(SsaForm* ssa, SsaValueKind kind, int block, int var)
+{
+    SsaValue value = {
+        .kind = kind,
+        .block = block,
+        .var = var,
+        .expr = -1,
+        .operands = vector_new(sizeof(int)),
+        .users = vector_new(sizeof(int)),
+        .left = -1,
+        .right = -1,
+        .branch = -1,
+        .taken = 0,
+    };
+
+    int id = vector_length(ssa->values);
+    vector_push(ssa->values, &value);
+    vector_push(ssa->blocks[block].values, &id);
+
+    return id;
+}
+
+/*
+ * Semi pruned placement: only variables read across blocks get phis, at the
+ * iterated dominance frontier of their definitions. The method entry joins
+ * unknown values only, it never needs one.
+ */
+static void place_phis(SsaBuilder* builder)
+{
+    SsaForm* ssa = builder->ssa;
+    int* has_phi = malloc(sizeof(int) * ssa->block_count);
+    int* queued = malloc(sizeof(int) * ssa->block_count);
+    Vector* work = vector_new(sizeof(int));
+
+    for (int i = 0; i < ssa->block_count; i++) {
+        has_phi[i] = -1;
+        queued[i] = -1;
+    }
+
+    for (int var = 0; var < builder->var_count; var++) {
+        if (!builder->global[var]) {
+            continue;
+        }
+
+        Vector* defs = builder->def_blocks[var];
+        vector_clear(work);
+        for (size_t i = 0; i < vector_length(defs); i++) {
+            int block = *(int*)vector_get(defs, i);
+            queued[block] = var;
+            vector_push(work, &block);
+        }
+
+        int block;
+        while (vector_pop(work, &block) == 0) {
+            Vector* frontier = builder->frontier[block];
+
+            for (size_t i = 0; i < vector_length(frontier); i++) {
+                int y = *(int*)vector_get(frontier, i);
+                if (has_phi[y] == var || y == 0) {
+                    continue;
+                }
+                has_phi[y] = var;
+
+                // a stack variable deeper than the stack the block is entered with is dead there
+                int stack_slot = var - ssa->max_locals;
+                if (stack_slot < 0 || stack_slot < builder->entry_depth[y]) {
+                    int phi = new_value(ssa, SSA_PHI, y, var);
+                    int missing = -1;
+                    for (size_t j = 0; j < vector_length(ssa->blocks[y].predecessors); j++) {
+                        vector_push(ssa_value(ssa, phi)->operands, &missing);
+                    }
+                }
+
+                if (queued[y] != var) {
+                    queued[y] = var;
+                    vector_push(work, &y);
+                }
+            }
+        }
+    }
+
+    vector_delete(work);
+    free(queued);
+    free(has_phi);
+}
+
+/*** RENAME ***/
+
+static int new_expr(SsaForm* ssa, SsaExpr expr)
+{
+    int id = vector_length(ssa->exprs);
+    vector_push(ssa->exprs, &expr);
+    return id;
+}
+
+static int expr_range(SsaForm* ssa, int lower, int upper)
+{
+    return new_expr(ssa, (SsaExpr) { .kind = EXPR_RANGE, .lower = lower, .upper = upper, .left = -1, .right = -1 });
+}
+
+static int expr_top(SsaForm* ssa)
+{
+    return expr_range(ssa, INT_MIN, INT_MAX);
+}
+
+static int current(SsaBuilder* builder, int var)
+{
+    Vector* stack = builder->rename[var];
+    return *(int*)vector_get(stack, vector_length(stack) - 1);
+}
+
+static int expr_var(SsaBuilder* builder, int var)
+{
+    if (var < 0 || var >= builder->var_count) {
+        return expr_top(builder->ssa);
+    }
+
+    return new_expr(builder->ssa, (SsaExpr) { .kind = EXPR_VALUE, .value = current(builder, var), .left = -1, .right = -1 });
+}
+
+static void add_user(SsaForm* ssa, int value, int user)
+{
+    push_unique(ssa_value(ssa, value)->users, user);
+}
+
+// user reads every value at the leaves of expr
+static void add_expr_user(SsaForm* ssa, int expr, int user)
+{
+    SsaExpr* e = ssa_expr(ssa, expr);
+
+    switch (e->kind) {
+    case EXPR_VALUE:
+        add_user(ssa, e->value, user);
+        break;
+    case EXPR_BINARY:
+        add_expr_user(ssa, e->left, user);
+        add_expr_user(ssa, e->right, user);
+        break;
+    case EXPR_NEGATE:
+        add_expr_user(ssa, e->left, user);
+        break;
+    default:
+        break;
+    }
+}
+
+static void define(SsaBuilder* builder, int block, int var, int expr, Vector* defined)
+{
+    if (var < 0 || var >= builder->var_count) {
+        return;
+    }
+
+    SsaForm* ssa = builder->ssa;
+    int value = new_value(ssa, SSA_EXPR, block, var);
+
+    ssa_value(ssa, value)->expr = expr;
+    add_expr_user(ssa, expr, value);
+
+    vector_push(builder->rename[var], &value);
+    vector_push(defined, &var);
+}
+
+static int rename_pop(SsaBuilder* builder, Vector* stack, StackWalk* walk)
+{
+    int expr;
+
+    if (!walk->depth) {
+        return expr_top(builder->ssa);
+    }
+
+    walk->depth--;
+    walk->min_depth = MIN(walk->min_depth, walk->depth);
+    vector_pop(stack, &expr);
+
+    return expr;
+}
+
+static void rename_push(Vector* stack, StackWalk* walk, int expr)
+{
+    vector_push(stack, &expr);
+    walk->depth++;
+}
+
+static int push_value_expr(SsaForm* ssa, IrInstruction* ir)
+{
+    Value* value = &ir->data.push.value;
+
+    if (value->type == TYPE_INT) {
+        return expr_range(ssa, value->data.int_value, value->data.int_value);
+    } else if (value->type == TYPE_BOOLEAN) {
+        return expr_range(ssa, value->data.bool_value, value->data.bool_value);
+    } else if (value->type == TYPE_CHAR) {
+        return expr_range(ssa, value->data.char_value, value->data.char_value);
+    }
+
+    return expr_top(ssa);
+}
+
+static void new_branch(SsaBuilder* builder, int block, IfCondition condition, int left, int right)
+{
+    SsaForm* ssa = builder->ssa;
+    int branch = new_value(ssa, SSA_BRANCH, block, -1);
+    SsaValue* value = ssa_value(ssa, branch);
+
+    value->condition = condition;
+    value->left = left;
+    value->right = right;
+
+    add_expr_user(ssa, left, branch);
+    add_expr_user(ssa, right, branch);
+
+    ssa->blocks[block].branch = branch;
+}
+
+static void rename_instructions(SsaBuilder* builder, int block, Vector* stack, Vector* defined)
+{
+    SsaForm* ssa = builder->ssa;
+    BasicBlock* basic_block = cfg_block(builder, block);
+    StackWalk walk = { .depth = 0, .min_depth = builder->entry_depth[block] };
+    int invoked = 0;
+
+    vector_clear(stack);
+    for (int k = 0; k < builder->entry_depth[block]; k++) {
+        rename_push(stack, &walk, expr_var(builder, ssa->max_locals + k));
+    }
+
+    for (int ip = basic_block->ip_start; ip <= basic_block->ip_end; ip++) {
+        IrInstruction* ir = block_instruction(builder, block, ip);
+
+        switch (ir->opcode) {
+        case OP_LOAD:
+            rename_push(stack, &walk, expr_var(builder, ir->data.load.index < ssa->max_locals ? ir->data.load.index : -1));
+            break;
+        case OP_PUSH:
+            rename_push(stack, &walk, push_value_expr(ssa, ir));
+            break;
+        case OP_GET:
+            rename_push(stack, &walk, expr_range(ssa, 0, 1));
+            break;
+        case OP_NEW:
+            rename_push(stack, &walk, expr_top(ssa));
+            break;
+        case OP_STORE: {
+            int expr = rename_pop(builder, stack, &walk);
+            define(builder, block, ir->data.store.index < ssa->max_locals ? ir->data.store.index : -1, expr, defined);
+            break;
+        }
+        case OP_INCR: {
+            int index = ir->data.incr.index < ssa->max_locals ? ir->data.incr.index : -1;
+            SsaExpr sum = {
+                .kind = EXPR_BINARY,
+                .op = BO_ADD,
+                .left = expr_var(builder, index),
+                .right = expr_range(ssa, ir->data.incr.amount, ir->data.incr.amount),
+            };
+            define(builder, block, index, new_expr(ssa, sum), defined);
+            break;
+        }
+        case OP_DUP: {
+            int expr = rename_pop(builder, stack, &walk);
+            rename_push(stack, &walk, expr);
+            rename_push(stack, &walk, expr);
+            break;
+        }
+        case OP_BINARY: {
+            int right = rename_pop(builder, stack, &walk);
+            int left = rename_pop(builder, stack, &walk);
+            SsaExpr binary = { .kind = EXPR_BINARY, .op = ir->data.binary.op, .left = left, .right = right };
+            rename_push(stack, &walk, new_expr(ssa, binary));
+            break;
+        }
+        case OP_NEGATE: {
+            SsaExpr negate = { .kind = EXPR_NEGATE, .left = rename_pop(builder, stack, &walk), .right = -1 };
+            rename_push(stack, &walk, new_expr(ssa, negate));
+            break;
+        }
+        case OP_ARRAY_LOAD:
+            rename_pop(builder, stack, &walk);
+            rename_pop(builder, stack, &walk);
+            rename_push(stack, &walk, expr_top(ssa));
+            break;
+        case OP_ARRAY_LENGTH:
+            rename_pop(builder, stack, &walk);
+            rename_push(stack, &walk, expr_range(ssa, 0, INT_MAX));
+            break;
+        case OP_NEW_ARRAY:
+            for (int i = 0; i < ir->data.new_array.dim; i++) {
+                rename_pop(builder, stack, &walk);
+            }
+            rename_push(stack, &walk, expr_top(ssa));
+            break;
+        case OP_ARRAY_STORE:
+            for (int i = 0; i < 3; i++) {
+                rename_pop(builder, stack, &walk);
+            }
+            break;
+        case OP_RETURN:
+            rename_pop(builder, stack, &walk);
+            break;
+        case OP_IF: {
+            int right = rename_pop(builder, stack, &walk);
+            int left = rename_pop(builder, stack, &walk);
+            new_branch(builder, block, ir->data.ift.condition, left, right);
+            break;
+        }
+        case OP_IF_ZERO: {
+            int left = rename_pop(builder, stack, &walk);
+            new_branch(builder, block, ir->data.ift.condition, left, expr_range(ssa, 0, 0));
+            break;
+        }
+        case OP_INVOKE:
+            if (ip == basic_block->ip_end && vector_length(successors(builder, block))) {
+                int arguments = invoke_arguments(builder, block);
+                int* args = malloc(sizeof(int) * (arguments + 1));
+
+                for (int i = arguments - 1; i >= 0; i--) {
+                    args[i] = rename_pop(builder, stack, &walk);
+                }
+
+                for (int local = 0; local < ssa->max_locals; local++) {
+                    define(builder, block, local, local < arguments ? args[local] : expr_top(ssa), defined);
+                }
+
+                free(args);
+                invoked = 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!invoked) {
+        for (int k = walk.min_depth; k < walk.depth; k++) {
+            define(builder, block, ssa->max_locals + k, *(int*)vector_get(stack, k), defined);
+        }
+    }
+}
+
+static void rename_block(SsaBuilder* builder, int block, Vector* stack)
+{
+    SsaForm* ssa = builder->ssa;
+    SsaBlock* ssa_block = &ssa->blocks[block];
+    Vector* defined = vector_new(sizeof(int));
+
+    for (size_t i = 0; i < vector_length(ssa_block->values); i++) {
+        int value = *(int*)vector_get(ssa_block->values, i);
+        int var = ssa_value(ssa, value)->var;
+        if (var < 0) {
+            continue;
+        }
+
+        vector_push(builder->rename[var], &value);
+        vector_push(defined, &var);
+    }
+
+    // the only predecessor dominates the block, its branch is already renamed
+    Vector* sigmas = builder->sigmas[block];
+    for (size_t i = 0; i < vector_length(sigmas); i++) {
+        SigmaSite* site = vector_get(sigmas, i);
+        int branch = ssa->blocks[site->branch_block].branch;
+        if (branch == -1) {
+            continue;
+        }
+
+        int source = current(builder, site->var);
+        int sigma = new_value(ssa, SSA_SIGMA, block, site->var);
+        SsaValue* value = ssa_value(ssa, sigma);
+
+        vector_push(value->operands, &source);
+        value->branch = branch;
+        value->taken = site->taken;
+
+        add_expr_user(ssa, ssa_value(ssa, branch)->left, sigma);
+        add_expr_user(ssa, ssa_value(ssa, branch)->right, sigma);
+
+        vector_push(builder->rename[site->var], &sigma);
+        vector_push(defined, &site->var);
+    }
+
+    rename_instructions(builder, block, stack, defined);
+
+    ssa_block->exit_values = malloc(sizeof(int) * (ssa->observed_locals + 1));
+    for (int j = 0; j < ssa->observed_locals; j++) {
+        ssa_block->exit_values[j] = current(builder, j);
+    }
+
+    Vector* next = successors(builder, block);
+    for (size_t i = 0; i < vector_length(next); i++) {
+        SsaBlock* target = &ssa->blocks[*(int*)vector_get(next, i)];
+        int position = -1;
+
+        for (size_t j = 0; j < vector_length(target->predecessors); j++) {
+            SsaEdge* edge = vector_get(target->predecessors, j);
+            if (edge->source == block && edge->index == (int)i) {
+                position = j;
+            }
+        }
+
+        if (position == -1) {
+            continue;
+        }
+
+        for (size_t j = 0; j < vector_length(target->values); j++) {
+            SsaValue* phi = ssa_value(ssa, *(int*)vector_get(target->values, j));
+            if (phi->kind != SSA_PHI) {
+                break;
+            }
+
+            int operand = current(builder, phi->var);
+            *(int*)vector_get(phi->operands, position) = operand;
+            add_user(ssa, operand, *(int*)vector_get(target->values, j));
+        }
+    }
+
+    Vector* children = builder->children[block];
+    for (size_t i = 0; i < vector_length(children); i++) {
+        rename_block(builder, *(int*)vector_get(children, i), stack);
+    }
+
+    int var;
+    while (vector_pop(defined, &var) == 0) {
+        vector_pop(builder->rename[var], NULL);
+    }
+    vector_delete(defined);
+}
+
+/*** BUILD ***/
+
+static void builder_delete(SsaBuilder* builder)
+{
+    int n = builder->ssa ? builder->ssa->block_count : 0;
+
+    for (int i = 0; i < n; i++) {
+        if (builder->children) {
+            vector_delete(builder->children[i]);
+        }
+        if (builder->frontier) {
+            vector_delete(builder->frontier[i]);
+        }
+        if (builder->sigmas) {
+            vector_delete(builder->sigmas[i]);
+        }
+    }
+
+    for (int i = 0; i < builder->var_count; i++) {
+        if (builder->def_blocks) {
+            vector_delete(builder->def_blocks[i]);
+        }
+        if (builder->rename) {
+            vector_delete(builder->rename[i]);
+        }
+    }
+
+    free(builder->children);
+    free(builder->frontier);
+    free(builder->sigmas);
+    free(builder->def_blocks);
+    free(builder->rename);
+    free(builder->rpo);
+    free(builder->rpo_index);
+    free(builder->idom);
+    free(builder->entry_depth);
+    free(builder->branch_origin);
+    free(builder->global);
+    free(builder->defined_in);
+}
+
+SsaForm* ssa_build(Cfg* cfg, Graph* flow, int max_locals, int max_stack, int observed_locals)
+{
+    int result = SUCCESS;
+    SsaBuilder builder = { 0 };
+    Vector* scratch = NULL;
+
+    if (!cfg || !flow) {
+        return NULL;
+    }
+
+    int n = vector_length(cfg->blocks);
+    SsaForm* ssa = calloc(1, sizeof(SsaForm));
+    if (!ssa) {
+        return NULL;
+    }
+
+    ssa->block_count = n;
+    ssa->max_locals = max_locals;
+    ssa->max_stack = max_stack;
+    ssa->observed_locals = MIN(observed_locals, max_locals);
+    ssa->values = vector_new(sizeof(SsaValue));
+    ssa->exprs = vector_new(sizeof(SsaExpr));
+    ssa->blocks = calloc(n, sizeof(SsaBlock));
+
+    builder.ssa = ssa;
+    builder.cfg = cfg;
+    builder.var_count = max_locals + max_stack;
+    builder.rpo = malloc(sizeof(int) * n);
+    builder.rpo_index = malloc(sizeof(int) * n);
+    builder.idom = malloc(sizeof(int) * n);
+    builder.entry_depth = malloc(sizeof(int) * n);
+    builder.branch_origin = malloc(sizeof(int) * n);
+    builder.children = calloc(n, sizeof(Vector*));
+    builder.frontier = calloc(n, sizeof(Vector*));
+    builder.sigmas = calloc(n, sizeof(Vector*));
+    builder.def_blocks = calloc(builder.var_count + 1, sizeof(Vector*));
+    builder.rename = calloc(builder.var_count + 1, sizeof(Vector*));
+    builder.global = calloc(builder.var_count + 1, sizeof(bool));
+    builder.defined_in = malloc(sizeof(int) * (builder.var_count + 1));
+    scratch = vector_new(sizeof(int));
+
+    if (!ssa->values || !ssa->exprs || !ssa->blocks || !builder.rpo || !builder.rpo_index
+        || !builder.idom || !builder.entry_depth || !builder.branch_origin || !builder.children
+        || !builder.frontier || !builder.sigmas || !builder.def_blocks || !builder.rename
+        || !builder.global || !builder.defined_in || !scratch) {
+        result = FAILURE;
+        goto cleanup;
+    }
+
+    for (int i = 0; i < n; i++) {
+        ssa->blocks[i].successors = vector_new(sizeof(int));
+        ssa->blocks[i].predecessors = vector_new(sizeof(SsaEdge));
+        ssa->blocks[i].values = vector_new(sizeof(int));
+        ssa->blocks[i].branch = -1;
+        builder.rpo_index[i] = -1;
+        builder.idom[i] = -1;
+        builder.entry_depth[i] = -1;
+        builder.branch_origin[i] = -1;
+        builder.children[i] = vector_new(sizeof(int));
+        builder.frontier[i] = vector_new(sizeof(int));
+        builder.sigmas[i] = vector_new(sizeof(SigmaSite));
+    }
+
+    for (int var = 0; var < builder.var_count; var++) {
+        builder.def_blocks[var] = vector_new(sizeof(int));
+        builder.rename[var] = vector_new(sizeof(int));
+        builder.defined_in[var] = -1;
+    }
+
+    if (!n) {
+        goto cleanup;
+    }
+
+    // the flow graph is rewritten once the analysis is set up, keep the cfg edges
+    for (int i = 0; i < n; i++) {
+        Node* node = vector_get(flow->nodes, i);
+        vector_copy(ssa->blocks[i].successors, node->successors);
+    }
+
+    compute_rpo(&builder);
+    build_predecessors(&builder);
+    compute_dominators(&builder);
+    compute_frontiers(&builder);
+
+    builder.entry_depth[0] = 0;
+    for (int i = 0; i < builder.rpo_len; i++) {
+        collect_block(&builder, builder.rpo[i], scratch);
+    }
+
+    // the results read them at the end of every block
+    for (int j = 0; j < ssa->observed_locals; j++) {
+        builder.global[j] = true;
+    }
+
+    for (int i = 0; i < builder.rpo_len; i++) {
+        place_sigmas(&builder, builder.rpo[i]);
+    }
+
+    place_phis(&builder);
+
+    // block 0 never has phis, its values start with the unknown entry ones
+    for (int var = 0; var < builder.var_count; var++) {
+        new_value(ssa, SSA_ENTRY, 0, var);
+    }
+
+    rename_block(&builder, 0, scratch);
+
+    LOG_DEBUG("SSA: %zu values, %zu expressions over %d blocks", vector_length(ssa->values), vector_length(ssa->exprs), n);
+
+cleanup:
+    vector_delete(scratch);
+    builder_delete(&builder);
+
+    if (result) {
+        ssa_delete(ssa);
+        ssa = NULL;
+    }
+
+    return ssa;
+}
+
+/*** PRINT ***/
+
+static void expr_print(const SsaForm* ssa, int expr)
+{
+    static const char* operators[] = { "+", "-", "/", "*", "%" };
+    SsaExpr* e = ssa_expr(ssa, expr);
+
+    switch (e->kind) {
+    case EXPR_RANGE:
+        if (e->lower == e->upper) {
+            printf("%d", e->lower);
+        } else {
+            printf("[%d, %d]", e->lower, e->upper);
+        }
+        break;
+    case EXPR_VALUE:
+        printf("v%d", e->value);
+        break;
+    case EXPR_BINARY:
+        printf("(");
+        expr_print(ssa, e->left);
+        printf(" %s ", e->op < BO_COUNT ? operators[e->op] : "?");
+        expr_print(ssa, e->right);
+        printf(")");
+        break;
+    case EXPR_NEGATE:
+        printf("-");
+        expr_print(ssa, e->left);
+        break;
+    }
+}
+
+void ssa_print(const SsaForm* ssa)
+{
+    for (int b = 0; b < ssa->block_count; b++) {
+        SsaBlock* block = &ssa->blocks[b];
+        if (!block->reachable) {
+            continue;
+        }
+
+        printf("BLOCK %d\n", b);
+        for (size_t i = 0; i < vector_length(block->values); i++) {
+            int id = *(int*)vector_get(block->values, i);
+            SsaValue* value = ssa_value(ssa, id);
+
+            printf("  v%d = ", id);
+            switch (value->kind) {
+            case SSA_ENTRY:
+                printf("entry(%d)", value->var);
+                break;
+            case SSA_PHI:
+                printf("phi(%d)", value->var);
+                for (size_t j = 0; j < vector_length(value->operands); j++) {
+                    printf(" v%d", *(int*)vector_get(value->operands, j));
+                }
+                break;
+            case SSA_SIGMA:
+                printf("sigma(%d) v%d on v%d %s", value->var, *(int*)vector_get(value->operands, 0), value->branch, value->taken ? "taken" : "not taken");
+                break;
+            case SSA_EXPR:
+                printf("%d <- ", value->var);
+                expr_print(ssa, value->expr);
+                break;
+            case SSA_BRANCH:
+                printf("branch %d ", value->condition);
+                expr_print(ssa, value->left);
+                printf(", ");
+                expr_print(ssa, value->right);
+                break;
+            }
+            printf("\n");
+        }
+    }
+}
+
+void ssa_delete(SsaForm* ssa)
+{
+    if (!ssa) {
+        return;
+    }
+
+    for (size_t i = 0; i < vector_length(ssa->values); i++) {
+        SsaValue* value = ssa_value(ssa, i);
+        vector_delete(value->operands);
+        vector_delete(value->users);
+    }
+
+    if (ssa->blocks) {
+        for (int i = 0; i < ssa->block_count; i++) {
+            vector_delete(ssa->blocks[i].successors);
+            vector_delete(ssa->blocks[i].predecessors);
+            vector_delete(ssa->blocks[i].values);
+            free(ssa->blocks[i].exit_values);
+        }
+    }
+
+    free(ssa->blocks);
+    vector_delete(ssa->values);
+    vector_delete(ssa->exprs);
+    free(ssa);
+}
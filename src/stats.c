@@ -0,0 +1,228 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+#ifdef STATS
+
+#include "cJSON/cJSON.h"
+#include "log.h"
+
+#include <stdlib.h>
+
+// one per thread, allocated apart so that threads do not share cache lines
+typedef struct {
+    long tasks;
+    long* visits; // per node
+    long* events; // per component, EVENT_COUNT each
+    double time[TIME_COUNT];
+} ThreadStats;
+
+struct FixpointStats {
+    char* method_id;
+    int threads;
+    int nodes;
+    int components;
+    ThreadStats** slots;
+    int* iterations; // per component, ascending iterations summed over its rounds
+    int* stabilizations; // per component, rounds that reached a fixpoint
+};
+
+FixpointStats* stats_new(const char* method_id, int threads, int nodes, int components)
+{
+    FixpointStats* stats = calloc(1, sizeof(FixpointStats));
+    if (!stats) {
+        return NULL;
+    }
+
+    stats->method_id = strdup(method_id ? method_id : "");
+    stats->threads = threads;
+    stats->nodes = nodes;
+    stats->components = components;
+    stats->slots = calloc(threads, sizeof(ThreadStats*));
+    stats->iterations = calloc(components, sizeof(int));
+    stats->stabilizations = calloc(components, sizeof(int));
+
+    if (!stats->method_id || !stats->slots || (components && (!stats->iterations || !stats->stabilizations))) {
+        stats_delete(stats);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        ThreadStats* slot = calloc(1, sizeof(ThreadStats));
+        if (!slot) {
+            stats_delete(stats);
+            return NULL;
+        }
+
+        slot->visits = calloc(nodes, sizeof(long));
+        slot->events = calloc(components * EVENT_COUNT, sizeof(long));
+        stats->slots[i] = slot;
+
+        if (!slot->visits || (components && !slot->events)) {
+            stats_delete(stats);
+            return NULL;
+        }
+    }
+
+    return stats;
+}
+
+static ThreadStats* thread_slot(FixpointStats* stats)
+{
+    int thread = omp_get_thread_num();
+    return stats && thread < stats->threads ? stats->slots[thread] : NULL;
+}
+
+void stats_visit(FixpointStats* stats, int node)
+{
+    ThreadStats* slot = thread_slot(stats);
+    if (slot) {
+        slot->tasks++;
+        slot->visits[node]++;
+    }
+}
+
+void stats_event(FixpointStats* stats, int component, ComponentEvent event)
+{
+    ThreadStats* slot = thread_slot(stats);
+    if (slot && component >= 0) {
+        slot->events[component * EVENT_COUNT + event]++;
+    }
+}
+
+// called by the exit task of the component, no other task touches it meanwhile
+void stats_stabilized(FixpointStats* stats, int component, int iterations)
+{
+    if (stats) {
+        stats->iterations[component] += iterations;
+        stats->stabilizations[component]++;
+    }
+}
+
+void stats_time(FixpointStats* stats, TimeKind kind, double seconds)
+{
+    ThreadStats* slot = thread_slot(stats);
+    if (slot) {
+        slot->time[kind] += seconds;
+    }
+}
+
+static cJSON* times_to_json(const double* time)
+{
+    cJSON* json = cJSON_CreateObject();
+
+    cJSON_AddNumberToObject(json, "transfer", time[TIME_TRANSFER]);
+    cJSON_AddNumberToObject(json, "lock_wait", time[TIME_LOCK_WAIT]);
+    cJSON_AddNumberToObject(json, "scheduling", time[TIME_TASK] - time[TIME_TRANSFER] - time[TIME_LOCK_WAIT]);
+
+    return json;
+}
+
+static cJSON* stats_to_json(const FixpointStats* stats, double elapsed)
+{
+    long* visits = calloc(stats->nodes, sizeof(long));
+    long* events = calloc(stats->components * EVENT_COUNT, sizeof(long));
+    double time[TIME_COUNT] = { 0 };
+
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "method", stats->method_id);
+    cJSON_AddNumberToObject(json, "elapsed", elapsed);
+
+    cJSON* threads = cJSON_CreateArray();
+    for (int t = 0; t < stats->threads; t++) {
+        ThreadStats* slot = stats->slots[t];
+
+        for (int i = 0; visits && i < stats->nodes; i++) {
+            visits[i] += slot->visits[i];
+        }
+        for (int i = 0; events && i < stats->components * EVENT_COUNT; i++) {
+            events[i] += slot->events[i];
+        }
+        for (int i = 0; i < TIME_COUNT; i++) {
+            time[i] += slot->time[i];
+        }
+
+        cJSON* thread = times_to_json(slot->time);
+        cJSON_AddNumberToObject(thread, "tasks", slot->tasks);
+        cJSON_AddItemToArray(threads, thread);
+    }
+
+    // thread times are summed, they exceed elapsed when threads overlap
+    cJSON_AddItemToObject(json, "time", times_to_json(time));
+    cJSON_AddItemToObject(json, "threads", threads);
+
+    cJSON* nodes = cJSON_CreateArray();
+    for (int i = 0; visits && i < stats->nodes; i++) {
+        cJSON_AddItemToArray(nodes, cJSON_CreateNumber(visits[i]));
+    }
+    cJSON_AddItemToObject(json, "visits", nodes);
+
+    cJSON* components = cJSON_CreateArray();
+    for (int i = 0; events && i < stats->components; i++) {
+        cJSON* component = cJSON_CreateObject();
+        cJSON_AddNumberToObject(component, "joins", events[i * EVENT_COUNT + EVENT_JOIN]);
+        cJSON_AddNumberToObject(component, "widenings", events[i * EVENT_COUNT + EVENT_WIDENING]);
+        cJSON_AddNumberToObject(component, "narrowings", events[i * EVENT_COUNT + EVENT_NARROWING]);
+        cJSON_AddNumberToObject(component, "iterations", stats->iterations[i]);
+        cJSON_AddNumberToObject(component, "stabilizations", stats->stabilizations[i]);
+        cJSON_AddItemToArray(components, component);
+    }
+    cJSON_AddItemToObject(json, "components", components);
+
+    free(visits);
+    free(events);
+
+    return json;
+}
+
+// appended to path as a line of JSON, stderr without a path
+void stats_dump(FixpointStats* stats, const char* path, double elapsed)
+{
+    if (!stats) {
+        return;
+    }
+
+    cJSON* json = stats_to_json(stats, elapsed);
+    char* text = cJSON_PrintUnformatted(json);
+
+#pragma omp critical(stats_output)
+    {
+        FILE* file = path ? fopen(path, "a") : stderr;
+        if (!file) {
+            LOG_ERROR("Unable to open the stats file %s", path);
+        } else if (text) {
+            fprintf(file, "%s\n", text);
+            if (file != stderr) {
+                fclose(file);
+            }
+        }
+    }
+
+    free(text);
+    cJSON_Delete(json);
+}
+
+void stats_delete(FixpointStats* stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    for (int i = 0; stats->slots && i < stats->threads; i++) {
+        if (stats->slots[i]) {
+            free(stats->slots[i]->visits);
+            free(stats->slots[i]->events);
+            free(stats->slots[i]);
+        }
+    }
+
+    free(stats->slots);
+    free(stats->iterations);
+    free(stats->stabilizations);
+    free(stats->method_id);
+    free(stats);
+}
+
+#endif
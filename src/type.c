@@ -109,18 +109,28 @@ Type* make_array_type(Type* element_type)
         return NULL;
     }
 
-    for (Type* t = type_table; t != NULL; t = t->next) {
-        if (t->kind == TK_ARRAY && t->array.element_type == element_type)
-            return t;
-    }
+    Type* result = NULL;
+
+    // methods are parsed and inlined by concurrent analyses
+#pragma omp critical(type_table)
+    {
+        for (Type* t = type_table; t != NULL; t = t->next) {
+            if (t->kind == TK_ARRAY && t->array.element_type == element_type) {
+                result = t;
+                break;
+            }
+        }
 
-    Type* t = malloc(sizeof(Type));
-    t->kind = TK_ARRAY;
-    t->array.element_type = element_type;
-    t->next = type_table;
-    type_table = t;
+        if (!result) {
+            result = malloc(sizeof(Type));
+            result->kind = TK_ARRAY;
+            result->array.element_type = element_type;
+            result->next = type_table;
+            type_table = result;
+        }
+    }
 
-    return t;
+    return result;
 }
 
 bool type_is_array(const Type* type)
@@ -127,6 +127,14 @@ int vector_copy(Vector* dst, const Vector* src)
     return SUCCESS;
 }
 
+// keeps the storage, pushing again does not allocate until the old capacity is reached
+void vector_clear(Vector* v)
+{
+    if (v) {
+        v->length = 0;
+    }
+}
+
 int vector_pop(Vector* v, void* out)
 {
     if (!v || v->length == 0) {
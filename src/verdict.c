@@ -0,0 +1,382 @@
+#include "verdict.h"
+
+#include "common.h"
+#include "ir_instruction.h"
+#include "ir_program.h"
+#include "log.h"
+#include "opcode.h"
+#include "utils.h"
+
+#include <stdlib.h>
+
+static const char* verdict_names[] = {
+    [VERDICT_IMPOSSIBLE] = "impossible",
+    [VERDICT_CERTAIN] = "certain",
+    [VERDICT_UNKNOWN] = "unknown",
+};
+
+static const char* outcome_names[] = {
+    [OC_OK] = "ok",
+    [OC_DIVIDE_BY_ZERO] = "divide by zero",
+    [OC_ASSERTION_ERROR] = "assertion error",
+    [OC_OUT_OF_BOUNDS] = "out of bounds",
+    [OC_NULL_POINTER] = "null pointer",
+    [OC_INFINITE_LOOP] = "*",
+};
+
+static IrInstruction* instruction_at(const IrFunction* function, int pc)
+{
+    return *(IrInstruction**)vector_get(function->ir_instructions, pc);
+}
+
+static bool is_terminal(const IrInstruction* ir)
+{
+    return ir->opcode == OP_RETURN || ir->opcode == OP_THROW;
+}
+
+/*
+ * Instructions the interval transfer does not model leave the stack of the
+ * following states wrong, and branches on it could be refined the wrong way.
+ * An invoke that is not inlined only keeps the states right when a throw
+ * follows it, like the constructor of an AssertionError. An inlined callee
+ * returns into the caller with its own frame, so only a tail call is kept.
+ */
+static bool is_modeled(const InvariantStore* store, const IrFunction* function, int pc, const Config* cfg)
+{
+    IrInstruction* ir = instruction_at(function, pc);
+
+    switch (ir->opcode) {
+    case OP_INVOKE: {
+        int length = vector_length(function->ir_instructions);
+        if (pc + 1 < length && instruction_at(function, pc + 1)->opcode == OP_THROW) {
+            return true;
+        }
+
+        char* method_id = get_method_signature(&ir->data.invoke);
+        Method* callee = method_id ? method_create(method_id) : NULL;
+        free(method_id);
+
+        if (!callee) {
+            return false;
+        }
+
+        // inlined callees have their own states in the store
+        const IrFunction* callee_function = ir_program_get_function_ir(callee, cfg);
+        method_delete(callee);
+
+        return callee_function && callee_function != function && invariant_store_function(store, callee_function) != -1
+            && pc + 1 < length && instruction_at(function, pc + 1)->opcode == OP_RETURN;
+    }
+    default:
+        return true;
+    }
+}
+
+/*
+ * An array access checks its reference for null first, then the index: the
+ * array operand sits right below the index. The interval of a reference is
+ * the length of the array, ARRAY_NULL for null.
+ */
+static Verdict access_verdict(const InvariantStore* store, int function, int pc, int slots, int operand, outcome kind)
+{
+    Interval array, index;
+    if (invariant_store_get(store, function, pc, slots - operand - (kind == OC_OUT_OF_BOUNDS), &array)
+        || is_interval_bottom(array)) {
+        return VERDICT_UNKNOWN;
+    }
+
+    bool null = array.lower == ARRAY_NULL && array.upper == ARRAY_NULL;
+    bool not_null = array.lower > ARRAY_NULL;
+
+    if (kind == OC_NULL_POINTER) {
+        return not_null ? VERDICT_IMPOSSIBLE : null ? VERDICT_CERTAIN : VERDICT_UNKNOWN;
+    }
+
+    if (null) {
+        return VERDICT_IMPOSSIBLE;
+    }
+
+    if (invariant_store_get(store, function, pc, slots - operand, &index) || is_interval_bottom(index)) {
+        return VERDICT_UNKNOWN;
+    }
+
+    int length_lower = MAX(array.lower, 0);
+    if (index.lower >= 0 && index.upper < length_lower) {
+        return VERDICT_IMPOSSIBLE;
+    }
+
+    return not_null && (index.upper < 0 || index.lower >= array.upper) ? VERDICT_CERTAIN : VERDICT_UNKNOWN;
+}
+
+static Verdict site_verdict(const InvariantStore* store, int function, int pc, int operand, outcome kind)
+{
+    int slots = invariant_store_slots(store, function, pc);
+    if (slots == -1) {
+        return VERDICT_IMPOSSIBLE;
+    }
+
+    if (kind == OC_ASSERTION_ERROR) {
+        return VERDICT_CERTAIN;
+    }
+
+    if (kind == OC_OUT_OF_BOUNDS || kind == OC_NULL_POINTER) {
+        return access_verdict(store, function, pc, slots, operand, kind);
+    }
+
+    Interval value;
+    if (invariant_store_get(store, function, pc, slots - operand, &value) || is_interval_bottom(value)) {
+        return VERDICT_UNKNOWN;
+    }
+
+    if (value.lower > 0 || value.upper < 0) {
+        return VERDICT_IMPOSSIBLE;
+    }
+    return value.lower == 0 && value.upper == 0 ? VERDICT_CERTAIN : VERDICT_UNKNOWN;
+}
+
+static void push_site(Verdicts* verdicts, const InvariantStore* store, int function, int pc, int operand, outcome kind)
+{
+    VerdictSite site = {
+        .function = invariant_store_function_ir(store, function),
+        .pc = pc,
+        .kind = kind,
+        .verdict = site_verdict(store, function, pc, operand, kind),
+    };
+
+    vector_push(verdicts->sites, &site);
+}
+
+/*
+ * A site is unavoidable when no run of the entry function terminates
+ * without passing it: with the site removed, no return or throw can be
+ * reached from pc 0 through instructions the analysis reaches.
+ */
+static bool is_unavoidable(const InvariantStore* store, int function, int site_pc)
+{
+    const IrFunction* ir_function = invariant_store_function_ir(store, function);
+    int length = vector_length(ir_function->ir_instructions);
+    bool unavoidable = true;
+
+    bool* visited = calloc(length, sizeof(bool));
+    int* stack = malloc(sizeof(int) * length);
+    if (!visited || !stack) {
+        unavoidable = false;
+        goto cleanup;
+    }
+
+    int top = 0;
+    if (site_pc != 0 && invariant_store_slots(store, function, 0) != -1) {
+        stack[top++] = 0;
+        visited[0] = true;
+    }
+
+    while (top && unavoidable) {
+        int pc = stack[--top];
+        IrInstruction* ir = instruction_at(ir_function, pc);
+
+        if (is_terminal(ir)) {
+            unavoidable = false;
+            break;
+        }
+
+        int successors[2] = { pc + 1, -1 };
+        if (ir->opcode == OP_GOTO) {
+            successors[0] = ir->data.go2.target;
+        } else if (ir->opcode == OP_IF || ir->opcode == OP_IF_ZERO) {
+            successors[1] = ir->data.ift.target;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            int next = successors[i];
+            if (next < 0 || next == site_pc || next >= length || visited[next]
+                || invariant_store_slots(store, function, next) == -1) {
+                continue;
+            }
+
+            visited[next] = true;
+            stack[top++] = next;
+        }
+    }
+
+cleanup:
+    free(visited);
+    free(stack);
+
+    return unavoidable;
+}
+
+int verdict_compute(const Method* m, const Config* cfg, const AbstractResult* result, Verdicts* verdicts)
+{
+    for (int i = 0; i <= OC_INFINITE_LOOP; i++) {
+        verdicts->outcomes[i] = VERDICT_UNKNOWN;
+    }
+
+    verdicts->sites = vector_new(sizeof(VerdictSite));
+    if (!verdicts->sites) {
+        return FAILURE;
+    }
+
+    const InvariantStore* store = result ? result->invariants : NULL;
+    const IrFunction* entry = ir_program_get_function_ir(m, cfg);
+    int entry_index = invariant_store_function(store, entry);
+
+    if (!store || entry_index == -1) {
+        LOG_INFO("No invariants, every outcome is unknown");
+        return FAILURE;
+    }
+
+    bool modeled = true;
+    bool loops = false;
+
+    for (int f = 0; f < invariant_store_functions(store); f++) {
+        const IrFunction* function = invariant_store_function_ir(store, f);
+
+        for (int pc = 0; pc < (int)vector_length(function->ir_instructions); pc++) {
+            IrInstruction* ir = instruction_at(function, pc);
+            bool reachable = invariant_store_slots(store, f, pc) != -1;
+
+            if (reachable && !is_modeled(store, function, pc, cfg)) {
+                modeled = false;
+            }
+
+            if (reachable && ((ir->opcode == OP_GOTO && ir->data.go2.target <= pc)
+                                 || ((ir->opcode == OP_IF || ir->opcode == OP_IF_ZERO) && ir->data.ift.target <= pc))) {
+                loops = true;
+            }
+
+            // operand: position of the checked value from the top of the stack
+            if (ir->opcode == OP_BINARY && ir->data.binary.type && ir->data.binary.type->kind == TK_INT
+                && (ir->data.binary.op == BO_DIV || ir->data.binary.op == BO_REM)) {
+                push_site(verdicts, store, f, pc, 1, OC_DIVIDE_BY_ZERO);
+            } else if (ir->opcode == OP_ARRAY_LOAD) {
+                push_site(verdicts, store, f, pc, 2, OC_NULL_POINTER);
+                push_site(verdicts, store, f, pc, 1, OC_OUT_OF_BOUNDS);
+            } else if (ir->opcode == OP_ARRAY_STORE) {
+                push_site(verdicts, store, f, pc, 3, OC_NULL_POINTER);
+                push_site(verdicts, store, f, pc, 2, OC_OUT_OF_BOUNDS);
+            } else if (ir->opcode == OP_ARRAY_LENGTH) {
+                push_site(verdicts, store, f, pc, 1, OC_NULL_POINTER);
+            } else if (ir->opcode == OP_THROW) {
+                push_site(verdicts, store, f, pc, 0, OC_ASSERTION_ERROR);
+            }
+        }
+    }
+
+    if (!modeled) {
+        LOG_INFO("The analysis does not model every reachable instruction, every outcome is unknown");
+        for (size_t i = 0; i < vector_length(verdicts->sites); i++) {
+            ((VerdictSite*)vector_get(verdicts->sites, i))->verdict = VERDICT_UNKNOWN;
+        }
+        return SUCCESS;
+    }
+
+    int possible = 0;
+    const VerdictSite* certain = NULL;
+
+    for (size_t i = 0; i < vector_length(verdicts->sites); i++) {
+        VerdictSite* site = vector_get(verdicts->sites, i);
+        if (site->verdict != VERDICT_IMPOSSIBLE) {
+            possible++;
+        }
+        if (site->verdict == VERDICT_CERTAIN && site->function == entry) {
+            certain = site;
+        }
+    }
+
+    // the only site that can be reached, and every run reaches it
+    if (possible == 1 && certain && !loops && is_unavoidable(store, entry_index, certain->pc)) {
+        for (int i = 0; i <= OC_INFINITE_LOOP; i++) {
+            verdicts->outcomes[i] = VERDICT_IMPOSSIBLE;
+        }
+        verdicts->outcomes[certain->kind] = VERDICT_CERTAIN;
+        return SUCCESS;
+    }
+
+    outcome kinds[] = { OC_DIVIDE_BY_ZERO, OC_ASSERTION_ERROR, OC_OUT_OF_BOUNDS, OC_NULL_POINTER };
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        verdicts->outcomes[kinds[k]] = VERDICT_IMPOSSIBLE;
+    }
+
+    for (size_t i = 0; i < vector_length(verdicts->sites); i++) {
+        VerdictSite* site = vector_get(verdicts->sites, i);
+        if (site->verdict != VERDICT_IMPOSSIBLE) {
+            verdicts->outcomes[site->kind] = VERDICT_UNKNOWN;
+        }
+    }
+
+    verdicts->outcomes[OC_INFINITE_LOOP] = loops ? VERDICT_UNKNOWN : VERDICT_IMPOSSIBLE;
+    verdicts->outcomes[OC_OK] = !possible && !loops ? VERDICT_CERTAIN : VERDICT_UNKNOWN;
+
+    return SUCCESS;
+}
+
+bool verdict_decided(const Verdicts* verdicts)
+{
+    for (int i = 0; i <= OC_INFINITE_LOOP; i++) {
+        if (verdicts->outcomes[i] == VERDICT_UNKNOWN) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Outcome verdict_outcome(const Verdicts* verdicts)
+{
+    int percentages[OC_INFINITE_LOOP + 1];
+
+    for (int i = 0; i <= OC_INFINITE_LOOP; i++) {
+        percentages[i] = verdicts->outcomes[i] == VERDICT_CERTAIN ? 100
+            : verdicts->outcomes[i] == VERDICT_IMPOSSIBLE         ? 0
+                                                                  : 50;
+    }
+
+    return (Outcome) {
+        .oc_ok = percentages[OC_OK],
+        .oc_divide_by_zero = percentages[OC_DIVIDE_BY_ZERO],
+        .oc_assertion_error = percentages[OC_ASSERTION_ERROR],
+        .oc_out_of_bounds = percentages[OC_OUT_OF_BOUNDS],
+        .oc_null_pointer = percentages[OC_NULL_POINTER],
+        .oc_infinite_loop = percentages[OC_INFINITE_LOOP],
+    };
+}
+
+/*
+ * Marks in goal the pcs of the sites left unknown, the only ones the fuzzer
+ * has to reach. Returns how many there are.
+ */
+size_t verdict_fuzz_goal(const Verdicts* verdicts, uint8_t* goal, size_t count)
+{
+    size_t marked = 0;
+
+    for (size_t i = 0; verdicts->sites && i < vector_length(verdicts->sites); i++) {
+        VerdictSite* site = vector_get(verdicts->sites, i);
+
+        if (site->verdict == VERDICT_UNKNOWN && (size_t)site->pc < count && !goal[site->pc]) {
+            goal[site->pc] = 1;
+            marked++;
+        }
+    }
+
+    return marked;
+}
+
+void verdict_print(const Verdicts* verdicts)
+{
+    for (size_t i = 0; verdicts->sites && i < vector_length(verdicts->sites); i++) {
+        VerdictSite* site = vector_get(verdicts->sites, i);
+        LOG_INFO("Site pc %d, %s: %s", site->pc, outcome_names[site->kind], verdict_names[site->verdict]);
+    }
+
+    for (int i = 0; i <= OC_INFINITE_LOOP; i++) {
+        LOG_INFO("Outcome %s: %s", outcome_names[i], verdict_names[verdicts->outcomes[i]]);
+    }
+}
+
+void verdict_delete(Verdicts* verdicts)
+{
+    if (verdicts) {
+        vector_delete(verdicts->sites);
+        verdicts->sites = NULL;
+    }
+}